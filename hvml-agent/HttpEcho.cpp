@@ -1,10 +1,52 @@
 #include "HttpEcho.h"
 
 
-Http_Listener::Http_Listener (IHttpInfo* ihi)
+Http_Worker::Http_Worker (void)
+    : thr_id_ (ACE_OS::NULL_thread)
+{
+}
+
+Http_Worker::~Http_Worker (void)
+{
+}
+
+int
+Http_Worker::open (void)
+{
+    return ACE_Thread_Manager::instance ()->spawn
+        (Http_Worker::svc, (void*)this, THR_NEW_LWP | THR_JOINABLE, &thr_id_);
+}
+
+void
+Http_Worker::close (void)
+{
+    this->reactor_.end_reactor_event_loop ();
+}
+
+ACE_THR_FUNC_RETURN
+Http_Worker::svc (void* param)
+{
+    Http_Worker* worker = (Http_Worker*)param;
+
+    // the select reactor only dispatches events in its owner thread
+    worker->reactor_.owner (ACE_Thread::self ());
+    worker->reactor_.run_reactor_event_loop ();
+    return 0;
+}
+
+
+
+
+
+Http_Listener::Http_Listener (IHttpInfo* ihi, Page_Cache* cache,
+                              Http_Worker* workers, int n_workers)
     : local_address_ (ihi->GetListenPort())
     , acceptor_ (local_address_, 1)
     , ihi_ (ihi)
+    , cache_ (cache)
+    , workers_ (workers)
+    , n_workers_ (n_workers)
+    , next_worker_ (0)
 {
     this->reactor (ACE_Reactor::instance ());
     int result = this->reactor ()->register_handler
@@ -47,8 +89,13 @@ Http_Listener::handle_input (ACE_HANDLE handle)
     ACE_DEBUG ((LM_DEBUG, "Remote connection from: "));
     remote_address.dump ();
 
+    // hand the connection over to the workers in turn, the handler
+    // registers itself with the worker's reactor
+    Http_Worker *worker = &workers_[next_worker_];
+    next_worker_ = (next_worker_ + 1) % n_workers_;
+
     Http_Handler *handler = 0;
-    ACE_NEW_RETURN (handler, Http_Handler (stream, ihi_), -1);
+    ACE_NEW_RETURN (handler, Http_Handler (stream, ihi_, cache_, worker->reactor ()), -1);
 
     return 0;
 }
@@ -67,11 +114,23 @@ Http_Listener::handle_close (ACE_HANDLE handle,
 
 
 
-Http_Handler::Http_Handler (ACE_SOCK_Stream &s, IHttpInfo* ihi)
+Http_Handler::Http_Handler (ACE_SOCK_Stream &s, IHttpInfo* ihi, Page_Cache* cache,
+                            ACE_Reactor* reactor)
     : stream_ (s)
     , ihi_ (ihi)
+    , cache_ (cache)
+    , in_len_ (0)
+    , iov_count_ (0)
+    , iov_next_ (0)
+    , close_after_ (false)
 {
-    this->reactor (ACE_Reactor::instance ());
+    for (int i = 0; i < MAX_PIPELINE; ++i)
+        pages_[i] = 0;
+
+    // a client that stops reading must not stall the worker's reactor
+    this->stream_.enable (ACE_NONBLOCK);
+
+    this->reactor (reactor);
 
     int result = this->reactor ()->register_handler (this, READ_MASK);
     ACE_TEST_ASSERT (result == 0);
@@ -88,31 +147,16 @@ Http_Handler::handle_input (ACE_HANDLE handle)
 {
     ACE_DEBUG ((LM_DEBUG, "Network_Handler::handle_input handle = %d\n", handle));
 
-    char message[BUFSIZ];
-    int result = this->stream_.recv (message, sizeof message);
+    // reads are suspended while output is pending, but one may already
+    // have been due
+    if (iov_count_ > 0)
+        return 0;
+
+    int result = this->stream_.recv (in_buf_ + in_len_, sizeof in_buf_ - in_len_);
     if (result > 0)
     {
-        message[result] = 0;
-        ACE_DEBUG ((LM_DEBUG, "Remote message: %s\n", message));
-
-        char echo_format[] = 
-            "HTTP/1.0 200 OK\r\n"\
-            "Content-Type: application/json\r\n"\
-            "Vary: Accept-Encoding\r\n"\
-            "Content-Length: %d\r\n"\
-            "\r\n%s";
-
-        char echo_message[4096];
-        int info_len;
-        char* info = ihi_->GetHttpInfo(&info_len);
-        if (2048 < strlen(info)) {
-            return -1;
-        }
-
-        sprintf(echo_message, echo_format, info_len, info);
-
-        this->stream_.send(echo_message, sizeof echo_message);
-        return -1;
+        in_len_ += result;
+        return this->process_requests ();
     }
     else if (result == 0)
     {
@@ -130,12 +174,311 @@ Http_Handler::handle_input (ACE_HANDLE handle)
     }
 }
 
+// answer every complete request in the input buffer, in order; partial
+// requests stay buffered until the rest arrives
+int
+Http_Handler::process_requests (void)
+{
+    bool close_after = false;
+
+    while (!close_after)
+    {
+        size_t off = 0;
+        int n = 0;
+        bool need_more = false;
+
+        while (n < MAX_PIPELINE && !close_after)
+        {
+            Http_Request_Parser::Result r =
+                parser_.parse (in_buf_ + off, in_len_ - off);
+            if (r == Http_Request_Parser::NEED_MORE)
+            {
+                if (off == 0 && in_len_ == sizeof in_buf_)
+                {
+                    // the request will never fit in the buffer
+                    this->build_response (n++, 0, 413);
+                    close_after = true;
+                }
+                need_more = true;
+                break;
+            }
+            if (r == Http_Request_Parser::BAD)
+            {
+                this->build_response (n++, 0, 400);
+                close_after = true;
+                break;
+            }
+
+            this->build_response (n++, &parser_, 200);
+            close_after = !parser_.keep_alive ();
+            off += parser_.consumed ();
+            parser_.reset ();
+        }
+
+        int pending = 0;
+        if (n > 0)
+        {
+            iov_count_ = n * 2;
+            iov_next_ = 0;
+            pending = this->flush ();
+            if (pending == -1)
+                return -1;
+        }
+
+        if (off > 0)
+        {
+            ACE_OS::memmove (in_buf_, in_buf_ + off, in_len_ - off);
+            in_len_ -= off;
+        }
+
+        if (pending)
+        {
+            // wait for the client to take the rest before reading on
+            close_after_ = close_after;
+            this->reactor ()->cancel_wakeup (this, READ_MASK);
+            this->reactor ()->schedule_wakeup (this, WRITE_MASK);
+            return 0;
+        }
+
+        if (need_more || in_len_ == 0)
+            break;
+    }
+
+    return close_after ? -1 : 0;
+}
+
+// send the queued iovecs as far as the stream takes them; return 1 if
+// some are left, 0 once all are sent and their pages released, -1 on error
+int
+Http_Handler::flush (void)
+{
+    while (iov_next_ < iov_count_)
+    {
+        ssize_t sent = this->stream_.sendv (iov_ + iov_next_, iov_count_ - iov_next_);
+        if (sent == -1)
+        {
+            if (errno == EINTR)
+                continue;
+            return errno == EWOULDBLOCK ? 1 : -1;
+        }
+
+        while (iov_next_ < iov_count_ && (size_t)sent >= iov_[iov_next_].iov_len)
+        {
+            sent -= iov_[iov_next_].iov_len;
+            ++iov_next_;
+        }
+        if (sent > 0)
+        {
+            iov_[iov_next_].iov_base = (char*)iov_[iov_next_].iov_base + sent;
+            iov_[iov_next_].iov_len -= sent;
+        }
+    }
+
+    this->release_pages (iov_count_ / 2);
+    iov_count_ = 0;
+    iov_next_ = 0;
+    return 0;
+}
+
+int
+Http_Handler::handle_output (ACE_HANDLE handle)
+{
+    ACE_DEBUG ((LM_DEBUG, "Network_Handler::handle_output handle = %d\n", handle));
+
+    int pending = this->flush ();
+    if (pending == -1)
+        return -1;
+    if (pending)
+        return 0;
+    if (close_after_)
+        return -1;
+
+    this->reactor ()->cancel_wakeup (this, WRITE_MASK);
+    this->reactor ()->schedule_wakeup (this, READ_MASK);
+    // requests that came in along with the ones just answered
+    return this->process_requests ();
+}
+
+void
+Http_Handler::build_response (int slot, const Http_Request_Parser* req, int status)
+{
+    const char* reason = "OK";
+    int body_len = 0;
+    const char* body = bodies_[slot];
+    const char* content_type = "";
+    char etag[Http_Request_Parser::MAX_ETAG + 16] = "";
+
+    pages_[slot] = 0;
+    if (status == 200 && cache_ && (body_len = this->serve_metrics (slot, req)) != 0)
+    {
+        if (body_len < 0)
+        {
+            status = 500;
+            body_len = 0;
+        }
+        else
+            content_type = "Content-Type: text/plain; version=0.0.4\r\n";
+    }
+    else if (status == 200 && cache_ && this->serve_page (slot, req, &status))
+    {
+        Page* page = pages_[slot];
+        if (page)
+        {
+            body = page->body_;
+            body_len = status == 304 ? 0 : (int)page->body_len_;
+            ACE_OS::snprintf (etag, sizeof etag, "ETag: %s\r\n", page->etag_);
+            if (status == 200)
+                content_type = "Content-Type: text/html; charset=utf-8\r\n";
+        }
+    }
+    else if (status == 200)
+    {
+        body_len = ihi_->GetHttpInfo (bodies_[slot], BODY_SIZE);
+        if (body_len < 0)
+        {
+            status = 500;
+            body_len = 0;
+        }
+        else
+            content_type = "Content-Type: application/json\r\nVary: Accept-Encoding\r\n";
+    }
+
+    switch (status)
+    {
+    case 200: reason = "OK"; break;
+    case 304: reason = "Not Modified"; break;
+    case 400: reason = "Bad Request"; break;
+    case 404: reason = "Not Found"; break;
+    case 413: reason = "Payload Too Large"; break;
+    default:  reason = "Internal Server Error"; break;
+    }
+
+    const char* connection = "Connection: close\r\n";
+    if (status != 400 && status != 413 && req && req->keep_alive ())
+    {
+        // persistent by default in HTTP/1.1
+        connection = req->minor_version () >= 1 ? "" : "Connection: keep-alive\r\n";
+    }
+
+    // a 304 must not announce a length other than the page's, which
+    // caches would take for it; it announces none
+    char length[32] = "";
+    if (status != 304)
+        ACE_OS::snprintf (length, sizeof length, "Content-Length: %d\r\n", body_len);
+
+    int head_len = ACE_OS::snprintf (heads_[slot], HEAD_SIZE,
+        "HTTP/1.1 %d %s\r\n"
+        "%s"
+        "%s"
+        "%s"
+        "%s"
+        "\r\n",
+        status, reason, content_type, etag, length, connection);
+
+    iov_[slot * 2].iov_base = heads_[slot];
+    iov_[slot * 2].iov_len = head_len;
+    iov_[slot * 2 + 1].iov_base = (char*)body;
+    // the length is still announced for HEAD, but nothing is sent
+    iov_[slot * 2 + 1].iov_len = (req && req->head_only ()) ? 0 : body_len;
+}
+
+// if an If-None-Match value, `*` or a comma-separated list of entity
+// tags, names `etag`; compared weakly as it calls for, so W/"x" names "x"
+static bool
+etag_listed (const char* list, const char* etag)
+{
+    size_t len = ACE_OS::strlen (etag);
+    const char* p = list;
+    for (;;)
+    {
+        p += ACE_OS::strspn (p, " \t,");
+        if (*p == '\0')
+            return false;
+        if (*p == '*')
+            return true;
+        if (p[0] == 'W' && p[1] == '/')
+            p += 2;
+
+        const char* end = 0;
+        if (*p == '"' && (end = ACE_OS::strchr (p + 1, '"')) != 0)
+            ++end;
+        else
+            end = p + ACE_OS::strcspn (p, " \t,");
+        if ((size_t)(end - p) == len && ACE_OS::strncmp (p, etag, len) == 0)
+            return true;
+        p = end;
+    }
+}
+
+// answer a `.hvml` target from the page cache; return 0 if the target
+// is not a page, otherwise set `*status` and hold the page in pages_[slot]
+int
+Http_Handler::serve_page (int slot, const Http_Request_Parser* req, int* status)
+{
+    const char* target = req->target ();
+    size_t len = ACE_OS::strcspn (target, "?#");
+    if (len < 5 || ACE_OS::strncmp (target + len - 5, ".hvml", 5) != 0)
+        return 0;
+
+    Page* page = cache_->get (target, status);
+    if (!page)
+        return 1;
+
+    pages_[slot] = page;
+    *status = etag_listed (req->if_none_match (), page->etag_) ? 304 : 200;
+    return 1;
+}
+
+// answer /metrics with the parser stats of the page cache into
+// bodies_[slot]; return 0 if the target is something else, the body
+// length otherwise, -1 if it does not fit
+int
+Http_Handler::serve_metrics (int slot, const Http_Request_Parser* req)
+{
+    const char* target = req->target ();
+    size_t len = ACE_OS::strcspn (target, "?#");
+    if (len != 8 || ACE_OS::strncmp (target, "/metrics", 8) != 0)
+        return 0;
+
+    hvml_parser_stats_t stats;
+    size_t loads, pages;
+    cache_->stats (&stats, &loads, &pages);
+
+    FILE* out = fmemopen (bodies_[slot], BODY_SIZE, "w");
+    if (!out)
+        return -1;
+    ACE_OS::fprintf (out, "hvml_agent_page_loads %lu\n", (unsigned long)loads);
+    ACE_OS::fprintf (out, "hvml_agent_pages %lu\n", (unsigned long)pages);
+    hvml_parser_stats_printf (&stats, "hvml_parser", out);
+    long n = ACE_OS::ftell (out);
+    bool full = ACE_OS::ferror (out) || n >= BODY_SIZE - 1;
+    ACE_OS::fclose (out);
+
+    return full ? -1 : (int)n;
+}
+
+void
+Http_Handler::release_pages (int n)
+{
+    for (int i = 0; i < n; ++i)
+    {
+        if (pages_[i])
+        {
+            cache_->release (pages_[i]);
+            pages_[i] = 0;
+        }
+    }
+}
+
 int
 Http_Handler::handle_close (ACE_HANDLE handle,
                             ACE_Reactor_Mask)
 {
     ACE_DEBUG ((LM_DEBUG, "Network_Handler::handle_close handle = %d\n", handle));
 
+    // whichever mask failed, the connection is done with
+    this->reactor ()->remove_handler (this, ALL_EVENTS_MASK | DONT_CALL);
+    this->release_pages (MAX_PIPELINE);
     this->stream_.close ();
     delete this;
 
@@ -149,26 +492,47 @@ Http_Handler::handle_close (ACE_HANDLE handle,
 
 
 
+Http_Worker* HttpEcho::workers_ = 0;
+int HttpEcho::n_workers_ = 0;
+
 static ACE_THR_FUNC_RETURN
-worker_thread (void* param)
+accept_thread (void* param)
 {
-    IHttpInfo* ihi = (IHttpInfo*)param;
-
-    Http_Listener *listener = new Http_Listener(ihi);
+    Http_Listener* listener = (Http_Listener*)param;
     ACE_UNUSED_ARG (listener);
 
+    ACE_Reactor::instance()->owner (ACE_Thread::self ());
     ACE_Reactor::instance()->run_reactor_event_loop();
     return 0;
 }
 
-void HttpEcho::StartServer (IHttpInfo* ihi)
+void HttpEcho::StartServer (IHttpInfo* ihi, Page_Cache* cache, int n_workers)
 {
+    if (n_workers < 1)
+        n_workers = 1;
+
+    n_workers_ = n_workers;
+    ACE_NEW (workers_, Http_Worker[n_workers_]);
+    for (int i = 0; i < n_workers_; ++i)
+        workers_[i].open ();
+
+    if (cache)
+        cache->open (ACE_Reactor::instance ());
+
+    Http_Listener *listener = new Http_Listener(ihi, cache, workers_, n_workers_);
+
     ACE_Thread_Manager::instance ()->spawn
-        (worker_thread, (void*)ihi);
+        (accept_thread, (void*)listener);
 }
 
 void HttpEcho::StopServer (void)
 {
     ACE_Reactor::instance()->end_reactor_event_loop();
+    for (int i = 0; i < n_workers_; ++i)
+        workers_[i].close ();
     ACE_Thread_Manager::instance ()->wait ();
+
+    delete [] workers_;
+    workers_ = 0;
+    n_workers_ = 0;
 }
@@ -33,13 +33,18 @@
 #include "ace/OS_NS_unistd.h"
 #include "ace/streams.h"
 
+#include "HttpRequest.h"
+#include "PageCache.h"
+
 
 class IHttpInfo
 {
 public:
     IHttpInfo (int port) { listen_port_ = port; };
 
-    virtual char* GetHttpInfo (int* info_len) = 0;
+    /// write the info into `buf`, return its length or -1 if it does not fit;
+    /// called from all worker threads at the same time
+    virtual int GetHttpInfo (char* buf, int buf_len) = 0;
 
     int GetListenPort(void) { return listen_port_; };
 
@@ -51,10 +56,31 @@ private:
     int listen_port_;
 };
 
+/// One worker thread running its own reactor; the connections handed
+/// to a worker are served by that thread only.
+class Http_Worker
+{
+public:
+    Http_Worker (void);
+    ~Http_Worker (void);
+
+    ACE_Reactor* reactor (void) { return &reactor_; };
+
+    int open (void);
+    void close (void);
+
+private:
+    static ACE_THR_FUNC_RETURN svc (void* param);
+
+    ACE_Reactor reactor_;
+    ACE_thread_t thr_id_;
+};
+
 class Http_Listener : public ACE_Event_Handler
 {
 public:
-    Http_Listener (IHttpInfo* ihi);
+    Http_Listener (IHttpInfo* ihi, Page_Cache* cache,
+                   Http_Worker* workers, int n_workers);
     virtual ~Http_Listener (void);
 
     ACE_HANDLE get_handle (void) const;
@@ -67,29 +93,73 @@ public:
 
 private:
     IHttpInfo* ihi_;
+    Page_Cache* cache_;
+    Http_Worker* workers_;
+    int n_workers_;
+    int next_worker_;
 };
 
 class Http_Handler : public ACE_Event_Handler
 {
 public:
     /// Default constructor
-    Http_Handler (ACE_SOCK_Stream &s, IHttpInfo* ihi);
+    Http_Handler (ACE_SOCK_Stream &s, IHttpInfo* ihi, Page_Cache* cache,
+                  ACE_Reactor* reactor);
 
     virtual ACE_HANDLE  get_handle (void) const;
     virtual int handle_input (ACE_HANDLE handle);
+    virtual int handle_output (ACE_HANDLE handle);
     virtual int handle_close (ACE_HANDLE handle,
                               ACE_Reactor_Mask close_mask);
 
     ACE_SOCK_Stream stream_;
 
 private:
+    enum {
+        IN_BUF_SIZE     = 16384,
+        // responses gathered into a single writev
+        MAX_PIPELINE    = 8,
+        HEAD_SIZE       = 256,
+        BODY_SIZE       = 2048
+    };
+
+    int process_requests (void);
+    int flush (void);
+    void build_response (int slot, const Http_Request_Parser* req, int status);
+    int serve_page (int slot, const Http_Request_Parser* req, int* status);
+    int serve_metrics (int slot, const Http_Request_Parser* req);
+    void release_pages (int n);
+
     IHttpInfo* ihi_;
+    Page_Cache* cache_;
+
+    Http_Request_Parser parser_;
+    char in_buf_[IN_BUF_SIZE];
+    size_t in_len_;
+
+    iovec iov_[MAX_PIPELINE * 2];
+    char heads_[MAX_PIPELINE][HEAD_SIZE];
+    char bodies_[MAX_PIPELINE][BODY_SIZE];
+    // pages referenced by the iovecs until they are sent
+    Page* pages_[MAX_PIPELINE];
+    // the iovecs queued and the first of them not fully sent; the
+    // stream is non-blocking, what it does not take waits for
+    // handle_output, and no request is parsed meanwhile
+    int iov_count_;
+    int iov_next_;
+    bool close_after_;
 };
 
 
 class HttpEcho
 {
 public:
-    static void StartServer (IHttpInfo* ihi);
+    /// Accept on one thread, serve connections on `n_workers` threads;
+    /// `.hvml` targets are answered from `cache` when one is given
+    static void StartServer (IHttpInfo* ihi, Page_Cache* cache, int n_workers);
     static void StopServer (void);
+
+private:
+    static Http_Worker* workers_;
+    static int n_workers_;
 };
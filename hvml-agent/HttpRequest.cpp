@@ -0,0 +1,197 @@
+#include "HttpRequest.h"
+
+#include <ctype.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+static bool
+token_equal (const char* s, size_t len, const char* token)
+{
+    return strlen (token) == len && strncasecmp (s, token, len) == 0;
+}
+
+// if `token` appears in the comma separated list `s`
+static bool
+list_contains (const char* s, size_t len, const char* token)
+{
+    size_t i = 0;
+    while (i < len) {
+        while (i < len && (s[i] == ',' || s[i] == ' ' || s[i] == '\t'))
+            ++i;
+        size_t start = i;
+        while (i < len && s[i] != ',')
+            ++i;
+        size_t end = i;
+        while (end > start && (s[end-1] == ' ' || s[end-1] == '\t'))
+            --end;
+        if (token_equal (s + start, end - start, token))
+            return true;
+    }
+    return false;
+}
+
+Http_Request_Parser::Http_Request_Parser (void)
+{
+    this->reset ();
+}
+
+void
+Http_Request_Parser::reset (void)
+{
+    scanned_ = 0;
+    line_start_ = 0;
+    head_len_ = 0;
+    body_len_ = 0;
+    minor_version_ = 0;
+    keep_alive_ = false;
+    head_only_ = false;
+    target_[0] = '\0';
+    if_none_match_[0] = '\0';
+}
+
+Http_Request_Parser::Result
+Http_Request_Parser::parse (const char* buf, size_t len)
+{
+    if (head_len_ == 0) {
+        // look for the empty line ending the head, lines may end with
+        // either CRLF or a bare LF
+        const char* nl;
+        while (scanned_ < len &&
+               (nl = (const char*)memchr (buf + scanned_, '\n', len - scanned_))) {
+            size_t eol = nl - buf;
+            size_t line_len = eol - line_start_;
+            if (line_len > 0 && buf[eol-1] == '\r')
+                --line_len;
+            scanned_ = eol + 1;
+            if (line_len == 0 && line_start_ > 0) {
+                head_len_ = scanned_;
+                break;
+            }
+            line_start_ = scanned_;
+        }
+        if (head_len_ == 0) {
+            scanned_ = len;
+            return len > MAX_HEAD ? BAD : NEED_MORE;
+        }
+        if (head_len_ > MAX_HEAD || this->parse_head (buf, head_len_))
+            return BAD;
+    }
+
+    if (len < head_len_ + body_len_)
+        return NEED_MORE;
+
+    return DONE;
+}
+
+int
+Http_Request_Parser::parse_head (const char* buf, size_t len)
+{
+    bool first = true;
+    bool has_connection = false;
+    bool conn_close = false;
+    bool conn_keep_alive = false;
+
+    size_t start = 0;
+    while (start < len) {
+        const char* nl = (const char*)memchr (buf + start, '\n', len - start);
+        size_t eol = nl - buf;
+        size_t line_len = eol - start;
+        if (line_len > 0 && buf[eol-1] == '\r')
+            --line_len;
+        const char* line = buf + start;
+        start = eol + 1;
+
+        if (line_len == 0)
+            break;
+
+        if (first) {
+            if (this->parse_request_line (line, line_len))
+                return -1;
+            first = false;
+            continue;
+        }
+
+        const char* colon = (const char*)memchr (line, ':', line_len);
+        if (!colon || colon == line)
+            return -1;
+        size_t name_len = colon - line;
+        const char* val = colon + 1;
+        size_t val_len = line_len - name_len - 1;
+        while (val_len > 0 && (*val == ' ' || *val == '\t')) {
+            ++val;
+            --val_len;
+        }
+        while (val_len > 0 && (val[val_len-1] == ' ' || val[val_len-1] == '\t'))
+            --val_len;
+
+        if (token_equal (line, name_len, "Content-Length")) {
+            if (val_len == 0 || val_len > 18)
+                return -1;
+            size_t n = 0;
+            for (size_t i = 0; i < val_len; ++i) {
+                if (!isdigit ((unsigned char)val[i]))
+                    return -1;
+                n = n * 10 + (val[i] - '0');
+            }
+            body_len_ = n;
+        }
+        else if (token_equal (line, name_len, "Transfer-Encoding")) {
+            // chunked request bodies are not supported
+            return -1;
+        }
+        else if (token_equal (line, name_len, "Connection")) {
+            has_connection = true;
+            conn_close = list_contains (val, val_len, "close");
+            conn_keep_alive = list_contains (val, val_len, "keep-alive");
+        }
+        else if (token_equal (line, name_len, "If-None-Match")) {
+            // a validator too long to be one of ours can never match
+            if (val_len < sizeof if_none_match_) {
+                memcpy (if_none_match_, val, val_len);
+                if_none_match_[val_len] = '\0';
+            }
+        }
+    }
+
+    if (first)
+        return -1;
+
+    // HTTP/1.1 connections persist unless told otherwise,
+    // HTTP/1.0 ones only when asked for
+    if (minor_version_ >= 1)
+        keep_alive_ = !(has_connection && conn_close);
+    else
+        keep_alive_ = has_connection && conn_keep_alive && !conn_close;
+
+    return 0;
+}
+
+int
+Http_Request_Parser::parse_request_line (const char* line, size_t len)
+{
+    const char* sp1 = (const char*)memchr (line, ' ', len);
+    if (!sp1 || sp1 == line)
+        return -1;
+    const char* target = sp1 + 1;
+    const char* sp2 = (const char*)memchr (target, ' ', len - (target - line));
+    if (!sp2 || sp2 == target)
+        return -1;
+    const char* version = sp2 + 1;
+    size_t version_len = len - (version - line);
+
+    if (version_len != 8 || strncmp (version, "HTTP/1.", 7) != 0 ||
+        !isdigit ((unsigned char)version[7]))
+        return -1;
+    minor_version_ = version[7] - '0';
+
+    size_t target_len = sp2 - target;
+    if (target_len >= sizeof target_)
+        return -1;
+    memcpy (target_, target, target_len);
+    target_[target_len] = '\0';
+
+    head_only_ = token_equal (line, sp1 - line, "HEAD");
+
+    return 0;
+}
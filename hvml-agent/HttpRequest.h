@@ -0,0 +1,55 @@
+#pragma once
+
+#include <stddef.h>
+
+/// Incremental parser of one HTTP/1.x request.
+///
+/// The parser is always handed the connection's input starting at the
+/// first byte of the request; when more bytes arrive it is called again
+/// with the longer input and resumes scanning where it stopped.
+class Http_Request_Parser
+{
+public:
+    enum {
+        MAX_HEAD    = 8192,
+        MAX_TARGET  = 1024,
+        MAX_ETAG    = 128
+    };
+
+    enum Result {
+        BAD         = -1,
+        NEED_MORE   = 0,
+        DONE        = 1
+    };
+
+    Http_Request_Parser (void);
+
+    /// forget the request parsed so far, ready for the next one
+    void reset (void);
+
+    Result parse (const char* buf, size_t len);
+
+    /// valid once parse () returned DONE
+    size_t consumed (void) const { return head_len_ + body_len_; };
+    bool keep_alive (void) const { return keep_alive_; };
+    bool head_only (void) const { return head_only_; };
+    int minor_version (void) const { return minor_version_; };
+    const char* target (void) const { return target_; };
+    /// the If-None-Match header, empty when absent or too long
+    const char* if_none_match (void) const { return if_none_match_; };
+
+private:
+    int parse_head (const char* buf, size_t len);
+    int parse_request_line (const char* line, size_t len);
+
+    size_t scanned_;
+    size_t line_start_;
+    size_t head_len_;
+    size_t body_len_;
+
+    int minor_version_;
+    bool keep_alive_;
+    bool head_only_;
+    char target_[MAX_TARGET];
+    char if_none_match_[MAX_ETAG];
+};
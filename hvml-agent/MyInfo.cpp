@@ -6,14 +6,16 @@ MyInfo::MyInfo(int listen_port)
 {
 }
 
-char* MyInfo::GetHttpInfo (int* info_len) {
+int MyInfo::GetHttpInfo (char* buf, int buf_len) {
 
     char info_format[] = "[ INFO_1: %d  INFO_2: %d  INFO_3: %d ]";
-    snprintf(info_message_, INFO_MESSAGE_LEN, info_format,
+    int n = snprintf(buf, buf_len, info_format,
         info_1_,
         info_2_,
         info_3_);
 
-    *info_len = strlen(info_message_);
-    return info_message_;
+    if (n < 0 || n >= buf_len) {
+        return -1;
+    }
+    return n;
 }
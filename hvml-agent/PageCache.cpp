@@ -0,0 +1,353 @@
+#include "PageCache.h"
+
+#include "ace/Log_Msg.h"
+#include "ace/OS_NS_stdio.h"
+#include "ace/OS_NS_string.h"
+#include "ace/OS_NS_unistd.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#ifdef __linux__
+#include <sys/inotify.h>
+#endif
+
+// nanoseconds only where struct stat has them
+static struct timespec
+file_mtime (const struct stat& st)
+{
+#ifdef __linux__
+    return st.st_mtim;
+#else
+    struct timespec ts;
+    ts.tv_sec = st.st_mtime;
+    ts.tv_nsec = 0;
+    return ts;
+#endif
+}
+
+Page_Cache::Page_Cache (const char* doc_root)
+    : doc_root_ (doc_root)
+    , loads_ (0)
+    , inotify_ (ACE_INVALID_HANDLE)
+{
+    ACE_OS::memset (&stats_, 0, sizeof stats_);
+    while (doc_root_.size () > 1 && doc_root_[doc_root_.size () - 1] == '/')
+        doc_root_.erase (doc_root_.size () - 1);
+}
+
+Page_Cache::~Page_Cache (void)
+{
+    for (std::map<std::string, Page*>::iterator it = pages_.begin ();
+         it != pages_.end (); ++it)
+        this->unref (it->second);
+    pages_.clear ();
+
+    if (inotify_ != ACE_INVALID_HANDLE) {
+        // not left for the reactor to call once this is gone
+        if (this->reactor ())
+            this->reactor ()->remove_handler (this, ACE_Event_Handler::READ_MASK
+                                                    | ACE_Event_Handler::DONT_CALL);
+        ACE_OS::close (inotify_);
+    }
+}
+
+int
+Page_Cache::open (ACE_Reactor* reactor)
+{
+#ifdef __linux__
+    inotify_ = inotify_init1 (IN_NONBLOCK | IN_CLOEXEC);
+    if (inotify_ == ACE_INVALID_HANDLE) {
+        ACE_DEBUG ((LM_DEBUG, "inotify not available, validating pages by stat\n"));
+        return 0;
+    }
+
+    this->reactor (reactor);
+    if (this->reactor ()->register_handler (this, ACE_Event_Handler::READ_MASK) == -1) {
+        ACE_OS::close (inotify_);
+        inotify_ = ACE_INVALID_HANDLE;
+    }
+#else
+    ACE_UNUSED_ARG (reactor);
+#endif
+    return 0;
+}
+
+ACE_HANDLE
+Page_Cache::get_handle (void) const
+{
+    return inotify_;
+}
+
+int
+Page_Cache::handle_input (ACE_HANDLE)
+{
+#ifdef __linux__
+    char buf[4096] __attribute__ ((aligned (__alignof__ (struct inotify_event))));
+    ssize_t n;
+    while ((n = ACE_OS::read (inotify_, buf, sizeof buf)) > 0) {
+        const char* p = buf;
+        while (p < buf + n) {
+            const struct inotify_event* ev = (const struct inotify_event*)p;
+            p += sizeof (struct inotify_event) + ev->len;
+
+            ACE_GUARD_RETURN (ACE_Thread_Mutex, guard, lock_, 0);
+            std::map<int, std::string>::iterator w = watches_.find (ev->wd);
+            if (w == watches_.end ())
+                continue;
+            if (ev->mask & IN_IGNORED) {
+                watches_.erase (w);
+                continue;
+            }
+            if (ev->len == 0)
+                continue;
+            this->invalidate (w->second + "/" + ev->name);
+        }
+    }
+#endif
+    return 0;
+}
+
+int
+Page_Cache::handle_close (ACE_HANDLE, ACE_Reactor_Mask)
+{
+    return 0;
+}
+
+Page*
+Page_Cache::get (const char* target, int* status)
+{
+    std::string path;
+    if (this->resolve (target, path)) {
+        *status = 404;
+        return 0;
+    }
+
+    const bool validate = inotify_ == ACE_INVALID_HANDLE;
+
+    // a file written while it is parsed is parsed again, a few times at
+    // most; after that the last load is served, but not cached
+    for (int attempt = 0; ; ++attempt) {
+        struct stat st;
+        int stated = 1; // ::stat's result once called
+        unsigned long changes = 0;
+
+        {
+            ACE_GUARD_RETURN (ACE_Thread_Mutex, guard, lock_, 0);
+            std::map<std::string, Page*>::iterator it = pages_.find (path);
+            if (it != pages_.end ()) {
+                Page* page = it->second;
+                if (!validate) {
+                    ++page->refs_;
+                    return page;
+                }
+                stated = ::stat (path.c_str (), &st);
+                if (stated == 0 &&
+                    st.st_dev == page->dev_ && st.st_ino == page->ino_ &&
+                    file_mtime (st).tv_sec == page->mtime_.tv_sec &&
+                    file_mtime (st).tv_nsec == page->mtime_.tv_nsec &&
+                    st.st_size == page->size_) {
+                    ++page->refs_;
+                    return page;
+                }
+                this->invalidate (path);
+            }
+
+            // watched before the file is looked at, so that no change
+            // after that goes unnoticed
+            this->watch (path);
+            Loading& loading = loading_[path];
+            ++loading.loaders_;
+            changes = loading.changes_;
+        }
+
+        Page* page = 0;
+        if (stated == 1)
+            stated = ::stat (path.c_str (), &st);
+        if (stated || !S_ISREG (st.st_mode))
+            *status = 404;
+        // parse outside of the lock, misses on other pages go on meanwhile
+        else if (!(page = this->load (path, st)))
+            *status = 500;
+
+        ACE_GUARD_RETURN (ACE_Thread_Mutex, guard, lock_, 0);
+        std::map<std::string, Loading>::iterator l = loading_.find (path);
+        const bool stale = l->second.changes_ != changes;
+        if (--l->second.loaders_ == 0)
+            loading_.erase (l);
+
+        if (!page)
+            return 0;
+        if (stale) {
+            if (attempt < 2) {
+                this->unref (page);
+                continue;
+            }
+            // the caller's is the only reference
+            return page;
+        }
+
+        std::map<std::string, Page*>::iterator it = pages_.find (path);
+        if (it != pages_.end ()) {
+            // loaded by another thread meanwhile
+            this->unref (page);
+            page = it->second;
+        } else {
+            pages_[path] = page;
+        }
+        ++page->refs_;
+        return page;
+    }
+}
+
+void
+Page_Cache::release (Page* page)
+{
+    ACE_GUARD (ACE_Thread_Mutex, guard, lock_);
+    this->unref (page);
+}
+
+void
+Page_Cache::stats (hvml_parser_stats_t* stats, size_t* loads, size_t* pages)
+{
+    ACE_GUARD (ACE_Thread_Mutex, guard, lock_);
+    *stats = stats_;
+    *loads = loads_;
+    *pages = pages_.size ();
+}
+
+// map a request target to a file under the document root
+int
+Page_Cache::resolve (const char* target, std::string& path)
+{
+    if (target[0] != '/')
+        return -1;
+
+    size_t len = ACE_OS::strcspn (target, "?#");
+    std::string rel (target, len);
+    if (rel.find ("/../") != std::string::npos ||
+        (rel.size () >= 3 && rel.compare (rel.size () - 3, 3, "/..") == 0))
+        return -1;
+
+    path = doc_root_ + rel;
+    return 0;
+}
+
+Page*
+Page_Cache::load (const std::string& path, const struct stat& st)
+{
+    FILE* in = ACE_OS::fopen (path.c_str (), "rb");
+    if (!in)
+        return 0;
+
+    hvml_dom_gen_t* gen = hvml_dom_gen_create ();
+    if (!gen) {
+        ACE_OS::fclose (in);
+        return 0;
+    }
+    hvml_dom_gen_set_stats (gen, 1);
+
+    char buf[4096];
+    size_t n;
+    int ret = 0;
+    while (ret == 0 && (n = ACE_OS::fread (buf, 1, sizeof buf, in)) > 0)
+        ret = hvml_dom_gen_parse (gen, buf, n);
+    ACE_OS::fclose (in);
+
+    hvml_dom_t* dom = hvml_dom_gen_parse_end (gen);
+    if (ret && dom) {
+        hvml_dom_destroy (dom);
+        dom = 0;
+    }
+
+    hvml_parser_stats_t stats;
+    if (hvml_dom_gen_get_stats (gen, &stats) == 0) {
+        ACE_GUARD_RETURN (ACE_Thread_Mutex, guard, lock_, 0);
+        hvml_parser_stats_add (&stats_, &stats);
+        ++loads_;
+    }
+    hvml_dom_gen_destroy (gen);
+
+    if (!dom)
+        return 0;
+
+    char* body = 0;
+    size_t body_len = 0;
+    FILE* out = open_memstream (&body, &body_len);
+    if (!out) {
+        hvml_dom_destroy (dom);
+        return 0;
+    }
+    hvml_dom_printf (dom, out);
+    ACE_OS::fclose (out);
+
+    hvml_dom_tmpl_t* tmpl = hvml_dom_tmpl_create (dom);
+    if (!tmpl) {
+        hvml_dom_destroy (dom);
+        free (body);
+        return 0;
+    }
+
+    Page* page = new Page;
+    page->tmpl_ = tmpl;
+    page->body_ = body;
+    page->body_len_ = body_len;
+    page->dev_ = st.st_dev;
+    page->ino_ = st.st_ino;
+    page->mtime_ = file_mtime (st);
+    page->size_ = st.st_size;
+    page->refs_ = 1;
+    // nanoseconds tell apart two saves of the same size within a second
+    ACE_OS::snprintf (page->etag_, sizeof page->etag_, "\"%lx-%lx-%lx.%lx\"",
+                      (unsigned long)st.st_ino, (unsigned long)st.st_size,
+                      (unsigned long)page->mtime_.tv_sec,
+                      (unsigned long)page->mtime_.tv_nsec);
+    return page;
+}
+
+// lock held
+void
+Page_Cache::watch (const std::string& path)
+{
+#ifdef __linux__
+    if (inotify_ == ACE_INVALID_HANDLE)
+        return;
+
+    std::string dir = path.substr (0, path.rfind ('/'));
+    int wd = inotify_add_watch (inotify_, dir.c_str (),
+                                IN_CLOSE_WRITE | IN_MODIFY | IN_ATTRIB |
+                                IN_MOVED_FROM | IN_MOVED_TO | IN_DELETE);
+    if (wd >= 0)
+        watches_[wd] = dir;
+#else
+    ACE_UNUSED_ARG (path);
+#endif
+}
+
+// lock held
+void
+Page_Cache::invalidate (const std::string& path)
+{
+    std::map<std::string, Loading>::iterator l = loading_.find (path);
+    if (l != loading_.end ())
+        ++l->second.changes_;
+
+    std::map<std::string, Page*>::iterator it = pages_.find (path);
+    if (it == pages_.end ())
+        return;
+    ACE_DEBUG ((LM_DEBUG, "page changed: %s\n", path.c_str ()));
+    this->unref (it->second);
+    pages_.erase (it);
+}
+
+// lock held
+void
+Page_Cache::unref (Page* page)
+{
+    if (--page->refs_ > 0)
+        return;
+    hvml_dom_tmpl_unref (page->tmpl_);
+    free (page->body_);
+    delete page;
+}
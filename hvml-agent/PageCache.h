@@ -0,0 +1,84 @@
+#pragma once
+
+#include "ace/Event_Handler.h"
+#include "ace/Reactor.h"
+#include "ace/Synch.h"
+
+#include "hvml/hvml_dom.h"
+
+#include <sys/types.h>
+
+#include <map>
+#include <string>
+
+/// A loaded page: the parsed template plus its rendered bytes,
+/// reference counted by the cache and the requests being answered.
+class Page
+{
+public:
+    hvml_dom_tmpl_t* tmpl_;
+    char* body_;
+    size_t body_len_;
+    char etag_[64];
+
+    dev_t dev_;
+    ino_t ino_;
+    struct timespec mtime_;
+    off_t size_;
+
+    int refs_;
+};
+
+/// Pages of a document root, parsed once and kept until the file changes.
+///
+/// On Linux the cache watches the directories of loaded files with
+/// inotify and drops a page as soon as its file is written, moved or
+/// removed, so a hit costs no syscall. Elsewhere, or if inotify is not
+/// available, every hit is checked against the file's inode and mtime.
+class Page_Cache : public ACE_Event_Handler
+{
+public:
+    Page_Cache (const char* doc_root);
+    virtual ~Page_Cache (void);
+
+    /// start watching for changes, events are dispatched by `reactor`
+    int open (ACE_Reactor* reactor);
+
+    /// the page for a request target, with a reference held for the
+    /// caller; 0 with `*status` set to the http status otherwise
+    Page* get (const char* target, int* status);
+    void release (Page* page);
+
+    /// parser stats summed over every page loaded so far
+    void stats (hvml_parser_stats_t* stats, size_t* loads, size_t* pages);
+
+    virtual ACE_HANDLE get_handle (void) const;
+    virtual int handle_input (ACE_HANDLE handle);
+    virtual int handle_close (ACE_HANDLE handle,
+                              ACE_Reactor_Mask close_mask);
+
+private:
+    int resolve (const char* target, std::string& path);
+    Page* load (const std::string& path, const struct stat& st);
+    void watch (const std::string& path);
+    void invalidate (const std::string& path);
+    void unref (Page* page);
+
+    /// a path being parsed outside of the lock: by how many threads, and
+    /// how many times it was invalidated since, to tell stale loads
+    struct Loading
+    {
+        int loaders_;
+        unsigned long changes_;
+    };
+
+    std::string doc_root_;
+    ACE_Thread_Mutex lock_;
+    std::map<std::string, Page*> pages_;
+    std::map<std::string, Loading> loading_;
+    hvml_parser_stats_t stats_;
+    size_t loads_;
+
+    ACE_HANDLE inotify_;
+    std::map<int, std::string> watches_;
+};
@@ -1,12 +1,54 @@
 #include "ace/Log_Msg.h"
 #include "HttpEcho.h"
 #include "MyInfo.h"
+#include "PageCache.h"
 
-int ACE_TMAIN(int argc, char* argv[])
+static void usage (const ACE_TCHAR* prog)
 {
-    MyInfo info(20000);
-    HttpEcho::StartServer(&info);
-    ACE_DEBUG((LM_DEBUG, ACE_TEXT("Start HttpEcho, PORT: 20000\n")));
+    ACE_ERROR ((LM_ERROR,
+                ACE_TEXT ("usage: %s [-p port] [-n worker_threads] [-d doc_root]\n"),
+                prog));
+}
+
+int ACE_TMAIN(int argc, ACE_TCHAR* argv[])
+{
+    int port = 20000;
+    const ACE_TCHAR* doc_root = 0;
+    // one worker per core by default
+    int n_workers = (int)ACE_OS::num_processors_online ();
+    if (n_workers < 1)
+        n_workers = 1;
+
+    ACE_Get_Opt get_opt (argc, argv, ACE_TEXT ("p:n:d:"));
+    int opt;
+    while ((opt = get_opt ()) != -1) {
+        switch (opt) {
+        case 'p':
+            port = ACE_OS::atoi (get_opt.opt_arg ());
+            break;
+        case 'n':
+            n_workers = ACE_OS::atoi (get_opt.opt_arg ());
+            break;
+        case 'd':
+            doc_root = get_opt.opt_arg ();
+            break;
+        default:
+            usage (argv[0]);
+            return 1;
+        }
+    }
+    if (port <= 0 || n_workers <= 0) {
+        usage (argv[0]);
+        return 1;
+    }
+
+    MyInfo info(port);
+    Page_Cache* cache = 0;
+    if (doc_root)
+        cache = new Page_Cache(doc_root);
+    HttpEcho::StartServer(&info, cache, n_workers);
+    ACE_DEBUG((LM_DEBUG, ACE_TEXT("Start HttpEcho, PORT: %d, WORKERS: %d\n"),
+               port, n_workers));
 
     printf("Press 'q' and ENTER to Exit\n");
 
@@ -22,6 +64,7 @@ int ACE_TMAIN(int argc, char* argv[])
     }
 
     HttpEcho::StopServer();
+    delete cache;
     ACE_DEBUG((LM_DEBUG, ACE_TEXT("Stop HttpEcho\n")));
     return 0;
 }
@@ -19,6 +19,8 @@
 #define _hvml_dom_h_
 
 #include "hvml/hvml_jo.h"
+#include "hvml/hvml_jo_cow.h"
+#include "hvml/hvml_parser_stats.h"
 
 #include <stddef.h>
 #include <stdio.h>
@@ -39,6 +41,8 @@ typedef enum {
 
 typedef struct hvml_dom_s          hvml_dom_t;
 typedef struct hvml_dom_gen_s      hvml_dom_gen_t;
+typedef struct hvml_dom_tmpl_s     hvml_dom_tmpl_t;
+typedef struct hvml_dom_pos_s      hvml_dom_pos_t;
 
 typedef struct traverse_callback_s {
     // all callback-funcs just mean as name implies
@@ -70,6 +74,20 @@ hvml_dom_t* hvml_dom_parent(hvml_dom_t *dom);
 hvml_dom_t* hvml_dom_next(hvml_dom_t *dom);
 hvml_dom_t* hvml_dom_prev(hvml_dom_t *dom);
 
+// read access to a node
+HVML_DOM_TYPE    hvml_dom_type(hvml_dom_t *dom);
+hvml_dom_t*      hvml_dom_first_child(hvml_dom_t *dom);
+hvml_dom_t*      hvml_dom_first_attr(hvml_dom_t *dom);
+hvml_dom_t*      hvml_dom_next_attr(hvml_dom_t *dom);
+// tag name of a tag, or key of an attr
+const char*      hvml_dom_name(hvml_dom_t *dom, size_t *len);
+// val of an attr (NULL if it has none), or content of a text
+const char*      hvml_dom_value(hvml_dom_t *dom, size_t *len);
+hvml_jo_value_t* hvml_dom_jo(hvml_dom_t *dom);
+// source span of an element parsed from text: byte offsets of its '<'
+// and past its last '>'; -1 if not an element
+int              hvml_dom_span(hvml_dom_t *dom, size_t *start, size_t *end);
+
 void        hvml_dom_detach(hvml_dom_t *dom);
 
 hvml_dom_t* hvml_dom_select(hvml_dom_t *dom, const char *selector);
@@ -81,15 +99,71 @@ void        hvml_dom_printf(hvml_dom_t *dom, FILE *out);
 
 void        hvml_dom_traverse(hvml_dom_t *dom, FILE *out, traverse_callback *out_funcs);
 
+// a template is a loaded page which is never modified once created,
+// thus can be shared and rendered by many threads at the same time.
+// per-session mutable state is forked from the template's `init` data.
+
+// take over the ownership of `dom`, with reference count of 1
+hvml_dom_tmpl_t*  hvml_dom_tmpl_create(hvml_dom_t *dom);
+// reference counting, thread-safe
+hvml_dom_tmpl_t*  hvml_dom_tmpl_ref(hvml_dom_tmpl_t *tmpl);
+void              hvml_dom_tmpl_unref(hvml_dom_tmpl_t *tmpl);
+// the dom held by the template, shall be treated as read-only
+hvml_dom_t*       hvml_dom_tmpl_dom(hvml_dom_tmpl_t *tmpl);
+// # of `init` elements with `as` attribute and json content
+size_t            hvml_dom_tmpl_inits(hvml_dom_tmpl_t *tmpl);
+// fork the session state: an object with one k/v per `init`, keyed by `as`,
+// valued by a private copy of the init's json data
+hvml_jo_value_t*  hvml_dom_tmpl_fork_inits(hvml_dom_tmpl_t *tmpl);
+// the same session state, frozen once per template and shared: a new
+// reference to it, which sessions update by path copying, see hvml_jo_cow.h
+hvml_jo_cow_t*    hvml_dom_tmpl_share_inits(hvml_dom_tmpl_t *tmpl);
+
 hvml_dom_gen_t*   hvml_dom_gen_create();
 void              hvml_dom_gen_destroy(hvml_dom_gen_t *gen);
+// drop what is parsed so far, ready for the next document, keeping
+// the parser's buffers allocated
+void              hvml_dom_gen_reset(hvml_dom_gen_t *gen);
+// a ready generator from the calling thread's pool, or a new one;
+// release puts it back reset, with stats and positions disabled
+hvml_dom_gen_t*   hvml_dom_gen_acquire();
+void              hvml_dom_gen_release(hvml_dom_gen_t *gen);
 
 int               hvml_dom_gen_parse_char(hvml_dom_gen_t *gen, const char c);
 int               hvml_dom_gen_parse(hvml_dom_gen_t *gen, const char *buf, size_t len);
 int               hvml_dom_gen_parse_string(hvml_dom_gen_t *gen, const char *str);
 hvml_dom_t*       hvml_dom_gen_parse_end(hvml_dom_gen_t *gen);
 
+// stats of the underlying parser, see hvml_parser_set_stats
+int               hvml_dom_gen_set_stats(hvml_dom_gen_t *gen, int enable);
+int               hvml_dom_gen_get_stats(hvml_dom_gen_t *gen, hvml_parser_stats_t *stats);
+
+// record the source positions of the nodes of the documents parsed from
+// now on, see hvml_dom_pos.h, or stop recording
+int               hvml_dom_gen_set_positions(hvml_dom_gen_t *gen, int enable);
+// the positions of the document last returned by hvml_dom_gen_parse_end,
+// owned by the caller; NULL if not recorded
+hvml_dom_pos_t*   hvml_dom_gen_take_positions(hvml_dom_gen_t *gen);
+
 hvml_dom_t*       hvml_dom_load_from_stream(FILE *in);
+// load from a file, memory-mapped if it is a regular one
+hvml_dom_t*       hvml_dom_load_from_file(const char *file);
+// load `count` files on `threads` threads (0 for one per cpu), in no
+// particular order; doms[i] is the document of files[i] or NULL, errs[i]
+// is 0, errno if the file could not be opened, or -1 if it failed to
+// parse. return the number of files failed
+int               hvml_dom_load_many(const char **files, size_t count, int threads,
+                                     hvml_dom_t **doms, int *errs);
+
+// re-parse `dom`, a document parsed from text, after `deleted` bytes at
+// `offset` of the text were replaced by `inserted` bytes, `text` being the
+// whole edited text. only the smallest element enclosing the edit that
+// parses on its own is re-parsed and spliced in, the nodes out of it are
+// kept, with their spans moved. return the edited document, which is a
+// new one, `dom` destroyed, if the whole text had to be re-parsed; or
+// NULL, `dom` left as it was, if the edited text fails to parse
+hvml_dom_t*       hvml_dom_reparse(hvml_dom_t *dom, const char *text, size_t len,
+                                   size_t offset, size_t deleted, size_t inserted);
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,61 @@
+// This file is a part of Purring Cat, a reference implementation of HVML.
+//
+// Copyright (C) 2020, <freemine@yeah.net>.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+
+#ifndef _hvml_dom_pos_h_
+#define _hvml_dom_pos_h_
+
+#include "hvml/hvml_dom.h"
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// source positions of the nodes of a parsed document, kept aside so that
+// nodes don't grow: the byte offset where each node starts, by node
+// ordinal, delta-encoded. lines and columns are worked out on demand from
+// an index of line starts, built from the source text on first use.
+// nodes are numbered in document order, a tag before its attributes and
+// those before its children, the root being 0.
+
+hvml_dom_pos_t*  hvml_dom_pos_create(void);
+void             hvml_dom_pos_destroy(hvml_dom_pos_t *pos);
+// forget all, keeping the buffers
+void             hvml_dom_pos_reset(hvml_dom_pos_t *pos);
+
+// record where the next node starts, 0 on success
+int              hvml_dom_pos_append(hvml_dom_pos_t *pos, size_t offset);
+
+size_t           hvml_dom_pos_count(hvml_dom_pos_t *pos);
+// where node `ordinal` starts, -1 if no such node
+int              hvml_dom_pos_offset(hvml_dom_pos_t *pos, size_t ordinal, size_t *offset);
+// 1-based line and byte column of `offset` in `text`, the source the
+// positions were recorded from; -1 if out of it
+int              hvml_dom_pos_line_col(hvml_dom_pos_t *pos, const char *text, size_t len,
+                                       size_t offset, size_t *line, size_t *col);
+
+// ordinal of `node` in the document rooted at `root`, (size_t)-1 if not in it
+size_t           hvml_dom_ordinal(hvml_dom_t *root, hvml_dom_t *node);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // _hvml_dom_pos_h_
+
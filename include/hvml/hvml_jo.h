@@ -18,6 +18,8 @@
 #ifndef _hvml_jo_h_
 #define _hvml_jo_h_
 
+#include "hvml/hvml_parser_stats.h"
+
 #include <stdint.h>
 #include <stdio.h>
 
@@ -41,6 +43,9 @@ typedef enum {
 
 typedef struct hvml_jo_value_s         hvml_jo_value_t;
 typedef struct hvml_jo_gen_s           hvml_jo_gen_t;
+typedef struct hvml_jo_symtab_s        hvml_jo_symtab_t;
+typedef struct hvml_jo_shape_s         hvml_jo_shape_t;
+typedef struct hvml_jo_column_s        hvml_jo_column_t;
 
 // generate a specific json value on the heap
 hvml_jo_value_t* hvml_jo_true();
@@ -53,6 +58,17 @@ hvml_jo_value_t* hvml_jo_object();
 hvml_jo_value_t* hvml_jo_array();
 hvml_jo_value_t* hvml_jo_object_kv(const char *key, size_t len);
 
+// a symbol table of object keys: the object_kv's interned in one share a
+// single copy of each key, hashed once. keys are reference counted, the
+// table only holds a reference to them, so that values outlive it.
+// generators intern the keys of each document they build this way
+hvml_jo_symtab_t* hvml_jo_symtab_create();
+void             hvml_jo_symtab_destroy(hvml_jo_symtab_t *symtab);
+// drop all keys, keeping the table allocated
+void             hvml_jo_symtab_reset(hvml_jo_symtab_t *symtab);
+// generate an object_kv with its key interned in `symtab`
+hvml_jo_value_t* hvml_jo_object_kv_interned(hvml_jo_symtab_t *symtab, const char *key, size_t len);
+
 
 // if jo is of array, append val into array jo
 // if jo is of object, val shall be of object_kv, append val as object jo's kv
@@ -60,6 +76,39 @@ hvml_jo_value_t* hvml_jo_object_kv(const char *key, size_t len);
 // otherwise, failed with -1
 int              hvml_jo_value_push(hvml_jo_value_t *jo, hvml_jo_value_t *val);
 
+// the object_kv of object jo with key `key`, NULL if none
+hvml_jo_value_t* hvml_jo_object_get_kv_by_key(hvml_jo_value_t *jo, const char *key, size_t len);
+
+// the shape of an object: its keys in order, shared by a run of sibling
+// objects of an array having the same keys, as generators build them.
+// give object jo the shape of its previous sibling if their keys are the
+// same, a new one shared by both if that has none, or none; -1 if out of
+// memory. any change to the keys of an object drops its shape
+int                    hvml_jo_object_reshape(hvml_jo_value_t *jo);
+// the shape of object jo, NULL if it has none
+const hvml_jo_shape_t* hvml_jo_object_shape(hvml_jo_value_t *jo);
+size_t                 hvml_jo_shape_count(const hvml_jo_shape_t *shape);
+const char*            hvml_jo_shape_key(const hvml_jo_shape_t *shape, size_t idx, size_t *len);
+
+// the object_kv's of one key across the objects of an array: where the key
+// is in a shape is found once per shape, the objects of it take no key
+// compares; objects without one are searched by key
+struct hvml_jo_column_s {
+    const char            *key;
+    size_t                 len;
+    uint64_t               hash;
+    hvml_jo_shape_t       *shape;     // held till release
+    size_t                 index;
+};
+
+void             hvml_jo_column_init(hvml_jo_column_t *col, const char *key, size_t len);
+void             hvml_jo_column_release(hvml_jo_column_t *col);
+// the object_kv of object jo with the column's key, NULL if none
+hvml_jo_value_t* hvml_jo_column_get(hvml_jo_column_t *col, hvml_jo_value_t *jo);
+
+
+// deep copy a json value, the copy is orphan and owns all its children
+hvml_jo_value_t* hvml_jo_value_clone(hvml_jo_value_t *jo);
 
 // detach a json value from it's parent
 void             hvml_jo_value_detach(hvml_jo_value_t *jo);
@@ -78,6 +127,31 @@ hvml_jo_value_t* hvml_jo_value_root(hvml_jo_value_t *jo);
 
 // return # of json value's children
 size_t           hvml_jo_value_children(hvml_jo_value_t *jo);
+// return the first child: the first member of an array or object,
+// or the val-part of an object_kv
+hvml_jo_value_t* hvml_jo_value_first(hvml_jo_value_t *jo);
+// return the next sibling of the json value
+hvml_jo_value_t* hvml_jo_value_next(hvml_jo_value_t *jo);
+
+// content of numbers: whether it's an integer, its value, and the text
+// it was parsed from, NULL if that is the canonical text
+int              hvml_jo_value_is_integer(hvml_jo_value_t *jo);
+int64_t          hvml_jo_value_integer(hvml_jo_value_t *jo);
+double           hvml_jo_value_double(hvml_jo_value_t *jo);
+const char*      hvml_jo_value_origin(hvml_jo_value_t *jo);
+// content of a string, or the key of an object_kv
+const char*      hvml_jo_value_str(hvml_jo_value_t *jo, size_t *len);
+
+// the canonical text of a number: for an integer, its decimal digits,
+// for a double, the first of %.15g, %.16g and %.17g that reads back the
+// same; return its length, as snprintf does
+size_t           hvml_jo_number_canonical(int integer, int64_t v_i, double v_d, char *buf, size_t len);
+
+// hash the content of the json value, equal json values hash the same
+// useful as identity of data items when caching what was generated from them
+uint64_t         hvml_jo_value_hash(hvml_jo_value_t *jo);
+// 1 if both json values are of the same type and content, 0 otherwise
+int              hvml_jo_value_equal(hvml_jo_value_t *l, hvml_jo_value_t *r);
 
 // serialize the json value to the file stream, with `escape` if necessary
 void             hvml_jo_value_printf(hvml_jo_value_t *jo, FILE *out);
@@ -86,6 +160,13 @@ void             hvml_jo_value_printf(hvml_jo_value_t *jo, FILE *out);
 hvml_jo_gen_t*   hvml_jo_gen_create();
 // destroy the `generator`
 void             hvml_jo_gen_destroy(hvml_jo_gen_t *gen);
+// drop what is parsed so far, ready for the next document, keeping
+// the parser's buffers allocated
+void             hvml_jo_gen_reset(hvml_jo_gen_t *gen);
+// a ready generator from the calling thread's pool, or a new one;
+// release puts it back reset, with stats disabled
+hvml_jo_gen_t*   hvml_jo_gen_acquire();
+void             hvml_jo_gen_release(hvml_jo_gen_t *gen);
 
 // pump string stream into the `generator` to build a json value on the fly
 int              hvml_jo_gen_parse_char(hvml_jo_gen_t *gen, const char c);
@@ -96,8 +177,22 @@ int              hvml_jo_gen_parse_string(hvml_jo_gen_t *gen, const char *str);
 // if the string stream fails to denote a `well-formed` json value, NULL would be returned
 hvml_jo_value_t* hvml_jo_gen_parse_end(hvml_jo_gen_t *gen);
 
+// stats of the underlying json parser, see hvml_json_parser_set_stats
+int              hvml_jo_gen_set_stats(hvml_jo_gen_t *gen, int enable);
+int              hvml_jo_gen_get_stats(hvml_jo_gen_t *gen, hvml_parser_stats_t *stats);
+
 // load a json value from file stream
 hvml_jo_value_t* hvml_jo_value_load_from_stream(FILE *in);
+// load a json value from a file, memory-mapped if it is a regular one
+hvml_jo_value_t* hvml_jo_value_load_from_file(const char *file);
+// load a json value from memory; a top-level array or object of 1MB or
+// more is parsed with hvml_jo_value_parse_parallel
+hvml_jo_value_t* hvml_jo_value_load_from_buffer(const char *buf, size_t len);
+// split the members of a top-level array or object into runs at its
+// top-level commas and build the runs on `threads` threads (0 for one per
+// cpu), stitching them back in order; anything else, or a text failing
+// to parse, goes through the serial parser
+hvml_jo_value_t* hvml_jo_value_parse_parallel(const char *buf, size_t len, int threads);
 
 #ifdef __cplusplus
 }
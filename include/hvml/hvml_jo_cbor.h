@@ -0,0 +1,60 @@
+// This file is a part of Purring Cat, a reference implementation of HVML.
+//
+// Copyright (C) 2020, <freemine@yeah.net>.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#ifndef _hvml_jo_cbor_h_
+#define _hvml_jo_cbor_h_
+
+#include "hvml/hvml_jo.h"
+
+#include <stddef.h>
+#include <stdio.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// json values encoded as CBOR (RFC 8949), with definite lengths only:
+// integers as major types 0/1, doubles as 64-bit floats, strings and
+// keys as text strings, arrays and objects as arrays and maps.
+//
+// a number keeping its origin, one that is not its canonical text (see
+// hvml_jo_number_canonical), is wrapped as tag HVML_JO_CBOR_TAG_ORIGIN
+// over [number, origin], so that it prints the same after a round trip.
+
+#define HVML_JO_CBOR_TAG_ORIGIN       26742
+
+typedef struct hvml_jo_cbor_dec_s     hvml_jo_cbor_dec_t;
+
+// encode the json value to the file stream, 0 on success
+int                  hvml_jo_cbor_write(hvml_jo_value_t *jo, FILE *out);
+
+// a decoder builds a json value from CBOR pumped in chunks of any size,
+// same as hvml_jo_gen_t does from json text
+hvml_jo_cbor_dec_t*  hvml_jo_cbor_dec_create();
+void                 hvml_jo_cbor_dec_destroy(hvml_jo_cbor_dec_t *dec);
+int                  hvml_jo_cbor_dec_parse(hvml_jo_cbor_dec_t *dec, const char *buf, size_t len);
+// the decoded value, NULL unless exactly one complete item was pumped in
+hvml_jo_value_t*     hvml_jo_cbor_dec_parse_end(hvml_jo_cbor_dec_t *dec);
+
+// load a json value from a CBOR encoded file stream
+hvml_jo_value_t*     hvml_jo_cbor_load_from_stream(FILE *in);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // _hvml_jo_cbor_h_
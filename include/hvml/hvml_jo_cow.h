@@ -0,0 +1,94 @@
+// This file is a part of Purring Cat, a reference implementation of HVML.
+//
+// Copyright (C) 2020, <freemine@yeah.net>.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+
+#ifndef _hvml_jo_cow_h_
+#define _hvml_jo_cow_h_
+
+#include "hvml/hvml_jo.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// persistent json values: immutable, reference counted nodes, which
+// many versions of a document share. forking a version is taking a
+// reference to it; an update copies the nodes from the root down to the
+// member updated, and shares all else with the version it applies to.
+// hvml_jo_value_t nodes belong to the one list they are linked in, so
+// they are frozen into these to be shared, and thawed back when a
+// mutable tree is wanted.
+// references may be taken and dropped from any thread.
+
+typedef struct hvml_jo_cow_s           hvml_jo_cow_t;
+typedef struct hvml_jo_cow_step_s      hvml_jo_cow_step_t;
+
+// a step down a path: the member `key` of an object, or if `key` is
+// NULL, the member `index` of an array
+struct hvml_jo_cow_step_s {
+    const char         *key;
+    size_t              len;
+    size_t              index;
+};
+
+// an immutable copy of `jo`, which must not be an object_kv
+hvml_jo_cow_t*   hvml_jo_cow_freeze(hvml_jo_value_t *jo);
+// a mutable deep copy of `v`, orphan
+hvml_jo_value_t* hvml_jo_cow_thaw(hvml_jo_cow_t *v);
+
+// take one more reference to `v`, forking it in O(1)
+hvml_jo_cow_t*   hvml_jo_cow_ref(hvml_jo_cow_t *v);
+void             hvml_jo_cow_unref(hvml_jo_cow_t *v);
+
+HVML_JO_TYPE     hvml_jo_cow_type(hvml_jo_cow_t *v);
+// # of members of an array or object, 0 otherwise
+size_t           hvml_jo_cow_count(hvml_jo_cow_t *v);
+// the member `i` of an array or object, and its key if of an object;
+// borrowed from `v`, NULL if no such member
+hvml_jo_cow_t*   hvml_jo_cow_at(hvml_jo_cow_t *v, size_t i);
+const char*      hvml_jo_cow_key_at(hvml_jo_cow_t *v, size_t i, size_t *len);
+// the member `key` of an object, borrowed from `v`, NULL if none
+hvml_jo_cow_t*   hvml_jo_cow_get(hvml_jo_cow_t *v, const char *key, size_t len);
+// the value at the end of `path`, borrowed from `v`, NULL if none
+hvml_jo_cow_t*   hvml_jo_cow_find(hvml_jo_cow_t *v, const hvml_jo_cow_step_t *path, size_t depth);
+
+int              hvml_jo_cow_is_integer(hvml_jo_cow_t *v);
+int64_t          hvml_jo_cow_integer(hvml_jo_cow_t *v);
+double           hvml_jo_cow_double(hvml_jo_cow_t *v);
+const char*      hvml_jo_cow_str(hvml_jo_cow_t *v, size_t *len);
+
+// a new version of `root` with the value at the end of `path` set to
+// `val`: the member of an object is added if there is none of that key,
+// and so is the member of an array if `index` is its # of members.
+// the new version holds a reference to `val` and shares the rest with
+// `root`, which is left as it was; NULL if some step of `path` is not
+// there, or out of memory
+hvml_jo_cow_t*   hvml_jo_cow_set(hvml_jo_cow_t *root, const hvml_jo_cow_step_t *path,
+                                 size_t depth, hvml_jo_cow_t *val);
+// a new version of `root` without the value at the end of `path`
+hvml_jo_cow_t*   hvml_jo_cow_remove(hvml_jo_cow_t *root, const hvml_jo_cow_step_t *path,
+                                    size_t depth);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // _hvml_jo_cow_h_
+
@@ -0,0 +1,68 @@
+// This file is a part of Purring Cat, a reference implementation of HVML.
+//
+// Copyright (C) 2020, <freemine@yeah.net>.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#ifndef _hvml_jo_query_h_
+#define _hvml_jo_query_h_
+
+#include "hvml/hvml_jo.h"
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// a subset of JSONPath evaluated on the fly over json text, without
+// building the document: `$` followed by steps of `.key`, `['key']`,
+// `[index]`, and `.*` or `[*]` for any member. only the values matched
+// are built, one at a time; values off the path are passed over by the
+// parser's skip mode, so memory doesn't grow with the document.
+//
+// e.g. `$.items[*].id` matches the member `id` of each element of the
+// array `items` of the top-level object
+
+typedef struct hvml_jo_query_s          hvml_jo_query_t;
+
+// called with each value matched, in document order, freed once it
+// returns; non-zero stops the query, failing the parse with it
+typedef int (*hvml_jo_query_on_match)(void *arg, hvml_jo_value_t *val);
+
+// NULL if `path` is malformed
+hvml_jo_query_t*  hvml_jo_query_create(const char *path, hvml_jo_query_on_match on_match, void *arg);
+void              hvml_jo_query_destroy(hvml_jo_query_t *query);
+// ready for the next document, same path
+void              hvml_jo_query_reset(hvml_jo_query_t *query);
+
+// pump json text into the query, in chunks of any size
+int               hvml_jo_query_parse(hvml_jo_query_t *query, const char *buf, size_t len);
+// 0 if the text was a json value; values passed over are only checked
+// structurally, see HVML_JSON_PARSER_SKIP
+int               hvml_jo_query_parse_end(hvml_jo_query_t *query);
+
+// # of values matched so far
+size_t            hvml_jo_query_matches(hvml_jo_query_t *query);
+
+// run the query over a file, memory-mapped if it is a regular one
+int               hvml_jo_query_file(const char *path, const char *file,
+                                     hvml_jo_query_on_match on_match, void *arg);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // _hvml_jo_query_h_
+
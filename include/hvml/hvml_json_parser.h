@@ -22,10 +22,19 @@
 #include <stdint.h>
 #include <stdio.h>
 
+#include "hvml/hvml_parser_stats.h"
+
 #ifdef __cplusplus
 extern "C" {
 #endif
 
+// returned by on_key to pass over the value of the key, or by on_open_obj
+// and on_open_array to pass over the rest of the container, its closing
+// bracket included. no callbacks fire for what is passed over, and it is
+// only checked structurally: brackets matched by kind, strings closed and
+// a value present; scalars such as `tru` are not looked into
+#define HVML_JSON_PARSER_SKIP                    2
+
 typedef struct hvml_json_parser_s                hvml_json_parser_t;
 typedef struct hvml_json_parser_conf_s           hvml_json_parser_conf_t;
 
@@ -74,6 +83,11 @@ int                 hvml_json_parser_is_ending(hvml_json_parser_t *parser);
 // useful only when initializing `embedded-json-fragment-parser`
 void                hvml_json_parser_set_offset(hvml_json_parser_t *parser, size_t line, size_t col);
 
+// collect stats from now on, or stop collecting and drop them
+int                 hvml_json_parser_set_stats(hvml_json_parser_t *parser, int enable);
+// -1 if stats are not enabled
+int                 hvml_json_parser_get_stats(hvml_json_parser_t *parser, hvml_parser_stats_t *stats);
+
 // serializing `str` as a json string
 void                hvml_json_str_printf(FILE *out, const char *s, size_t len);
 
@@ -25,20 +25,55 @@
 extern "C" {
 #endif
 
+#define HVML_LOG_LEVEL_V    0
+#define HVML_LOG_LEVEL_D    1
+#define HVML_LOG_LEVEL_I    2
+#define HVML_LOG_LEVEL_W    3
+#define HVML_LOG_LEVEL_E    4
+
+// calls below this level are compiled out, define it to
+// HVML_LOG_LEVEL_I or so for release builds
+#ifndef HVML_LOG_LEVEL
+#define HVML_LOG_LEVEL      HVML_LOG_LEVEL_V
+#endif
+
+// runtime threshold set by hvml_log_set_level, checked before any
+// argument of a log call is evaluated
+extern int hvml_log_min_level;
+
+#define HVML_LOG_ON(lv)                                                         \
+    (HVML_LOG_LEVEL_##lv >= HVML_LOG_LEVEL &&                                   \
+     HVML_LOG_LEVEL_##lv >= __atomic_load_n(&hvml_log_min_level, __ATOMIC_RELAXED))
+
 // set typename of the calling thread, which would be printed in log funcs
 void hvml_log_set_thread_type(const char *type);
 // if set, no prefix/surfix part would be printed in log funcs
 void hvml_log_set_output_only(int set);
+// records below `level` are dropped, in the order V, D, I, W, E, A
+void hvml_log_set_level(const char level);
+// if set, records are queued per thread and written by a background
+// thread, callers never wait on the output stream; 'A' is always
+// written synchronously, after what is still queued
+int  hvml_log_set_async(int set);
+// wait until the records queued so far have been written
+void hvml_log_flush(void);
 
 void hvml_log_printf(const char *cfile, int cline, const char *cfunc, FILE *out, const char level, const char *fmt, ...)
 __attribute__ ((format (printf, 6, 7)));
 
 
-#define D(fmt, ...) hvml_log_printf(__FILE__, __LINE__, __FUNCTION__, stderr, 'D', fmt, ##__VA_ARGS__)
-#define I(fmt, ...) hvml_log_printf(__FILE__, __LINE__, __FUNCTION__, stderr, 'I', fmt, ##__VA_ARGS__)
-#define W(fmt, ...) hvml_log_printf(__FILE__, __LINE__, __FUNCTION__, stderr, 'W', fmt, ##__VA_ARGS__)
-#define E(fmt, ...) hvml_log_printf(__FILE__, __LINE__, __FUNCTION__, stderr, 'E', fmt, ##__VA_ARGS__)
-#define V(fmt, ...) hvml_log_printf(__FILE__, __LINE__, __FUNCTION__, stderr, 'V', fmt, ##__VA_ARGS__)
+#define HVML_LOG(lv, fmt, ...)                                                  \
+do {                                                                            \
+    if (!HVML_LOG_ON(lv)) break;                                                \
+    hvml_log_printf(__FILE__, __LINE__, __FUNCTION__, stderr, #lv[0],           \
+                    fmt, ##__VA_ARGS__);                                        \
+} while (0)
+
+#define D(fmt, ...) HVML_LOG(D, fmt, ##__VA_ARGS__)
+#define I(fmt, ...) HVML_LOG(I, fmt, ##__VA_ARGS__)
+#define W(fmt, ...) HVML_LOG(W, fmt, ##__VA_ARGS__)
+#define E(fmt, ...) HVML_LOG(E, fmt, ##__VA_ARGS__)
+#define V(fmt, ...) HVML_LOG(V, fmt, ##__VA_ARGS__)
 #define A(statement, fmt, ...)                                                  \
 do {                                                                            \
     if (statement) break;                                                       \
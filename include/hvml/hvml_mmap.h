@@ -0,0 +1,46 @@
+// This file is a part of Purring Cat, a reference implementation of HVML.
+//
+// Copyright (C) 2020, <freemine@yeah.net>.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#ifndef _hvml_mmap_h_
+#define _hvml_mmap_h_
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct hvml_mmap_s            hvml_mmap_t;
+
+// a regular file mapped read-only, advised for sequential access
+struct hvml_mmap_s {
+    const char         *buf;
+    size_t              len;
+};
+
+// -1 with errno set if `file` can't be opened, or -2 if it is not a
+// regular file or can't be mapped, in which case reading it as a
+// stream is the way to go
+int  hvml_mmap_open(hvml_mmap_t *map, const char *file);
+void hvml_mmap_close(hvml_mmap_t *map);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // _hvml_mmap_h_
+
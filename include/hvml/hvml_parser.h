@@ -21,6 +21,8 @@
 #include <stddef.h>
 #include <stdint.h>
 
+#include "hvml/hvml_parser_stats.h"
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -67,6 +69,23 @@ int            hvml_parser_parse_char(hvml_parser_t *parser, const char c);
 int            hvml_parser_parse(hvml_parser_t *parser, const char *buf, size_t len);
 int            hvml_parser_parse_string(hvml_parser_t *parser, const char *str);
 int            hvml_parser_parse_end(hvml_parser_t *parser);
+// get ready for the next document, keeping internal buffers allocated
+void           hvml_parser_reset(hvml_parser_t *parser);
+
+// byte offset of the char being parsed; within callbacks, of the char
+// triggering them, which for on_close_tag is the '>' ending the element
+size_t         hvml_parser_offset(hvml_parser_t *parser);
+// byte offset of the '<' opening the markup being parsed; within
+// on_open_tag, where the element starts
+size_t         hvml_parser_markup_offset(hvml_parser_t *parser);
+// byte offset of the first char of the token being parsed; within
+// on_attr_key and on_text, where the attribute or the text starts
+size_t         hvml_parser_token_offset(hvml_parser_t *parser);
+
+// collect stats from now on, or stop collecting and drop them
+int            hvml_parser_set_stats(hvml_parser_t *parser, int enable);
+// stats of the parser and its embedded json parser; -1 if not enabled
+int            hvml_parser_get_stats(hvml_parser_t *parser, hvml_parser_stats_t *stats);
 
 #ifdef __cplusplus
 }
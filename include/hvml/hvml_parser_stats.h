@@ -0,0 +1,81 @@
+// This file is a part of Purring Cat, a reference implementation of HVML.
+//
+// Copyright (C) 2020, <freemine@yeah.net>.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#ifndef _hvml_parser_stats_h_
+#define _hvml_parser_stats_h_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// tokens counted per callback type
+typedef enum {
+    // hvml
+    HVML_PARSER_TOKEN_OPEN_TAG,
+    HVML_PARSER_TOKEN_ATTR_KEY,
+    HVML_PARSER_TOKEN_ATTR_VAL,
+    HVML_PARSER_TOKEN_CLOSE_TAG,
+    HVML_PARSER_TOKEN_TEXT,
+    // json
+    HVML_PARSER_TOKEN_BEGIN,
+    HVML_PARSER_TOKEN_OPEN_ARRAY,
+    HVML_PARSER_TOKEN_CLOSE_ARRAY,
+    HVML_PARSER_TOKEN_OPEN_OBJ,
+    HVML_PARSER_TOKEN_CLOSE_OBJ,
+    HVML_PARSER_TOKEN_KEY,
+    HVML_PARSER_TOKEN_TRUE,
+    HVML_PARSER_TOKEN_FALSE,
+    HVML_PARSER_TOKEN_NULL,
+    HVML_PARSER_TOKEN_STRING,
+    HVML_PARSER_TOKEN_INTEGER,
+    HVML_PARSER_TOKEN_DOUBLE,
+    HVML_PARSER_TOKEN_END,
+
+    HVML_PARSER_TOKEN_MAX
+} HVML_PARSER_TOKEN;
+
+typedef struct hvml_parser_stats_s          hvml_parser_stats_t;
+
+// counters of a parser, collected only once enabled on it
+struct hvml_parser_stats_s {
+    uint64_t        bytes;            // bytes consumed
+    uint64_t        tokens[HVML_PARSER_TOKEN_MAX];
+    uint64_t        states_max;       // high-water mark of the state stack
+    uint64_t        cache_reallocs;   // growths of the token/line caches
+    uint64_t        utf8_multibyte;   // multi-byte utf-8 sequences
+    uint64_t        retries;          // a char dispatched again after a state change
+    uint64_t        callback_ns;      // time spent in user callbacks
+    uint64_t        parse_ns;         // time spent parsing, callbacks excluded
+};
+
+// add the counters of `src` to `dst`, high-water marks take the max
+void        hvml_parser_stats_add(hvml_parser_stats_t *dst, const hvml_parser_stats_t *src);
+// name of a token type, as used by hvml_parser_stats_printf
+const char* hvml_parser_stats_token_name(HVML_PARSER_TOKEN token);
+// one `<prefix>_<counter> <value>` line per counter
+void        hvml_parser_stats_printf(const hvml_parser_stats_t *stats, const char *prefix, FILE *out);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // _hvml_parser_stats_h_
+
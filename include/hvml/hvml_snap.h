@@ -0,0 +1,85 @@
+// This file is a part of Purring Cat, a reference implementation of HVML.
+//
+// Copyright (C) 2020, <freemine@yeah.net>.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#ifndef _hvml_snap_h_
+#define _hvml_snap_h_
+
+#include "hvml/hvml_dom.h"
+#include "hvml/hvml_jo.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// a snapshot is a parsed document, with the json data of its nodes, laid
+// out flat in one buffer: a header with version and checksum, fixed-size
+// node and json value records linked to each other by index, and a pool
+// of nul-terminated strings referenced by offset. it's position
+// independent, and read in place from a read-only mapping of the file.
+// snapshots are in the byte order of the host they were written on.
+
+#define HVML_SNAP_VERSION        2
+// no such node or json value
+#define HVML_SNAP_NONE           ((uint32_t)-1)
+
+typedef struct hvml_snap_s           hvml_snap_t;
+
+// write `dom` and all below it as a snapshot, 0 on success
+int              hvml_snap_write(hvml_dom_t *dom, FILE *out);
+
+// map and verify a snapshot, NULL if it can't be read or is not valid
+hvml_snap_t*     hvml_snap_open(const char *file);
+void             hvml_snap_close(hvml_snap_t *snap);
+
+// nodes are numbered in document order, node 0 being the root
+size_t           hvml_snap_nodes(hvml_snap_t *snap);
+HVML_DOM_TYPE    hvml_snap_type(hvml_snap_t *snap, uint32_t node);
+uint32_t         hvml_snap_parent(hvml_snap_t *snap, uint32_t node);
+uint32_t         hvml_snap_next(hvml_snap_t *snap, uint32_t node);
+uint32_t         hvml_snap_first_child(hvml_snap_t *snap, uint32_t node);
+uint32_t         hvml_snap_first_attr(hvml_snap_t *snap, uint32_t node);
+// tag name of a tag, or key of an attr
+const char*      hvml_snap_name(hvml_snap_t *snap, uint32_t node, size_t *len);
+// val of an attr (NULL if it has none), or content of a text
+const char*      hvml_snap_value(hvml_snap_t *snap, uint32_t node, size_t *len);
+// the json value of a json node
+uint32_t         hvml_snap_jo(hvml_snap_t *snap, uint32_t node);
+
+// json values, see the namesakes in hvml_jo.h
+HVML_JO_TYPE     hvml_snap_jo_type(hvml_snap_t *snap, uint32_t jo);
+uint32_t         hvml_snap_jo_first(hvml_snap_t *snap, uint32_t jo);
+uint32_t         hvml_snap_jo_next(hvml_snap_t *snap, uint32_t jo);
+int              hvml_snap_jo_is_integer(hvml_snap_t *snap, uint32_t jo);
+int64_t          hvml_snap_jo_integer(hvml_snap_t *snap, uint32_t jo);
+double           hvml_snap_jo_double(hvml_snap_t *snap, uint32_t jo);
+// content of a string, key of an object_kv, or origin of a number, NULL
+// for a number if it is canonical
+const char*      hvml_snap_jo_str(hvml_snap_t *snap, uint32_t jo, size_t *len);
+
+// same output as hvml_dom_printf and hvml_jo_value_printf
+void             hvml_snap_printf(hvml_snap_t *snap, uint32_t node, FILE *out);
+void             hvml_snap_jo_printf(hvml_snap_t *snap, uint32_t jo, FILE *out);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // _hvml_snap_h_
@@ -40,6 +40,8 @@ int                  hvml_utf8_decoder_push(hvml_utf8_decoder_t *decoder, const
 int                  hvml_utf8_decoder_ready(hvml_utf8_decoder_t *decoder);
 
 const char*          hvml_utf8_decoder_cache(hvml_utf8_decoder_t *decoder, size_t *len);
+// drop any cached fragment, ready for a new stream
+void                 hvml_utf8_decoder_reset(hvml_utf8_decoder_t *decoder);
 
 
 int                  hvml_utf8_encode(const uint64_t cp, char *output, size_t *output_len);
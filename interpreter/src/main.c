@@ -28,10 +28,7 @@
 #include <string.h>
 
 static const char* file_ext(const char *file);
-static int process(FILE *in, const char *ext);
-static int process_hvml(FILE *in);
-static int process_json(FILE *in);
-static int process_utf8(FILE *in);
+static int process_hvml(FILE *in, FILE *out);
 
 int main(int argc, char *argv[])
 {
@@ -64,11 +61,11 @@ int main(int argc, char *argv[])
         return 1;
     }
 
-    I("processing file: %s", file);
+    I("processing file: %s", file_in);
     int ret = process_hvml(in, out);
 
     if (in) fclose(in);
-    if (out) fcolose(out);
+    if (out) fclose(out);
 
     if (ret) return ret;
     
@@ -85,10 +82,9 @@ static int process_hvml(FILE *in, FILE *out)
 {
     hvml_dom_t *dom = hvml_dom_load_from_stream(in);
     if (dom) {
-        hvml_dom_printf(dom, stdout);
-        hvml_dom_to_html(dom, out);
+        hvml_dom_printf(dom, out);
         hvml_dom_destroy(dom);
-        printf("\n");
+        fprintf(out, "\n");
         return 0;
     }
     return 1;
@@ -20,12 +20,15 @@
 #include "hvml/hvml_json_parser.h"
 #include "hvml/hvml_list.h"
 #include "hvml/hvml_log.h"
+#include "hvml/hvml_mmap.h"
 
 #include <ctype.h>
 #include <inttypes.h>
+#include <pthread.h>
 #include <stddef.h>
 #include <stdlib.h>
 #include <string.h>
+#include <unistd.h>
 
 // for easy coding
 #define VAL_MEMBERS() \
@@ -45,6 +48,47 @@
 struct hvml_jo_gen_s {
     hvml_jo_value_t          *jo;
     hvml_json_parser_t       *parser;
+    // keys of the document being built
+    hvml_jo_symtab_t         *symtab;
+};
+
+// FNV-1a, 64 bits
+#define HASH_INIT           (14695981039346656037ULL)
+#define HASH_PRIME          (1099511628211ULL)
+
+static uint64_t hash_bytes(uint64_t h, const void *buf, size_t len) {
+    const unsigned char *p = (const unsigned char*)buf;
+    for (size_t i=0; i<len; ++i) {
+        h ^= p[i];
+        h *= HASH_PRIME;
+    }
+    return h;
+}
+
+typedef struct hvml_jo_key_s          hvml_jo_key_t;
+
+// an object key, shared by the object_kv's of a document interning it,
+// or owned by one
+struct hvml_jo_key_s {
+    int                      refs;
+    size_t                   len;
+    uint64_t                 hash;
+    char                     str[];    // nul-terminated
+};
+
+// the keys of an object in order, shared by a run of sibling objects of
+// an array having the same keys, see hvml_jo_object_reshape
+struct hvml_jo_shape_s {
+    int                      refs;
+    size_t                   count;
+    hvml_jo_key_t           *keys[];
+};
+
+// open addressing, linear probing, kept at most half full
+struct hvml_jo_symtab_s {
+    hvml_jo_key_t          **slots;
+    size_t                   cap;
+    size_t                   count;
 };
 
 typedef struct hvml_jo_true_s         hvml_jo_true_t;
@@ -68,23 +112,33 @@ struct hvml_jo_number_s {
         int64_t    v_i;
         double     v_d;
     };
+    // NULL if the text parsed from is the canonical one
     char          *origin;
 };
 
+// strings shorter than `buf` are kept in place, nul-terminated, within
+// what the union takes anyway
 struct hvml_jo_string_s {
-    char   *str;
     size_t  len;
+    union {
+        char   *str;
+        char    buf[16];
+    };
 };
 
+#define JSTR_IS_INLINE(jo)    ((jo)->jstr.len < sizeof((jo)->jstr.buf))
+#define JSTR(jo)              (JSTR_IS_INLINE(jo) ? (jo)->jstr.buf : (jo)->jstr.str)
+
 struct hvml_jo_object_s {
+    // NULL until given one, dropped once the object's keys change
+    hvml_jo_shape_t         *shape;
 };
 
 struct hvml_jo_array_s {
 };
 
 struct hvml_jo_object_kv_s {
-    char                    *key;
-    size_t                   len;
+    hvml_jo_key_t           *key;
     hvml_jo_value_t         *val;
 };
 
@@ -137,52 +191,120 @@ hvml_jo_value_t* hvml_jo_null() {
     return jo;
 }
 
-hvml_jo_value_t* hvml_jo_integer(const int64_t v, const char *origin) {
-    hvml_jo_value_t *jo = (hvml_jo_value_t*)calloc(1, sizeof(*jo));
-    if (!jo) return NULL;
+size_t hvml_jo_number_canonical(int integer, int64_t v_i, double v_d, char *buf, size_t len) {
+    if (integer) return (size_t)snprintf(buf, len, "%"PRId64"", v_i);
 
-    jo->jot           = MKJOT(J_NUMBER);
-    jo->jnum.integer  = 1;
-    jo->jnum.v_i      = v;
-    jo->jnum.origin   = strdup(origin);
+    int n = 0;
+    for (int prec=15; prec<=17; ++prec) {
+        n = snprintf(buf, len, "%.*g", prec, v_d);
+        if (strtod(buf, NULL) == v_d) break;
+    }
+    return (size_t)n;
+}
 
-    if (!jo->jnum.origin) {
-        hvml_jo_value_free(jo);
-        return NULL;
+// if a double parsed from `origin` prints back as `origin` with %.15g,
+// decided from the text alone: any decimal of up to 15 significant digits
+// reads back from the nearest double, so %.15g gives back its digits, and
+// then it's about the notation. -1 if it takes printing to know
+static int decimal_is_canonical(const char *origin) {
+    const char *p = origin;
+    if (*p == '-') ++p;
+
+    int sig   = 0;   // significant digits
+    int zeros = 0;   // zeros after the point, before the first of them
+    if (*p == '0') {
+        ++p;
+    } else if (*p >= '1' && *p <= '9') {
+        while (*p >= '0' && *p <= '9') {
+            ++sig;
+            ++p;
+        }
+    } else {
+        return -1;
+    }
+    if (*p == '.') {
+        ++p;
+        if (*p < '0' || *p > '9') return 0;
+        for (; *p >= '0' && *p <= '9'; ++p) {
+            if (sig == 0 && *p == '0') ++zeros;
+            else                       ++sig;
+        }
+        // %g drops trailing zeros
+        if (p[-1] == '0') return 0;
     }
+    if (*p) return -1;
+    if (sig > 15) return -1;
+    // %g goes for an exponent below 1e-4
+    if (sig && zeros > 3 && origin[origin[0] == '-'] == '0') return 0;
+    return 1;
+}
 
-    return jo;
+// if `origin`, the text a number was parsed from, is its canonical text,
+// and needs not be kept
+static int origin_is_canonical(const char *origin, int integer) {
+    if (!origin) return 1;
+
+    if (integer) {
+        // what parses to an integer is canonical unless signed with '+',
+        // -0, or with leading zeros
+        const char *p = origin;
+        if (*p == '-') ++p;
+        if (*p == '0') return p[1] == '\0' && p == origin;
+        if (*p < '1' || *p > '9') return 0;
+        while (*++p) {
+            if (*p < '0' || *p > '9') return 0;
+        }
+        return 1;
+    }
+
+    // when it takes printing to know, the origin is kept: printing
+    // costs more than keeping it
+    return decimal_is_canonical(origin) == 1;
 }
 
-hvml_jo_value_t* hvml_jo_double(const double v, const char *origin) {
+static hvml_jo_value_t* hvml_jo_number(int integer, int64_t v_i, double v_d, const char *origin) {
     hvml_jo_value_t *jo = (hvml_jo_value_t*)calloc(1, sizeof(*jo));
     if (!jo) return NULL;
 
     jo->jot           = MKJOT(J_NUMBER);
-    jo->jnum.integer  = 0;
-    jo->jnum.v_d      = v;
-    jo->jnum.origin   = strdup(origin);
-
-    if (!jo->jnum.origin) {
-        hvml_jo_value_free(jo);
-        return NULL;
+    jo->jnum.integer  = integer ? 1 : 0;
+    if (integer) jo->jnum.v_i = v_i;
+    else         jo->jnum.v_d = v_d;
+
+    if (!origin_is_canonical(origin, integer)) {
+        jo->jnum.origin = strdup(origin);
+        if (!jo->jnum.origin) {
+            hvml_jo_value_free(jo);
+            return NULL;
+        }
     }
 
     return jo;
 }
 
+hvml_jo_value_t* hvml_jo_integer(const int64_t v, const char *origin) {
+    return hvml_jo_number(1, v, 0, origin);
+}
+
+hvml_jo_value_t* hvml_jo_double(const double v, const char *origin) {
+    return hvml_jo_number(0, 0, v, origin);
+}
+
 hvml_jo_value_t* hvml_jo_string(const char *v, size_t len) {
     hvml_jo_value_t *jo = (hvml_jo_value_t*)calloc(1, sizeof(*jo));
     if (!jo) return NULL;
 
     jo->jot = MKJOT(J_STRING);
-    jo->jstr.str = (char*)malloc(len+1);
-    if (!jo->jstr.str) {
-        free(jo);
-        return NULL;
-    }
-    memcpy(jo->jstr.str, v, len);
     jo->jstr.len = len;
+    if (!JSTR_IS_INLINE(jo)) {
+        jo->jstr.str = (char*)malloc(len+1);
+        if (!jo->jstr.str) {
+            free(jo);
+            return NULL;
+        }
+    }
+    memcpy(JSTR(jo), v, len);
+    JSTR(jo)[len] = '\0';
 
     return jo;
 }
@@ -205,22 +327,243 @@ hvml_jo_value_t* hvml_jo_array() {
     return jo;
 }
 
-hvml_jo_value_t* hvml_jo_object_kv(const char *key, size_t len) {
+static hvml_jo_key_t* key_create(const char *str, size_t len, uint64_t hash) {
+    hvml_jo_key_t *key = (hvml_jo_key_t*)malloc(sizeof(*key) + len + 1);
+    if (!key) return NULL;
+    key->refs = 1;
+    key->len  = len;
+    key->hash = hash;
+    memcpy(key->str, str, len);
+    key->str[len] = '\0';
+    return key;
+}
+
+static hvml_jo_key_t* key_ref(hvml_jo_key_t *key) {
+    __atomic_add_fetch(&key->refs, 1, __ATOMIC_RELAXED);
+    return key;
+}
+
+static void key_unref(hvml_jo_key_t *key) {
+    if (__atomic_sub_fetch(&key->refs, 1, __ATOMIC_ACQ_REL)) return;
+    free(key);
+}
+
+static hvml_jo_value_t* object_kv_with(hvml_jo_key_t *key) {
     hvml_jo_value_t *jo = (hvml_jo_value_t*)calloc(1, sizeof(*jo));
     if (!jo) return NULL;
 
-    jo->jot = MKJOT(J_OBJECT_KV);
-    jo->jkv.key = (char*)malloc(len+1);
-    if (!jo->jkv.key) {
-        free(jo);
-        return NULL;
+    jo->jot     = MKJOT(J_OBJECT_KV);
+    jo->jkv.key = key;
+
+    return jo;
+}
+
+hvml_jo_value_t* hvml_jo_object_kv(const char *key, size_t len) {
+    hvml_jo_key_t *k = key_create(key, len, hash_bytes(HASH_INIT, key, len));
+    if (!k) return NULL;
+
+    hvml_jo_value_t *jo = object_kv_with(k);
+    if (!jo) key_unref(k);
+
+    return jo;
+}
+
+hvml_jo_symtab_t* hvml_jo_symtab_create() {
+    return (hvml_jo_symtab_t*)calloc(1, sizeof(hvml_jo_symtab_t));
+}
+
+void hvml_jo_symtab_destroy(hvml_jo_symtab_t *symtab) {
+    hvml_jo_symtab_reset(symtab);
+    free(symtab->slots);
+    free(symtab);
+}
+
+void hvml_jo_symtab_reset(hvml_jo_symtab_t *symtab) {
+    for (size_t i=0; symtab->count && i<symtab->cap; ++i) {
+        if (!symtab->slots[i]) continue;
+        key_unref(symtab->slots[i]);
+        symtab->slots[i] = NULL;
+        --symtab->count;
     }
-    memcpy(jo->jkv.key, key, len);
-    jo->jkv.len = len;
+}
+
+static int symtab_grow(hvml_jo_symtab_t *symtab) {
+    size_t          cap   = symtab->cap ? symtab->cap * 2 : 64;
+    hvml_jo_key_t **slots = (hvml_jo_key_t**)calloc(cap, sizeof(*slots));
+    if (!slots) return -1;
+
+    for (size_t i=0; i<symtab->cap; ++i) {
+        hvml_jo_key_t *key = symtab->slots[i];
+        if (!key) continue;
+        size_t j = key->hash & (cap - 1);
+        while (slots[j]) j = (j + 1) & (cap - 1);
+        slots[j] = key;
+    }
+    free(symtab->slots);
+    symtab->slots = slots;
+    symtab->cap   = cap;
+    return 0;
+}
+
+static hvml_jo_key_t* symtab_intern(hvml_jo_symtab_t *symtab, const char *str, size_t len) {
+    if ((symtab->count + 1) * 2 > symtab->cap && symtab_grow(symtab)) return NULL;
+
+    const uint64_t h = hash_bytes(HASH_INIT, str, len);
+    size_t         i = h & (symtab->cap - 1);
+    for (hvml_jo_key_t *key; (key = symtab->slots[i]); i = (i + 1) & (symtab->cap - 1)) {
+        if (key->hash == h && key->len == len && memcmp(key->str, str, len)==0) {
+            return key_ref(key);
+        }
+    }
+
+    hvml_jo_key_t *key = key_create(str, len, h);
+    if (!key) return NULL;
+    symtab->slots[i] = key_ref(key);
+    ++symtab->count;
+    return key;
+}
+
+hvml_jo_value_t* hvml_jo_object_kv_interned(hvml_jo_symtab_t *symtab, const char *key, size_t len) {
+    hvml_jo_key_t *k = symtab_intern(symtab, key, len);
+    if (!k) return NULL;
+
+    hvml_jo_value_t *jo = object_kv_with(k);
+    if (!jo) key_unref(k);
 
     return jo;
 }
 
+static int key_equal(const hvml_jo_key_t *l, const hvml_jo_key_t *r) {
+    if (l == r) return 1;
+    return l->hash == r->hash && l->len == r->len && memcmp(l->str, r->str, l->len)==0;
+}
+
+static hvml_jo_shape_t* shape_create(hvml_jo_value_t *jo) {
+    hvml_jo_shape_t *shape = (hvml_jo_shape_t*)malloc(sizeof(*shape) + VAL_COUNT(jo) * sizeof(shape->keys[0]));
+    if (!shape) return NULL;
+    shape->refs  = 1;
+    shape->count = 0;
+    for (hvml_jo_value_t *kv = VAL_HEAD(jo); kv; kv = VAL_NEXT(kv)) {
+        shape->keys[shape->count++] = key_ref(kv->jkv.key);
+    }
+    return shape;
+}
+
+static hvml_jo_shape_t* shape_ref(hvml_jo_shape_t *shape) {
+    __atomic_add_fetch(&shape->refs, 1, __ATOMIC_RELAXED);
+    return shape;
+}
+
+static void shape_unref(hvml_jo_shape_t *shape) {
+    if (__atomic_sub_fetch(&shape->refs, 1, __ATOMIC_ACQ_REL)) return;
+    for (size_t i=0; i<shape->count; ++i) key_unref(shape->keys[i]);
+    free(shape);
+}
+
+static int shape_fits(const hvml_jo_shape_t *shape, hvml_jo_value_t *jo) {
+    if (shape->count != VAL_COUNT(jo)) return 0;
+    size_t i = 0;
+    for (hvml_jo_value_t *kv = VAL_HEAD(jo); kv; kv = VAL_NEXT(kv), ++i) {
+        if (!key_equal(shape->keys[i], kv->jkv.key)) return 0;
+    }
+    return 1;
+}
+
+static int object_same_keys(hvml_jo_value_t *l, hvml_jo_value_t *r) {
+    if (VAL_COUNT(l) != VAL_COUNT(r)) return 0;
+    hvml_jo_value_t *lv = VAL_HEAD(l);
+    hvml_jo_value_t *rv = VAL_HEAD(r);
+    for (; lv && rv; lv = VAL_NEXT(lv), rv = VAL_NEXT(rv)) {
+        if (!key_equal(lv->jkv.key, rv->jkv.key)) return 0;
+    }
+    return 1;
+}
+
+static void object_unshape(hvml_jo_value_t *jo) {
+    if (!jo->jobject.shape) return;
+    shape_unref(jo->jobject.shape);
+    jo->jobject.shape = NULL;
+}
+
+int hvml_jo_object_reshape(hvml_jo_value_t *jo) {
+    A(jo->jot == MKJOT(J_OBJECT), "internal logic error");
+    object_unshape(jo);
+
+    hvml_jo_value_t *parent = VAL_OWNER(jo);
+    hvml_jo_value_t *prev   = VAL_PREV(jo);
+    if (!parent || parent->jot != MKJOT(J_ARRAY)) return 0;
+    if (!prev || prev->jot != MKJOT(J_OBJECT) || VAL_IS_EMPTY(jo)) return 0;
+
+    hvml_jo_shape_t *shape = prev->jobject.shape;
+    if (shape) {
+        if (!shape_fits(shape, jo)) return 0;
+    } else {
+        // a run starts with the second object of it
+        if (!object_same_keys(prev, jo)) return 0;
+        shape = shape_create(prev);
+        if (!shape) return -1;
+        prev->jobject.shape = shape;
+    }
+
+    jo->jobject.shape = shape_ref(shape);
+    return 0;
+}
+
+const hvml_jo_shape_t* hvml_jo_object_shape(hvml_jo_value_t *jo) {
+    A(jo->jot == MKJOT(J_OBJECT), "internal logic error");
+    return jo->jobject.shape;
+}
+
+size_t hvml_jo_shape_count(const hvml_jo_shape_t *shape) {
+    return shape->count;
+}
+
+const char* hvml_jo_shape_key(const hvml_jo_shape_t *shape, size_t idx, size_t *len) {
+    A(idx < shape->count, "internal logic error");
+    if (len) *len = shape->keys[idx]->len;
+    return shape->keys[idx]->str;
+}
+
+void hvml_jo_column_init(hvml_jo_column_t *col, const char *key, size_t len) {
+    col->key   = key;
+    col->len   = len;
+    col->hash  = hash_bytes(HASH_INIT, key, len);
+    col->shape = NULL;
+    col->index = 0;
+}
+
+void hvml_jo_column_release(hvml_jo_column_t *col) {
+    if (col->shape) shape_unref(col->shape);
+    col->shape = NULL;
+}
+
+hvml_jo_value_t* hvml_jo_column_get(hvml_jo_column_t *col, hvml_jo_value_t *jo) {
+    A(jo->jot == MKJOT(J_OBJECT), "internal logic error");
+
+    hvml_jo_shape_t *shape = jo->jobject.shape;
+    if (!shape) return hvml_jo_object_get_kv_by_key(jo, col->key, col->len);
+
+    if (shape != col->shape) {
+        // looked up once per shape, held so that it can't come back
+        // at the same address as another one
+        size_t i = 0;
+        for (; i<shape->count; ++i) {
+            const hvml_jo_key_t *k = shape->keys[i];
+            if (k->hash == col->hash && k->len == col->len &&
+                memcmp(k->str, col->key, col->len)==0) break;
+        }
+        hvml_jo_column_release(col);
+        col->shape = shape_ref(shape);
+        col->index = i;
+    }
+
+    if (col->index >= shape->count) return NULL;
+
+    hvml_jo_value_t *kv = VAL_HEAD(jo);
+    for (size_t i=0; i<col->index; ++i) kv = VAL_NEXT(kv);
+    return kv;
+}
+
 int hvml_jo_value_push(hvml_jo_value_t *jo, hvml_jo_value_t *val) {
     if (!val) return -1;
     if (!VAL_IS_ORPHAN(val)) {
@@ -241,6 +584,7 @@ int hvml_jo_value_push(hvml_jo_value_t *jo, hvml_jo_value_t *val) {
                 E("val[%p/%s] is NOT object k/v paire", val, hvml_jo_value_type_str(val));
                 return -1;
             }
+            object_unshape(jo);
             VAL_APPEND(jo, val);
         } break;
         case MKJOT(J_OBJECT_KV):
@@ -265,9 +609,12 @@ int hvml_jo_value_push(hvml_jo_value_t *jo, hvml_jo_value_t *val) {
 hvml_jo_value_t* hvml_jo_object_get_kv_by_key(hvml_jo_value_t *jo, const char *key, size_t len) {
     A(jo->jot == MKJOT(J_OBJECT), "internal logic error");
 
+    // hashed once, compared to the hashes the keys keep
+    const uint64_t   h  = hash_bytes(HASH_INIT, key, len);
     hvml_jo_value_t *kv = VAL_HEAD(jo);
     while (kv) {
-        if (kv->jkv.len == len && memcmp(kv->jkv.key, key, len)==0) break;
+        const hvml_jo_key_t *k = kv->jkv.key;
+        if (k->hash == h && k->len == len && memcmp(k->str, key, len)==0) break;
         kv = VAL_NEXT(kv);
     }
 
@@ -291,11 +638,56 @@ hvml_jo_value_t* hvml_jo_object_append_kv(hvml_jo_value_t *jo, hvml_jo_value_t *
         return NULL;
     }
 
+    object_unshape(jo);
     VAL_APPEND(jo, val);
 
     return val;
 }
 
+hvml_jo_value_t* hvml_jo_value_clone(hvml_jo_value_t *jo) {
+    hvml_jo_value_t *v = NULL;
+    switch (jo->jot) {
+        case MKJOT(J_TRUE):      { v = hvml_jo_true();                             } break;
+        case MKJOT(J_FALSE):     { v = hvml_jo_false();                            } break;
+        case MKJOT(J_NULL):      { v = hvml_jo_null();                             } break;
+        case MKJOT(J_STRING):    { v = hvml_jo_string(JSTR(jo), jo->jstr.len);     } break;
+        case MKJOT(J_OBJECT):    { v = hvml_jo_object();                           } break;
+        case MKJOT(J_ARRAY):     { v = hvml_jo_array();                            } break;
+        case MKJOT(J_OBJECT_KV): { v = object_kv_with(jo->jkv.key);
+                                   if (v) key_ref(jo->jkv.key);                   } break;
+        case MKJOT(J_NUMBER): {
+            if (jo->jnum.integer) {
+                v = hvml_jo_integer(jo->jnum.v_i, jo->jnum.origin);
+            } else {
+                v = hvml_jo_double(jo->jnum.v_d, jo->jnum.origin);
+            }
+        } break;
+        default: {
+            A(0, "internal logic error, unknown JOT: [%d]", jo->jot);
+        } break;
+    }
+    if (!v) return NULL;
+
+    hvml_jo_value_t *child = VAL_HEAD(jo);
+    while (child) {
+        // attention: recursive call
+        hvml_jo_value_t *c = hvml_jo_value_clone(child);
+        if (!c || hvml_jo_value_push(v, c)) {
+            if (c) hvml_jo_value_free(c);
+            hvml_jo_value_free(v);
+            return NULL;
+        }
+        child = VAL_NEXT(child);
+    }
+
+    // the keys are shared with the copy, so is their shape
+    if (jo->jot == MKJOT(J_OBJECT) && jo->jobject.shape) {
+        v->jobject.shape = shape_ref(jo->jobject.shape);
+    }
+
+    return v;
+}
+
 void hvml_jo_value_detach(hvml_jo_value_t *jo) {
     hvml_jo_value_t *owner = VAL_OWNER(jo);
     if (!owner) return;
@@ -310,6 +702,8 @@ void hvml_jo_value_detach(hvml_jo_value_t *jo) {
 
     if (owner->jot == MKJOT(J_OBJECT_KV)) {
         owner->jkv.val = NULL;
+    } else if (owner->jot == MKJOT(J_OBJECT)) {
+        object_unshape(owner);
     }
 }
 
@@ -327,7 +721,7 @@ void hvml_jo_value_free(hvml_jo_value_t *jo) {
             }
         } break;
         case MKJOT(J_STRING): {
-            free(jo->jstr.str);
+            if (!JSTR_IS_INLINE(jo)) free(jo->jstr.str);
             jo->jstr.str = NULL;
             jo->jstr.len = 0;
         } break;
@@ -340,6 +734,7 @@ void hvml_jo_value_free(hvml_jo_value_t *jo) {
                 hvml_jo_value_free(v);
                 A(count - 1 == VAL_COUNT(jo), "internal logic error");
             }
+            object_unshape(jo);
         } break;
         case MKJOT(J_ARRAY): {
             while (VAL_COUNT(jo)>0) {
@@ -353,9 +748,8 @@ void hvml_jo_value_free(hvml_jo_value_t *jo) {
         } break;
         case MKJOT(J_OBJECT_KV): {
             if (jo->jkv.key) {
-                free(jo->jkv.key);
+                key_unref(jo->jkv.key);
                 jo->jkv.key = NULL;
-                jo->jkv.len = 0;
             }
             if (jo->jkv.val) {
                 hvml_jo_value_free(jo->jkv.val);
@@ -420,6 +814,147 @@ size_t hvml_jo_value_children(hvml_jo_value_t *jo) {
     return VAL_COUNT(jo);
 }
 
+hvml_jo_value_t* hvml_jo_value_first(hvml_jo_value_t *jo) {
+    return VAL_HEAD(jo);
+}
+
+hvml_jo_value_t* hvml_jo_value_next(hvml_jo_value_t *jo) {
+    return VAL_NEXT(jo);
+}
+
+int hvml_jo_value_is_integer(hvml_jo_value_t *jo) {
+    A(jo->jot == MKJOT(J_NUMBER), "internal logic error");
+    return jo->jnum.integer;
+}
+
+int64_t hvml_jo_value_integer(hvml_jo_value_t *jo) {
+    A(jo->jot == MKJOT(J_NUMBER), "internal logic error");
+    return jo->jnum.integer ? jo->jnum.v_i : (int64_t)jo->jnum.v_d;
+}
+
+double hvml_jo_value_double(hvml_jo_value_t *jo) {
+    A(jo->jot == MKJOT(J_NUMBER), "internal logic error");
+    return jo->jnum.integer ? (double)jo->jnum.v_i : jo->jnum.v_d;
+}
+
+const char* hvml_jo_value_origin(hvml_jo_value_t *jo) {
+    A(jo->jot == MKJOT(J_NUMBER), "internal logic error");
+    return jo->jnum.origin;
+}
+
+const char* hvml_jo_value_str(hvml_jo_value_t *jo, size_t *len) {
+    switch (jo->jot) {
+        case MKJOT(J_STRING): {
+            *len = jo->jstr.len;
+            return JSTR(jo);
+        } break;
+        case MKJOT(J_OBJECT_KV): {
+            *len = jo->jkv.key->len;
+            return jo->jkv.key->str;
+        } break;
+        default: {
+            A(0, "internal logic error");
+            return NULL;
+        } break;
+    }
+}
+
+static uint64_t hvml_jo_value_hash_(uint64_t h, hvml_jo_value_t *jo) {
+    const unsigned char jot = (unsigned char)jo->jot;
+    h = hash_bytes(h, &jot, sizeof(jot));
+    switch (jo->jot) {
+        case MKJOT(J_TRUE):
+        case MKJOT(J_FALSE):
+        case MKJOT(J_NULL): {
+        } break;
+        case MKJOT(J_NUMBER): {
+            if (jo->jnum.integer) {
+                h = hash_bytes(h, &jo->jnum.v_i, sizeof(jo->jnum.v_i));
+            } else {
+                // +0.0 and -0.0 compare equal, so shall they hash
+                double d = jo->jnum.v_d == 0 ? 0 : jo->jnum.v_d;
+                h = hash_bytes(h, &d, sizeof(d));
+            }
+        } break;
+        case MKJOT(J_STRING): {
+            h = hash_bytes(h, &jo->jstr.len, sizeof(jo->jstr.len));
+            h = hash_bytes(h, JSTR(jo), jo->jstr.len);
+        } break;
+        case MKJOT(J_OBJECT_KV): {
+            h = hash_bytes(h, &jo->jkv.key->len, sizeof(jo->jkv.key->len));
+            h = hash_bytes(h, jo->jkv.key->str, jo->jkv.key->len);
+            if (jo->jkv.val) {
+                // attention: recursive call
+                h = hvml_jo_value_hash_(h, jo->jkv.val);
+            }
+        } break;
+        case MKJOT(J_OBJECT):
+        case MKJOT(J_ARRAY): {
+            size_t count = VAL_COUNT(jo);
+            h = hash_bytes(h, &count, sizeof(count));
+            hvml_jo_value_t *v = VAL_HEAD(jo);
+            while (v) {
+                // attention: recursive call
+                h = hvml_jo_value_hash_(h, v);
+                v = VAL_NEXT(v);
+            }
+        } break;
+        default: {
+            A(0, "internal logic error, unknown JOT: [%d]", jo->jot);
+        } break;
+    }
+    return h;
+}
+
+uint64_t hvml_jo_value_hash(hvml_jo_value_t *jo) {
+    return hvml_jo_value_hash_(HASH_INIT, jo);
+}
+
+int hvml_jo_value_equal(hvml_jo_value_t *l, hvml_jo_value_t *r) {
+    if (l == r) return 1;
+    if (!l || !r) return 0;
+    if (l->jot != r->jot) return 0;
+
+    switch (l->jot) {
+        case MKJOT(J_TRUE):
+        case MKJOT(J_FALSE):
+        case MKJOT(J_NULL): {
+            return 1;
+        } break;
+        case MKJOT(J_NUMBER): {
+            if (l->jnum.integer != r->jnum.integer) return 0;
+            if (l->jnum.integer) return l->jnum.v_i == r->jnum.v_i;
+            return l->jnum.v_d == r->jnum.v_d;
+        } break;
+        case MKJOT(J_STRING): {
+            return l->jstr.len == r->jstr.len &&
+                   memcmp(JSTR(l), JSTR(r), l->jstr.len)==0;
+        } break;
+        case MKJOT(J_OBJECT_KV): {
+            if (!key_equal(l->jkv.key, r->jkv.key)) return 0;
+            // attention: recursive call
+            return hvml_jo_value_equal(l->jkv.val, r->jkv.val);
+        } break;
+        case MKJOT(J_OBJECT):
+        case MKJOT(J_ARRAY): {
+            if (VAL_COUNT(l) != VAL_COUNT(r)) return 0;
+            hvml_jo_value_t *lv = VAL_HEAD(l);
+            hvml_jo_value_t *rv = VAL_HEAD(r);
+            while (lv && rv) {
+                // attention: recursive call
+                if (!hvml_jo_value_equal(lv, rv)) return 0;
+                lv = VAL_NEXT(lv);
+                rv = VAL_NEXT(rv);
+            }
+            return 1;
+        } break;
+        default: {
+            A(0, "internal logic error, unknown JOT: [%d]", l->jot);
+            return 0; // never return
+        } break;
+    }
+}
+
 void hvml_jo_value_printf(hvml_jo_value_t *jo, FILE *out) {
     switch (jo->jot) {
         case MKJOT(J_TRUE): {
@@ -435,12 +970,18 @@ void hvml_jo_value_printf(hvml_jo_value_t *jo, FILE *out) {
             if (jo->jnum.integer) {
                 fprintf(out, "%"PRId64"", jo->jnum.v_i);
             } else {
-                int prec = strlen(jo->jnum.origin);
-                fprintf(out, "%.*g", prec, jo->jnum.v_d);
+                if (jo->jnum.origin) {
+                    int prec = strlen(jo->jnum.origin);
+                    fprintf(out, "%.*g", prec, jo->jnum.v_d);
+                } else {
+                    char buf[32];
+                    hvml_jo_number_canonical(0, 0, jo->jnum.v_d, buf, sizeof(buf));
+                    fputs(buf, out);
+                }
             }
         } break;
         case MKJOT(J_STRING): {
-            hvml_json_str_printf(out, jo->jstr.str, jo->jstr.len);
+            hvml_json_str_printf(out, JSTR(jo), jo->jstr.len);
         } break;
         case MKJOT(J_OBJECT): {
             fprintf(out, "{"); // "}"
@@ -457,7 +998,7 @@ void hvml_jo_value_printf(hvml_jo_value_t *jo, FILE *out) {
         } break;
         case MKJOT(J_OBJECT_KV): {
             A(jo->jkv.key, "internal logic error");
-            hvml_json_str_printf(out, jo->jkv.key, jo->jkv.len);
+            hvml_json_str_printf(out, jo->jkv.key->str, jo->jkv.key->len);
             if (jo->jkv.val) {
                 fprintf(out, ":");
                 // attention: recursive call
@@ -519,7 +1060,8 @@ hvml_jo_gen_t* hvml_jo_gen_create() {
     conf.arg                    = gen;
 
     gen->parser = hvml_json_parser_create(conf);
-    if (!gen->parser) {
+    gen->symtab = hvml_jo_symtab_create();
+    if (!gen->parser || !gen->symtab) {
         hvml_jo_gen_destroy(gen);
         return NULL;
     }
@@ -542,9 +1084,62 @@ void hvml_jo_gen_destroy(hvml_jo_gen_t *gen) {
         gen->parser = NULL;
     }
 
+    if (gen->symtab) {
+        hvml_jo_symtab_destroy(gen->symtab);
+        gen->symtab = NULL;
+    }
+
     free(gen);
 }
 
+void hvml_jo_gen_reset(hvml_jo_gen_t *gen) {
+    if (gen->jo) {
+        hvml_jo_value_free(hvml_jo_value_root(gen->jo));
+        gen->jo = NULL;
+    }
+
+    hvml_jo_symtab_reset(gen->symtab);
+    hvml_json_parser_reset(gen->parser);
+}
+
+// one ready generator kept per thread, destroyed when the thread exits
+static pthread_key_t  gen_pool_key;
+static pthread_once_t gen_pool_once = PTHREAD_ONCE_INIT;
+
+static void gen_pool_destroy(void *arg) {
+    hvml_jo_gen_destroy((hvml_jo_gen_t*)arg);
+}
+
+static void gen_pool_init(void) {
+    pthread_key_create(&gen_pool_key, gen_pool_destroy);
+}
+
+hvml_jo_gen_t* hvml_jo_gen_acquire() {
+    pthread_once(&gen_pool_once, gen_pool_init);
+
+    hvml_jo_gen_t *gen = (hvml_jo_gen_t*)pthread_getspecific(gen_pool_key);
+    if (gen) {
+        pthread_setspecific(gen_pool_key, NULL);
+        return gen;
+    }
+    return hvml_jo_gen_create();
+}
+
+void hvml_jo_gen_release(hvml_jo_gen_t *gen) {
+    if (!gen) return;
+
+    pthread_once(&gen_pool_once, gen_pool_init);
+
+    if (pthread_getspecific(gen_pool_key) ||
+        hvml_jo_gen_set_stats(gen, 0) ||
+        pthread_setspecific(gen_pool_key, gen))
+    {
+        hvml_jo_gen_destroy(gen);
+        return;
+    }
+    hvml_jo_gen_reset(gen);
+}
+
 int hvml_jo_gen_parse_char(hvml_jo_gen_t *gen, const char c) {
     return hvml_json_parser_parse_char(gen->parser, c);
 }
@@ -567,8 +1162,16 @@ hvml_jo_value_t* hvml_jo_gen_parse_end(hvml_jo_gen_t *gen) {
     return jo;
 }
 
+int hvml_jo_gen_set_stats(hvml_jo_gen_t *gen, int enable) {
+    return hvml_json_parser_set_stats(gen->parser, enable);
+}
+
+int hvml_jo_gen_get_stats(hvml_jo_gen_t *gen, hvml_parser_stats_t *stats) {
+    return hvml_json_parser_get_stats(gen->parser, stats);
+}
+
 hvml_jo_value_t* hvml_jo_value_load_from_stream(FILE *in) {
-    hvml_jo_gen_t *gen = hvml_jo_gen_create();
+    hvml_jo_gen_t *gen = hvml_jo_gen_acquire();
     if (!gen) return NULL;
 
     char buf[4096] = {0};
@@ -580,7 +1183,7 @@ hvml_jo_value_t* hvml_jo_value_load_from_stream(FILE *in) {
         if (ret) break;
     }
     hvml_jo_value_t *jo = hvml_jo_gen_parse_end(gen);
-    hvml_jo_gen_destroy(gen);
+    hvml_jo_gen_release(gen);
 
     if (ret==0) {
         return jo;
@@ -590,6 +1193,263 @@ hvml_jo_value_t* hvml_jo_value_load_from_stream(FILE *in) {
     return NULL;
 }
 
+// top-level arrays and objects at least this large are split at their
+// top-level commas and parsed on several threads
+#ifndef HVML_JO_PARALLEL_MIN
+#define HVML_JO_PARALLEL_MIN      (1024 * 1024)
+#endif
+
+static hvml_jo_value_t* parse_serial(const char *buf, size_t len) {
+    hvml_jo_gen_t *gen = hvml_jo_gen_acquire();
+    if (!gen) return NULL;
+
+    int ret = hvml_jo_gen_parse(gen, buf, len);
+    hvml_jo_value_t *jo = hvml_jo_gen_parse_end(gen);
+    hvml_jo_gen_release(gen);
+
+    if (ret && jo) {
+        hvml_jo_value_free(jo);
+        jo = NULL;
+    }
+    return jo;
+}
+
+#define SWAR_ONES    0x0101010101010101ULL
+#define SWAR_HIGHS   0x8080808080808080ULL
+// non-zero if any of the 8 bytes of `v` equals `c`
+#define SWAR_HAS(v, c)                                               \
+    ((((v) ^ (SWAR_ONES * (c))) - SWAR_ONES) &                       \
+     ~((v) ^ (SWAR_ONES * (c))) & SWAR_HIGHS)
+
+// skip 8 bytes at a time while none of them may change the structure:
+// within a string only quotes and backslashes do, outside of one quotes,
+// brackets and commas
+static const char* skip_plain(const char *p, const char *end, int in_str) {
+    while (end - p >= 8) {
+        uint64_t v;
+        memcpy(&v, p, sizeof(v));
+        uint64_t hit = SWAR_HAS(v, '"');
+        if (in_str) {
+            hit |= SWAR_HAS(v, '\\');
+        } else {
+            // or'ing 0x20 folds '[' into '{' and ']' into '}'
+            uint64_t w = v | (SWAR_ONES * 0x20);
+            hit |= SWAR_HAS(w, '{') | SWAR_HAS(w, '}') | SWAR_HAS(v, ',');
+        }
+        if (hit) break;
+        p += 8;
+    }
+    return p;
+}
+
+typedef struct split_s              split_t;
+struct split_s {
+    char             open;
+    char             close;
+    const char      *body;      // the first byte after `open`
+    const char      *end;       // at `close`
+    const char     **cuts;      // top-level commas ending the runs
+    int              ncuts;
+};
+
+// find the top-level commas of the array or object held in buf and pick at
+// most `runs - 1` of them, cutting its members into runs of similar size
+// -1 if buf does not hold a single array or object
+static int split_top_level(const char *buf, size_t len, int runs, split_t *sp) {
+    const char *p   = buf;
+    const char *end = buf + len;
+
+    while (p<end && isspace((unsigned char)*p)) ++p;
+    if (p==end || (*p!='[' && *p!='{')) return -1;
+
+    sp->open   = *p;
+    sp->close  = (*p=='[') ? ']' : '}';
+    sp->body   = ++p;
+    sp->ncuts  = 0;
+
+    size_t      step   = (size_t)(end - p) / runs;
+    const char *next   = p + step;
+    size_t      depth  = 0;
+    int         in_str = 0;
+
+    while (1) {
+        p = skip_plain(p, end, in_str);
+        if (p>=end) return -1;
+
+        const char c = *p;
+        if (in_str) {
+            if (c=='\\')     ++p;
+            else if (c=='"') in_str = 0;
+            ++p;
+            continue;
+        }
+        switch (c) {
+            case '"':
+            {
+                in_str = 1;
+            } break;
+            case '[':
+            case '{':
+            {
+                ++depth;
+            } break;
+            case ']':
+            case '}':
+            {
+                if (depth==0) goto closed;
+                --depth;
+            } break;
+            case ',':
+            {
+                if (depth || p<next || sp->ncuts>=runs-1) break;
+                sp->cuts[sp->ncuts++] = p;
+                next = p + step;
+            } break;
+            default: break;
+        }
+        ++p;
+    }
+
+closed:
+    if (*p!=sp->close) return -1;
+    sp->end = p;
+    for (++p; p<end; ++p) {
+        if (!isspace((unsigned char)*p)) return -1;
+    }
+    return 0;
+}
+
+typedef struct parse_run_s          parse_run_t;
+struct parse_run_s {
+    const char      *buf;
+    size_t           len;
+    hvml_jo_value_t *jo;
+};
+
+typedef struct parse_runs_s         parse_runs_t;
+struct parse_runs_s {
+    char             open;
+    char             close;
+    parse_run_t     *runs;
+    size_t           count;
+    size_t           next;      // next run to be taken by a worker
+};
+
+// each run is parsed as an array or object of its own
+static void* parse_runs_routine(void *arg) {
+    parse_runs_t *pr = (parse_runs_t*)arg;
+    while (1) {
+        size_t i = __atomic_fetch_add(&pr->next, 1, __ATOMIC_RELAXED);
+        if (i >= pr->count) break;
+
+        parse_run_t   *run = &pr->runs[i];
+        hvml_jo_gen_t *gen = hvml_jo_gen_acquire();
+        if (!gen) continue;
+
+        int ret = hvml_jo_gen_parse_char(gen, pr->open);
+        if (ret==0) ret = hvml_jo_gen_parse(gen, run->buf, run->len);
+        if (ret==0) ret = hvml_jo_gen_parse_char(gen, pr->close);
+        run->jo = hvml_jo_gen_parse_end(gen);
+        hvml_jo_gen_release(gen);
+
+        if (ret && run->jo) {
+            hvml_jo_value_free(run->jo);
+            run->jo = NULL;
+        }
+    }
+    return NULL;
+}
+
+hvml_jo_value_t* hvml_jo_value_parse_parallel(const char *buf, size_t len, int threads) {
+    if (threads <= 0) threads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    if (threads <= 1) return parse_serial(buf, len);
+
+    split_t      sp   = {0};
+    parse_runs_t pr   = {0};
+    pthread_t   *tids = NULL;
+    sp.cuts = (const char**)calloc(threads - 1, sizeof(*sp.cuts));
+    pr.runs = (parse_run_t*)calloc(threads, sizeof(*pr.runs));
+    tids    = (pthread_t*)calloc(threads - 1, sizeof(*tids));
+    if (!sp.cuts || !pr.runs || !tids ||
+        split_top_level(buf, len, threads, &sp) || sp.ncuts==0)
+    {
+        free(sp.cuts); free(pr.runs); free(tids);
+        return parse_serial(buf, len);
+    }
+
+    pr.open  = sp.open;
+    pr.close = sp.close;
+    pr.count = sp.ncuts + 1;
+    const char *p = sp.body;
+    for (int i=0; i<sp.ncuts; ++i) {
+        pr.runs[i].buf = p;
+        pr.runs[i].len = sp.cuts[i] - p;
+        p = sp.cuts[i] + 1;
+    }
+    pr.runs[sp.ncuts].buf = p;
+    pr.runs[sp.ncuts].len = sp.end - p;
+
+    // the calling thread is one of the workers
+    int spawned = 0;
+    for (size_t i=1; i<pr.count; ++i) {
+        if (pthread_create(&tids[i-1], NULL, parse_runs_routine, &pr)) break;
+        ++spawned;
+    }
+    parse_runs_routine(&pr);
+    for (int i=0; i<spawned; ++i) {
+        pthread_join(tids[i], NULL);
+    }
+    free(tids);
+    free(sp.cuts);
+
+    int failed = 0;
+    for (size_t i=0; i<pr.count; ++i) {
+        if (!pr.runs[i].jo) failed = 1;
+    }
+
+    // stitch the members of the runs in order into the first one
+    hvml_jo_value_t *jo = pr.runs[0].jo;
+    for (size_t i=1; i<pr.count; ++i) {
+        hvml_jo_value_t *run = pr.runs[i].jo;
+        if (!run) continue;
+        while (!failed && VAL_COUNT(run)>0) {
+            hvml_jo_value_t *v = VAL_HEAD(run);
+            VAL_REMOVE(v);
+            VAL_APPEND(jo, v);
+        }
+        hvml_jo_value_free(run);
+    }
+    free(pr.runs);
+
+    if (!failed) return jo;
+
+    // let the serial parser tell where the text went wrong
+    if (jo) hvml_jo_value_free(jo);
+    return parse_serial(buf, len);
+}
+
+hvml_jo_value_t* hvml_jo_value_load_from_buffer(const char *buf, size_t len) {
+    if (len < HVML_JO_PARALLEL_MIN) return parse_serial(buf, len);
+    return hvml_jo_value_parse_parallel(buf, len, 0);
+}
+
+hvml_jo_value_t* hvml_jo_value_load_from_file(const char *file) {
+    hvml_mmap_t map;
+    int r = hvml_mmap_open(&map, file);
+    if (r == -1) return NULL;
+    if (r) {
+        FILE *in = fopen(file, "rb");
+        if (!in) return NULL;
+        hvml_jo_value_t *jo = hvml_jo_value_load_from_stream(in);
+        fclose(in);
+        return jo;
+    }
+
+    // the whole file in one go, no copy
+    hvml_jo_value_t *jo = hvml_jo_value_load_from_buffer(map.buf, map.len);
+    hvml_mmap_close(&map);
+    return jo;
+}
 
 
 
@@ -603,6 +1463,7 @@ hvml_jo_value_t* hvml_jo_value_load_from_stream(FILE *in) {
 
 
 static int on_begin(void *arg) {
+    (void)arg;
     return 0;
 }
 
@@ -654,6 +1515,8 @@ static int on_open_obj(void *arg) {
 static int on_close_obj(void *arg) {
     hvml_jo_gen_t *gen = (hvml_jo_gen_t*)arg;
 
+    if (hvml_jo_object_reshape(gen->jo)) return -1;
+
     hvml_jo_value_t *parent = hvml_jo_value_parent(gen->jo);
     if (!parent) return 0;
 
@@ -666,7 +1529,7 @@ static int on_key(void *arg, const char *key, size_t len) {
     hvml_jo_gen_t   *gen    = (hvml_jo_gen_t*)arg;
     A(hvml_jo_value_type(gen->jo) == MKJOT(J_OBJECT), "internal logic error");
 
-    hvml_jo_value_t *jo = hvml_jo_object_kv(key, len);
+    hvml_jo_value_t *jo = hvml_jo_object_kv_interned(gen->symtab, key, len);
     if (!jo) return -1;
 
     if (hvml_jo_value_push(gen->jo, jo)) {
@@ -690,6 +1553,8 @@ static int on_true(void *arg) {
         return -1;
     }
 
+    gen->jo = jo;
+
     hvml_jo_value_t *parent = hvml_jo_value_parent(gen->jo);
     if (!parent) return 0;
 
@@ -709,6 +1574,8 @@ static int on_false(void *arg) {
         return -1;
     }
 
+    gen->jo = jo;
+
     hvml_jo_value_t *parent = hvml_jo_value_parent(gen->jo);
     if (!parent) return 0;
 
@@ -728,6 +1595,8 @@ static int on_null(void *arg) {
         return -1;
     }
 
+    gen->jo = jo;
+
     hvml_jo_value_t *parent = hvml_jo_value_parent(gen->jo);
     if (!parent) return 0;
 
@@ -747,6 +1616,8 @@ static int on_string(void *arg, const char *val, size_t len) {
         return -1;
     }
 
+    gen->jo = jo;
+
     hvml_jo_value_t *parent = hvml_jo_value_parent(gen->jo);
     if (!parent) return 0;
 
@@ -766,6 +1637,8 @@ static int on_integer(void *arg, const char *origin, int64_t val) {
         return -1;
     }
 
+    gen->jo = jo;
+
     hvml_jo_value_t *parent = hvml_jo_value_parent(gen->jo);
     if (!parent) return 0;
 
@@ -785,6 +1658,8 @@ static int on_double(void *arg, const char *origin, double val) {
         return -1;
     }
 
+    gen->jo = jo;
+
     hvml_jo_value_t *parent = hvml_jo_value_parent(gen->jo);
     if (!parent) return 0;
 
@@ -794,6 +1669,7 @@ static int on_double(void *arg, const char *origin, double val) {
 }
 
 static int on_end(void *arg) {
+    (void)arg;
     return 0;
 }
 
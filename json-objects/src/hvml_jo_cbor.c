@@ -0,0 +1,485 @@
+// This file is a part of Purring Cat, a reference implementation of HVML.
+//
+// Copyright (C) 2020, <freemine@yeah.net>.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#include "hvml/hvml_jo_cbor.h"
+
+#include "hvml/hvml_log.h"
+
+#include <inttypes.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+// major types
+#define CBOR_UINT           0
+#define CBOR_NINT           1
+#define CBOR_BYTES          2
+#define CBOR_TEXT           3
+#define CBOR_ARRAY          4
+#define CBOR_MAP            5
+#define CBOR_TAG            6
+#define CBOR_SIMPLE         7
+
+#define CBOR_FALSE          20
+#define CBOR_TRUE           21
+#define CBOR_NULL           22
+#define CBOR_FLOAT32        26
+#define CBOR_FLOAT64        27
+
+typedef enum {
+    FRAME_ARRAY,
+    FRAME_OBJECT,
+    FRAME_ORIGIN
+} FRAME_TYPE;
+
+typedef struct frame_s           frame_t;
+struct frame_s {
+    FRAME_TYPE           ft;
+    hvml_jo_value_t     *jo;        // the array or object being filled
+    hvml_jo_value_t     *kv;        // object: the k/v waiting for its val
+    uint64_t             left;      // # of items, or k/v pairs, to come
+
+    // origin: 0 for the array head, 1 for the number, 2 for the text
+    int                  stage;
+    int                  integer;
+    int64_t              v_i;
+    double               v_d;
+};
+
+struct hvml_jo_cbor_dec_s {
+    // the head of the item being read: initial byte and argument
+    unsigned char        head[9];
+    size_t               head_len;
+    size_t               head_need;
+
+    // text string being read
+    char                *str;
+    size_t               str_len;
+    size_t               str_cap;
+    size_t               str_need;
+    int                  in_str;
+
+    frame_t             *frames;
+    size_t               frames_count;
+    size_t               frames_cap;
+
+    hvml_jo_value_t     *root;
+    int                  failed;
+};
+
+static int put_head(FILE *out, int major, uint64_t v) {
+    unsigned char buf[9];
+    size_t        n = 0;
+    if (v < 24) {
+        buf[n++] = (unsigned char)((major << 5) | v);
+    } else {
+        int bytes, ai;
+        if (v <= 0xff)              { bytes = 1; ai = 24; }
+        else if (v <= 0xffff)       { bytes = 2; ai = 25; }
+        else if (v <= 0xffffffffU)  { bytes = 4; ai = 26; }
+        else                        { bytes = 8; ai = 27; }
+        buf[n++] = (unsigned char)((major << 5) | ai);
+        for (int i=bytes-1; i>=0; --i) {
+            buf[n++] = (unsigned char)(v >> (i * 8));
+        }
+    }
+    return fwrite(buf, 1, n, out) == n ? 0 : -1;
+}
+
+static int put_double(FILE *out, double d) {
+    uint64_t v;
+    memcpy(&v, &d, sizeof(v));
+    unsigned char buf[9];
+    buf[0] = (CBOR_SIMPLE << 5) | CBOR_FLOAT64;
+    for (int i=0; i<8; ++i) {
+        buf[1 + i] = (unsigned char)(v >> ((7 - i) * 8));
+    }
+    return fwrite(buf, 1, sizeof(buf), out) == sizeof(buf) ? 0 : -1;
+}
+
+static int put_text(FILE *out, const char *s, size_t len) {
+    if (put_head(out, CBOR_TEXT, len)) return -1;
+    return fwrite(s, 1, len, out) == len ? 0 : -1;
+}
+
+static int put_integer(FILE *out, int64_t v) {
+    if (v >= 0) return put_head(out, CBOR_UINT, (uint64_t)v);
+    return put_head(out, CBOR_NINT, (uint64_t)(-1 - v));
+}
+
+static int write_number(hvml_jo_value_t *jo, FILE *out) {
+    const int     integer = hvml_jo_value_is_integer(jo);
+    const int64_t v_i     = hvml_jo_value_integer(jo);
+    const double  v_d     = hvml_jo_value_double(jo);
+    // only kept if not canonical
+    const char   *origin  = hvml_jo_value_origin(jo);
+    const int     tagged  = origin != NULL;
+
+    if (tagged) {
+        if (put_head(out, CBOR_TAG, HVML_JO_CBOR_TAG_ORIGIN)) return -1;
+        if (put_head(out, CBOR_ARRAY, 2)) return -1;
+    }
+    if (integer) {
+        if (put_integer(out, v_i)) return -1;
+    } else {
+        if (put_double(out, v_d)) return -1;
+    }
+    if (tagged) {
+        if (put_text(out, origin, strlen(origin))) return -1;
+    }
+    return 0;
+}
+
+int hvml_jo_cbor_write(hvml_jo_value_t *jo, FILE *out) {
+    switch (hvml_jo_value_type(jo)) {
+        case MKJOT(J_TRUE): {
+            return putc((CBOR_SIMPLE << 5) | CBOR_TRUE, out) == EOF ? -1 : 0;
+        } break;
+        case MKJOT(J_FALSE): {
+            return putc((CBOR_SIMPLE << 5) | CBOR_FALSE, out) == EOF ? -1 : 0;
+        } break;
+        case MKJOT(J_NULL): {
+            return putc((CBOR_SIMPLE << 5) | CBOR_NULL, out) == EOF ? -1 : 0;
+        } break;
+        case MKJOT(J_NUMBER): {
+            return write_number(jo, out);
+        } break;
+        case MKJOT(J_STRING): {
+            size_t      len;
+            const char *s = hvml_jo_value_str(jo, &len);
+            return put_text(out, s, len);
+        } break;
+        case MKJOT(J_OBJECT_KV): {
+            size_t           len;
+            const char      *s   = hvml_jo_value_str(jo, &len);
+            hvml_jo_value_t *val = hvml_jo_value_first(jo);
+            if (put_text(out, s, len)) return -1;
+            if (!val) return putc((CBOR_SIMPLE << 5) | CBOR_NULL, out) == EOF ? -1 : 0;
+            // attention: recursive call
+            return hvml_jo_cbor_write(val, out);
+        } break;
+        case MKJOT(J_OBJECT):
+        case MKJOT(J_ARRAY): {
+            int major = hvml_jo_value_type(jo) == MKJOT(J_OBJECT) ? CBOR_MAP : CBOR_ARRAY;
+            if (put_head(out, major, hvml_jo_value_children(jo))) return -1;
+            hvml_jo_value_t *v = hvml_jo_value_first(jo);
+            while (v) {
+                // attention: recursive call
+                if (hvml_jo_cbor_write(v, out)) return -1;
+                v = hvml_jo_value_next(v);
+            }
+            return 0;
+        } break;
+        default: {
+            A(0, "internal logic error");
+            return -1;
+        } break;
+    }
+}
+
+hvml_jo_cbor_dec_t* hvml_jo_cbor_dec_create() {
+    hvml_jo_cbor_dec_t *dec = (hvml_jo_cbor_dec_t*)calloc(1, sizeof(*dec));
+    if (!dec) return NULL;
+
+    return dec;
+}
+
+void hvml_jo_cbor_dec_destroy(hvml_jo_cbor_dec_t *dec) {
+    // every value decoded so far is attached to the root
+    if (dec->root) hvml_jo_value_free(dec->root);
+    free(dec->str);
+    free(dec->frames);
+    free(dec);
+}
+
+static frame_t* top_frame(hvml_jo_cbor_dec_t *dec) {
+    return dec->frames_count ? dec->frames + dec->frames_count - 1 : NULL;
+}
+
+static frame_t* push_frame(hvml_jo_cbor_dec_t *dec, FRAME_TYPE ft, hvml_jo_value_t *jo, uint64_t left) {
+    if (dec->frames_count == dec->frames_cap) {
+        size_t   cap    = dec->frames_cap ? dec->frames_cap * 2 : 16;
+        frame_t *frames = (frame_t*)realloc(dec->frames, cap * sizeof(*frames));
+        if (!frames) return NULL;
+        dec->frames     = frames;
+        dec->frames_cap = cap;
+    }
+    frame_t *f = dec->frames + dec->frames_count++;
+    memset(f, 0, sizeof(*f));
+    f->ft   = ft;
+    f->jo   = jo;
+    f->left = left;
+    return f;
+}
+
+// hang a new value where the enclosing array or object expects one,
+// and descend into it if it's a container with items to come
+static int attach(hvml_jo_cbor_dec_t *dec, hvml_jo_value_t *jo, uint64_t items) {
+    frame_t *f = top_frame(dec);
+    if (!f) {
+        if (dec->root) {
+            E("extra data after the cbor item");
+            hvml_jo_value_free(jo);
+            return -1;
+        }
+        dec->root = jo;
+    } else {
+        hvml_jo_value_t *owner = (f->ft == FRAME_ARRAY) ? f->jo : f->kv;
+        if (f->ft == FRAME_ORIGIN || !owner || hvml_jo_value_push(owner, jo)) {
+            E("unexpected cbor item");
+            hvml_jo_value_free(jo);
+            return -1;
+        }
+        f->kv    = NULL;
+        f->left -= 1;
+    }
+
+    HVML_JO_TYPE jot = hvml_jo_value_type(jo);
+    if ((jot == MKJOT(J_ARRAY) || jot == MKJOT(J_OBJECT)) && items) {
+        FRAME_TYPE ft = jot == MKJOT(J_ARRAY) ? FRAME_ARRAY : FRAME_OBJECT;
+        if (!push_frame(dec, ft, jo, items)) return -1;
+    }
+
+    while ((f=top_frame(dec)) && f->ft != FRAME_ORIGIN && f->left == 0) {
+        dec->frames_count -= 1;
+    }
+    return 0;
+}
+
+static int on_number(hvml_jo_cbor_dec_t *dec, int integer, int64_t v_i, double v_d) {
+    frame_t *f = top_frame(dec);
+    if (f && f->ft == FRAME_ORIGIN) {
+        if (f->stage != 1) return -1;
+        f->stage   = 2;
+        f->integer = integer;
+        f->v_i     = v_i;
+        f->v_d     = v_d;
+        return 0;
+    }
+
+    // no origin, the canonical text
+    hvml_jo_value_t *jo = integer ? hvml_jo_integer(v_i, NULL) : hvml_jo_double(v_d, NULL);
+    if (!jo) return -1;
+    return attach(dec, jo, 0);
+}
+
+static int on_text(hvml_jo_cbor_dec_t *dec, const char *s, size_t len) {
+    frame_t *f = top_frame(dec);
+    if (f && f->ft == FRAME_ORIGIN) {
+        if (f->stage != 2) return -1;
+        hvml_jo_value_t *jo = f->integer ? hvml_jo_integer(f->v_i, s) : hvml_jo_double(f->v_d, s);
+        if (!jo) return -1;
+        dec->frames_count -= 1;
+        return attach(dec, jo, 0);
+    }
+    if (f && f->ft == FRAME_OBJECT && !f->kv) {
+        hvml_jo_value_t *kv = hvml_jo_object_kv(s, len);
+        if (!kv) return -1;
+        if (hvml_jo_value_push(f->jo, kv)) {
+            hvml_jo_value_free(kv);
+            return -1;
+        }
+        f->kv = kv;
+        return 0;
+    }
+
+    hvml_jo_value_t *jo = hvml_jo_string(s, len);
+    if (!jo) return -1;
+    return attach(dec, jo, 0);
+}
+
+// keys of an object are text strings, nothing else
+static int expects_key(hvml_jo_cbor_dec_t *dec) {
+    frame_t *f = top_frame(dec);
+    return f && f->ft == FRAME_OBJECT && !f->kv;
+}
+
+// room for `need` bytes of the text string being received, at least
+// doubling but never past its declared length
+static int reserve_str(hvml_jo_cbor_dec_t *dec, size_t need) {
+    if (dec->str_cap >= need) return 0;
+    size_t cap = dec->str_cap < 64 ? 64 : dec->str_cap * 2;
+    if (cap < need) cap = need;
+    if (cap > dec->str_need + 1) cap = dec->str_need + 1;
+    char *s = (char*)realloc(dec->str, cap);
+    if (!s) return -1;
+    dec->str     = s;
+    dec->str_cap = cap;
+    return 0;
+}
+
+static int on_head(hvml_jo_cbor_dec_t *dec) {
+    const int major = dec->head[0] >> 5;
+    const int ai    = dec->head[0] & 0x1f;
+    uint64_t  v     = ai;
+    if (ai >= 24) {
+        v = 0;
+        for (size_t i=1; i<dec->head_len; ++i) v = (v << 8) | dec->head[i];
+    }
+
+    if (major != CBOR_TEXT && expects_key(dec)) {
+        E("object key is not a text string");
+        return -1;
+    }
+
+    frame_t *f = top_frame(dec);
+    if (f && f->ft == FRAME_ORIGIN && f->stage == 0) {
+        if (major != CBOR_ARRAY || v != 2) {
+            E("malformed origin tag");
+            return -1;
+        }
+        f->stage = 1;
+        return 0;
+    }
+
+    switch (major) {
+        case CBOR_UINT:
+        case CBOR_NINT: {
+            if (v > INT64_MAX) {
+                E("cbor integer out of range");
+                return -1;
+            }
+            int64_t i = major == CBOR_UINT ? (int64_t)v : -1 - (int64_t)v;
+            return on_number(dec, 1, i, 0);
+        } break;
+        case CBOR_TEXT: {
+            if (v == 0) return on_text(dec, "", 0);
+            if (v >= SIZE_MAX) return -1;
+            // the declared length is not trusted, the buffer grows with
+            // the bytes actually received
+            dec->str_len  = 0;
+            dec->str_need = v;
+            dec->in_str   = 1;
+            return 0;
+        } break;
+        case CBOR_ARRAY: {
+            hvml_jo_value_t *jo = hvml_jo_array();
+            if (!jo) return -1;
+            return attach(dec, jo, v);
+        } break;
+        case CBOR_MAP: {
+            hvml_jo_value_t *jo = hvml_jo_object();
+            if (!jo) return -1;
+            return attach(dec, jo, v);
+        } break;
+        case CBOR_TAG: {
+            if (v != HVML_JO_CBOR_TAG_ORIGIN) return 0;  // other tags are ignored
+            if (f && f->ft == FRAME_ORIGIN) return -1;
+            return push_frame(dec, FRAME_ORIGIN, NULL, 0) ? 0 : -1;
+        } break;
+        case CBOR_SIMPLE: {
+            switch (ai) {
+                case CBOR_FALSE: {
+                    hvml_jo_value_t *jo = hvml_jo_false();
+                    return jo ? attach(dec, jo, 0) : -1;
+                } break;
+                case CBOR_TRUE: {
+                    hvml_jo_value_t *jo = hvml_jo_true();
+                    return jo ? attach(dec, jo, 0) : -1;
+                } break;
+                case CBOR_NULL: {
+                    hvml_jo_value_t *jo = hvml_jo_null();
+                    return jo ? attach(dec, jo, 0) : -1;
+                } break;
+                case CBOR_FLOAT32: {
+                    uint32_t u = (uint32_t)v;
+                    float    d;
+                    memcpy(&d, &u, sizeof(d));
+                    return on_number(dec, 0, 0, d);
+                } break;
+                case CBOR_FLOAT64: {
+                    double d;
+                    memcpy(&d, &v, sizeof(d));
+                    return on_number(dec, 0, 0, d);
+                } break;
+                default: break;
+            }
+        } break;
+        default: break;
+    }
+
+    E("unsupported cbor item: 0x%02x", dec->head[0]);
+    return -1;
+}
+
+int hvml_jo_cbor_dec_parse(hvml_jo_cbor_dec_t *dec, const char *buf, size_t len) {
+    if (dec->failed) return -1;
+
+    const char *p   = buf;
+    const char *end = buf + len;
+    while (p < end) {
+        if (dec->in_str) {
+            size_t n = dec->str_need - dec->str_len;
+            if (n > (size_t)(end - p)) n = end - p;
+            if (reserve_str(dec, dec->str_len + n + 1)) goto failed;
+            memcpy(dec->str + dec->str_len, p, n);
+            dec->str_len += n;
+            p            += n;
+            if (dec->str_len < dec->str_need) break;
+            dec->str[dec->str_len] = '\0';
+            dec->in_str = 0;
+            if (on_text(dec, dec->str, dec->str_len)) goto failed;
+            continue;
+        }
+
+        if (dec->head_len == 0) {
+            const int ai = (unsigned char)*p & 0x1f;
+            if (ai >= 28) {
+                E("indefinite length or reserved cbor item: 0x%02x", (unsigned char)*p);
+                goto failed;
+            }
+            dec->head_need = 1 + (ai < 24 ? 0 : (1 << (ai - 24)));
+        }
+        dec->head[dec->head_len++] = (unsigned char)*p++;
+        if (dec->head_len < dec->head_need) continue;
+
+        int ret = on_head(dec);
+        dec->head_len = 0;
+        if (ret) goto failed;
+    }
+    return 0;
+
+failed:
+    dec->failed = 1;
+    return -1;
+}
+
+hvml_jo_value_t* hvml_jo_cbor_dec_parse_end(hvml_jo_cbor_dec_t *dec) {
+    if (dec->failed || dec->frames_count || dec->head_len || dec->in_str) {
+        E("cbor item is incomplete");
+        return NULL;
+    }
+    hvml_jo_value_t *jo = dec->root;
+    dec->root = NULL;
+    return jo;
+}
+
+hvml_jo_value_t* hvml_jo_cbor_load_from_stream(FILE *in) {
+    hvml_jo_cbor_dec_t *dec = hvml_jo_cbor_dec_create();
+    if (!dec) return NULL;
+
+    char buf[4096];
+    int  n   = 0;
+    int  ret = 0;
+    while ( (n=fread(buf, 1, sizeof(buf), in))>0) {
+        ret = hvml_jo_cbor_dec_parse(dec, buf, n);
+        if (ret) break;
+    }
+    hvml_jo_value_t *jo = ret ? NULL : hvml_jo_cbor_dec_parse_end(dec);
+    hvml_jo_cbor_dec_destroy(dec);
+    return jo;
+}
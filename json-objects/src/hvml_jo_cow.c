@@ -0,0 +1,365 @@
+// This file is a part of Purring Cat, a reference implementation of HVML.
+//
+// Copyright (C) 2020, <freemine@yeah.net>.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+
+#include "hvml/hvml_jo_cow.h"
+
+#include "hvml/hvml_log.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct cow_member_s         cow_member_t;
+
+// key is NULL for members of arrays
+struct cow_member_s {
+    hvml_jo_cow_t          *key;
+    hvml_jo_cow_t          *val;
+};
+
+struct hvml_jo_cow_s {
+    HVML_JO_TYPE            jot;
+    int                     refs;
+
+    union {
+        struct {
+            int             integer;
+            int64_t         v_i;
+            double          v_d;
+            const char     *origin;
+        }                   num;
+        struct {
+            size_t          len;
+            const char     *str;
+        }                   str;
+        struct {
+            size_t          count;
+            cow_member_t   *members;
+        }                   list;
+    };
+    // followed by the bytes of the string or origin, or the members,
+    // all in one allocation
+};
+
+static hvml_jo_cow_t* cow_alloc(HVML_JO_TYPE jot, size_t extra) {
+    hvml_jo_cow_t *v = (hvml_jo_cow_t*)calloc(1, sizeof(*v) + extra);
+    if (!v) return NULL;
+    v->jot  = jot;
+    v->refs = 1;
+    return v;
+}
+
+static hvml_jo_cow_t* cow_string(const char *str, size_t len) {
+    hvml_jo_cow_t *v = cow_alloc(MKJOT(J_STRING), len + 1);
+    if (!v) return NULL;
+    char *p = (char*)(v + 1);
+    memcpy(p, str, len);
+    p[len]     = '\0';
+    v->str.str = p;
+    v->str.len = len;
+    return v;
+}
+
+static hvml_jo_cow_t* cow_list(HVML_JO_TYPE jot, size_t count) {
+    hvml_jo_cow_t *v = cow_alloc(jot, count * sizeof(cow_member_t));
+    if (!v) return NULL;
+    v->list.count   = count;
+    v->list.members = (cow_member_t*)(v + 1);
+    return v;
+}
+
+hvml_jo_cow_t* hvml_jo_cow_freeze(hvml_jo_value_t *jo) {
+    HVML_JO_TYPE   jot = hvml_jo_value_type(jo);
+    hvml_jo_cow_t *v   = NULL;
+    switch (jot) {
+        case MKJOT(J_TRUE):
+        case MKJOT(J_FALSE):
+        case MKJOT(J_NULL):
+        {
+            v = cow_alloc(jot, 0);
+        } break;
+        case MKJOT(J_NUMBER):
+        {
+            const char *origin = hvml_jo_value_origin(jo);
+            size_t      len    = origin ? strlen(origin) + 1 : 0;
+            v = cow_alloc(jot, len);
+            if (!v) break;
+            v->num.integer = hvml_jo_value_is_integer(jo);
+            v->num.v_i     = hvml_jo_value_integer(jo);
+            v->num.v_d     = hvml_jo_value_double(jo);
+            if (origin) {
+                memcpy(v + 1, origin, len);
+                v->num.origin = (const char*)(v + 1);
+            }
+        } break;
+        case MKJOT(J_STRING):
+        {
+            size_t      len = 0;
+            const char *str = hvml_jo_value_str(jo, &len);
+            v = cow_string(str, len);
+        } break;
+        case MKJOT(J_OBJECT):
+        case MKJOT(J_ARRAY):
+        {
+            v = cow_list(jot, hvml_jo_value_children(jo));
+            if (!v) break;
+            // members are filled in order, so that on failure those
+            // set so far are released with the list
+            size_t n = v->list.count;
+            v->list.count = 0;
+            hvml_jo_value_t *child = hvml_jo_value_first(jo);
+            for (size_t i=0; i<n && child; ++i, child = hvml_jo_value_next(child)) {
+                cow_member_t    *m   = v->list.members + i;
+                hvml_jo_value_t *val = child;
+                if (jot == MKJOT(J_OBJECT)) {
+                    size_t      len = 0;
+                    const char *key = hvml_jo_value_str(child, &len);
+                    m->key = cow_string(key, len);
+                    if (!m->key) break;
+                    val = hvml_jo_value_first(child);
+                }
+                // attention: recursive call
+                m->val = val ? hvml_jo_cow_freeze(val) : cow_alloc(MKJOT(J_NULL), 0);
+                if (!m->val) {
+                    if (m->key) hvml_jo_cow_unref(m->key);
+                    break;
+                }
+                ++v->list.count;
+            }
+            if (v->list.count != n) {
+                hvml_jo_cow_unref(v);
+                v = NULL;
+            }
+        } break;
+        default:
+        {
+            E("can't freeze jo[%p/%s]", jo, hvml_jo_value_type_str(jo));
+        } break;
+    }
+    return v;
+}
+
+hvml_jo_value_t* hvml_jo_cow_thaw(hvml_jo_cow_t *v) {
+    switch (v->jot) {
+        case MKJOT(J_TRUE):   return hvml_jo_true();
+        case MKJOT(J_FALSE):  return hvml_jo_false();
+        case MKJOT(J_NULL):   return hvml_jo_null();
+        case MKJOT(J_STRING): return hvml_jo_string(v->str.str, v->str.len);
+        case MKJOT(J_NUMBER):
+        {
+            if (v->num.integer) return hvml_jo_integer(v->num.v_i, v->num.origin);
+            return hvml_jo_double(v->num.v_d, v->num.origin);
+        } break;
+        case MKJOT(J_OBJECT):
+        case MKJOT(J_ARRAY):
+        {
+            hvml_jo_value_t *jo = v->jot == MKJOT(J_OBJECT) ? hvml_jo_object() : hvml_jo_array();
+            if (!jo) return NULL;
+            for (size_t i=0; i<v->list.count; ++i) {
+                const cow_member_t *m = v->list.members + i;
+                // attention: recursive call
+                hvml_jo_value_t *val = hvml_jo_cow_thaw(m->val);
+                hvml_jo_value_t *kv  = NULL;
+                if (val && m->key) {
+                    kv = hvml_jo_object_kv(m->key->str.str, m->key->str.len);
+                    if (kv && hvml_jo_value_push(kv, val)==0) {
+                        val = kv;
+                        kv  = NULL;
+                    }
+                }
+                if (!val || kv || hvml_jo_value_push(jo, val)) {
+                    if (kv)  hvml_jo_value_free(kv);
+                    if (val) hvml_jo_value_free(val);
+                    hvml_jo_value_free(jo);
+                    return NULL;
+                }
+            }
+            return jo;
+        } break;
+        default:
+        {
+            A(0, "internal logic error, unknown JOT: [%d]", v->jot);
+        } break;
+    }
+    return NULL;
+}
+
+hvml_jo_cow_t* hvml_jo_cow_ref(hvml_jo_cow_t *v) {
+    __atomic_add_fetch(&v->refs, 1, __ATOMIC_RELAXED);
+    return v;
+}
+
+void hvml_jo_cow_unref(hvml_jo_cow_t *v) {
+    if (__atomic_sub_fetch(&v->refs, 1, __ATOMIC_ACQ_REL)) return;
+
+    if (v->jot == MKJOT(J_OBJECT) || v->jot == MKJOT(J_ARRAY)) {
+        for (size_t i=0; i<v->list.count; ++i) {
+            cow_member_t *m = v->list.members + i;
+            if (m->key) hvml_jo_cow_unref(m->key);
+            // attention: recursive call
+            hvml_jo_cow_unref(m->val);
+        }
+    }
+    free(v);
+}
+
+HVML_JO_TYPE hvml_jo_cow_type(hvml_jo_cow_t *v) {
+    return v->jot;
+}
+
+size_t hvml_jo_cow_count(hvml_jo_cow_t *v) {
+    if (v->jot != MKJOT(J_OBJECT) && v->jot != MKJOT(J_ARRAY)) return 0;
+    return v->list.count;
+}
+
+hvml_jo_cow_t* hvml_jo_cow_at(hvml_jo_cow_t *v, size_t i) {
+    if (i >= hvml_jo_cow_count(v)) return NULL;
+    return v->list.members[i].val;
+}
+
+const char* hvml_jo_cow_key_at(hvml_jo_cow_t *v, size_t i, size_t *len) {
+    if (v->jot != MKJOT(J_OBJECT) || i >= v->list.count) return NULL;
+    hvml_jo_cow_t *key = v->list.members[i].key;
+    if (len) *len = key->str.len;
+    return key->str.str;
+}
+
+// index of the member `key` of an object, its # of members if none
+static size_t cow_index_of(hvml_jo_cow_t *v, const char *key, size_t len) {
+    size_t i = 0;
+    for (; i<v->list.count; ++i) {
+        const hvml_jo_cow_t *k = v->list.members[i].key;
+        if (k->str.len == len && memcmp(k->str.str, key, len)==0) break;
+    }
+    return i;
+}
+
+hvml_jo_cow_t* hvml_jo_cow_get(hvml_jo_cow_t *v, const char *key, size_t len) {
+    if (v->jot != MKJOT(J_OBJECT)) return NULL;
+    size_t i = cow_index_of(v, key, len);
+    return i < v->list.count ? v->list.members[i].val : NULL;
+}
+
+// index of the member `step` leads to, -1 if `v` is not of the kind
+// `step` applies to
+static int cow_step(hvml_jo_cow_t *v, const hvml_jo_cow_step_t *step, size_t *i) {
+    if (step->key) {
+        if (v->jot != MKJOT(J_OBJECT)) return -1;
+        *i = cow_index_of(v, step->key, step->len);
+    } else {
+        if (v->jot != MKJOT(J_ARRAY)) return -1;
+        *i = step->index;
+    }
+    return 0;
+}
+
+hvml_jo_cow_t* hvml_jo_cow_find(hvml_jo_cow_t *v, const hvml_jo_cow_step_t *path, size_t depth) {
+    for (size_t d=0; v && d<depth; ++d) {
+        size_t i = 0;
+        if (cow_step(v, path + d, &i)) return NULL;
+        v = hvml_jo_cow_at(v, i);
+    }
+    return v;
+}
+
+int hvml_jo_cow_is_integer(hvml_jo_cow_t *v) {
+    return v->jot == MKJOT(J_NUMBER) && v->num.integer;
+}
+
+int64_t hvml_jo_cow_integer(hvml_jo_cow_t *v) {
+    A(v->jot == MKJOT(J_NUMBER), "internal logic error");
+    return v->num.integer ? v->num.v_i : (int64_t)v->num.v_d;
+}
+
+double hvml_jo_cow_double(hvml_jo_cow_t *v) {
+    A(v->jot == MKJOT(J_NUMBER), "internal logic error");
+    return v->num.integer ? (double)v->num.v_i : v->num.v_d;
+}
+
+const char* hvml_jo_cow_str(hvml_jo_cow_t *v, size_t *len) {
+    if (v->jot != MKJOT(J_STRING)) return NULL;
+    if (len) *len = v->str.len;
+    return v->str.str;
+}
+
+// copy `v` with the value at the end of `path` set to `val`, or removed
+// if `val` is NULL; the members out of `path` are shared
+static hvml_jo_cow_t* cow_update(hvml_jo_cow_t *v, const hvml_jo_cow_step_t *path,
+                                 size_t depth, hvml_jo_cow_t *val)
+{
+    size_t i = 0;
+    if (cow_step(v, path, &i)) return NULL;
+
+    const size_t count  = v->list.count;
+    const int    last   = depth == 1;
+    const int    append = i == count;
+    if (i > count || (append && (!last || !val))) return NULL;
+
+    hvml_jo_cow_t *nv = NULL;
+    if (!last) {
+        // attention: recursive call
+        nv = cow_update(v->list.members[i].val, path + 1, depth - 1, val);
+        if (!nv) return NULL;
+    } else if (val) {
+        nv = hvml_jo_cow_ref(val);
+    }
+
+    hvml_jo_cow_t *key = NULL;
+    if (append && path->key) {
+        key = cow_string(path->key, path->len);
+        if (!key) {
+            hvml_jo_cow_unref(nv);
+            return NULL;
+        }
+    }
+
+    hvml_jo_cow_t *copy = cow_list(v->jot, nv ? count + append : count - 1);
+    if (!copy) {
+        if (nv)  hvml_jo_cow_unref(nv);
+        if (key) hvml_jo_cow_unref(key);
+        return NULL;
+    }
+
+    cow_member_t *m = copy->list.members;
+    for (size_t j=0; j<count; ++j) {
+        const cow_member_t *o = v->list.members + j;
+        if (j == i && !nv) continue;
+        m->key = o->key ? hvml_jo_cow_ref(o->key) : NULL;
+        m->val = j == i ? nv : hvml_jo_cow_ref(o->val);
+        ++m;
+    }
+    if (append) {
+        m->key = key;
+        m->val = nv;
+    }
+    return copy;
+}
+
+hvml_jo_cow_t* hvml_jo_cow_set(hvml_jo_cow_t *root, const hvml_jo_cow_step_t *path,
+                               size_t depth, hvml_jo_cow_t *val)
+{
+    if (depth == 0) return hvml_jo_cow_ref(val);
+    return cow_update(root, path, depth, val);
+}
+
+hvml_jo_cow_t* hvml_jo_cow_remove(hvml_jo_cow_t *root, const hvml_jo_cow_step_t *path,
+                                  size_t depth)
+{
+    if (depth == 0) return NULL;
+    return cow_update(root, path, depth, NULL);
+}
+
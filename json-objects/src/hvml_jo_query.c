@@ -0,0 +1,396 @@
+// This file is a part of Purring Cat, a reference implementation of HVML.
+//
+// Copyright (C) 2020, <freemine@yeah.net>.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#include "hvml/hvml_jo_query.h"
+
+#include "hvml/hvml_json_parser.h"
+#include "hvml/hvml_log.h"
+#include "hvml/hvml_mmap.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+typedef enum {
+    STEP_KEY,
+    STEP_INDEX,
+    STEP_ANY
+} QUERY_STEP;
+
+typedef struct query_step_s           query_step_t;
+typedef struct query_frame_s          query_frame_t;
+
+struct query_step_s {
+    QUERY_STEP               kind;
+    const char              *key;      // within query->path
+    size_t                   len;
+    size_t                   index;
+};
+
+// a container on the path: the step after it applies to its members
+struct query_frame_s {
+    unsigned int             is_array:1;
+    unsigned int             key_match:1;   // the member the key is of
+    size_t                   next;          // index of the next element
+};
+
+struct hvml_jo_query_s {
+    hvml_json_parser_t      *parser;
+    hvml_jo_query_on_match   on_match;
+    void                    *arg;
+
+    char                    *path;
+    query_step_t            *steps;
+    size_t                   nsteps;
+
+    // one frame per step at most, deeper is either matched or skipped
+    query_frame_t           *frames;
+    size_t                   depth;
+    // the match being built, down to where it is built to
+    hvml_jo_value_t         *jo;
+
+    size_t                   matches;
+};
+
+static int parse_path(hvml_jo_query_t *query) {
+    char *p = query->path;
+    if (*p == '$') ++p;
+
+    while (*p) {
+        query_step_t *step = query->steps + query->nsteps;
+        if (*p == '.') {
+            ++p;
+            if (*p == '*') {
+                step->kind = STEP_ANY;
+                ++p;
+            } else {
+                size_t len = strcspn(p, ".[");
+                if (len == 0) return -1;
+                step->kind = STEP_KEY;
+                step->key  = p;
+                step->len  = len;
+                p += len;
+            }
+        } else if (*p == '[') {
+            ++p;
+            if (*p == '*') {
+                step->kind = STEP_ANY;
+                ++p;
+            } else if (*p == '\'' || *p == '"') {
+                const char *end = strchr(p + 1, *p);
+                if (!end) return -1;
+                step->kind = STEP_KEY;
+                step->key  = p + 1;
+                step->len  = (size_t)(end - p - 1);
+                p = (char*)end + 1;
+            } else {
+                char *end = NULL;
+                if (*p < '0' || *p > '9') return -1;
+                step->kind  = STEP_INDEX;
+                step->index = strtoul(p, &end, 10);
+                p = end;
+            }
+            if (*p != ']') return -1;
+            ++p;
+        } else {
+            return -1;
+        }
+        ++query->nsteps;
+    }
+
+    return 0;
+}
+
+static int on_open_array(void *arg);
+static int on_close_array(void *arg);
+static int on_open_obj(void *arg);
+static int on_close_obj(void *arg);
+static int on_key(void *arg, const char *key, size_t len);
+static int on_true(void *arg);
+static int on_false(void *arg);
+static int on_null(void *arg);
+static int on_string(void *arg, const char *val, size_t len);
+static int on_integer(void *arg, const char *origin, int64_t val);
+static int on_double(void *arg, const char *origin, double val);
+
+hvml_jo_query_t* hvml_jo_query_create(const char *path, hvml_jo_query_on_match on_match, void *arg) {
+    hvml_jo_query_t *query = (hvml_jo_query_t*)calloc(1, sizeof(*query));
+    if (!query) return NULL;
+
+    query->on_match = on_match;
+    query->arg      = arg;
+
+    // each step takes 2 chars at least
+    const size_t cap = strlen(path) / 2 + 1;
+    query->path   = strdup(path);
+    query->steps  = (query_step_t*)calloc(cap, sizeof(*query->steps));
+    query->frames = (query_frame_t*)calloc(cap, sizeof(*query->frames));
+    if (!query->path || !query->steps || !query->frames) {
+        hvml_jo_query_destroy(query);
+        return NULL;
+    }
+    if (parse_path(query)) {
+        E("malformed path: %s", path);
+        hvml_jo_query_destroy(query);
+        return NULL;
+    }
+
+    hvml_json_parser_conf_t conf = {0};
+    conf.on_open_array          = on_open_array;
+    conf.on_close_array         = on_close_array;
+    conf.on_open_obj            = on_open_obj;
+    conf.on_close_obj           = on_close_obj;
+    conf.on_key                 = on_key;
+    conf.on_true                = on_true;
+    conf.on_false               = on_false;
+    conf.on_null                = on_null;
+    conf.on_string              = on_string;
+    conf.on_integer             = on_integer;
+    conf.on_double              = on_double;
+
+    conf.arg                    = query;
+
+    query->parser = hvml_json_parser_create(conf);
+    if (!query->parser) {
+        hvml_jo_query_destroy(query);
+        return NULL;
+    }
+
+    return query;
+}
+
+void hvml_jo_query_destroy(hvml_jo_query_t *query) {
+    if (query->jo) {
+        hvml_jo_value_free(hvml_jo_value_root(query->jo));
+        query->jo = NULL;
+    }
+    if (query->parser) {
+        hvml_json_parser_destroy(query->parser);
+        query->parser = NULL;
+    }
+    free(query->frames);
+    free(query->steps);
+    free(query->path);
+    free(query);
+}
+
+void hvml_jo_query_reset(hvml_jo_query_t *query) {
+    if (query->jo) {
+        hvml_jo_value_free(hvml_jo_value_root(query->jo));
+        query->jo = NULL;
+    }
+    query->depth   = 0;
+    query->matches = 0;
+    hvml_json_parser_reset(query->parser);
+}
+
+int hvml_jo_query_parse(hvml_jo_query_t *query, const char *buf, size_t len) {
+    return hvml_json_parser_parse(query->parser, buf, len);
+}
+
+int hvml_jo_query_parse_end(hvml_jo_query_t *query) {
+    return hvml_json_parser_parse_end(query->parser);
+}
+
+size_t hvml_jo_query_matches(hvml_jo_query_t *query) {
+    return query->matches;
+}
+
+int hvml_jo_query_file(const char *path, const char *file,
+                       hvml_jo_query_on_match on_match, void *arg)
+{
+    hvml_jo_query_t *query = hvml_jo_query_create(path, on_match, arg);
+    if (!query) return -1;
+
+    int         ret = 0;
+    hvml_mmap_t map;
+    int r = hvml_mmap_open(&map, file);
+    if (r == 0) {
+        ret = hvml_jo_query_parse(query, map.buf, map.len);
+        hvml_mmap_close(&map);
+    } else if (r == -1) {
+        ret = -1;
+    } else {
+        FILE *in = fopen(file, "rb");
+        if (!in) {
+            ret = -1;
+        } else {
+            char   buf[4096];
+            size_t n;
+            while (ret==0 && (n=fread(buf, 1, sizeof(buf), in))>0) {
+                ret = hvml_jo_query_parse(query, buf, n);
+            }
+            fclose(in);
+        }
+    }
+    if (ret==0) ret = hvml_jo_query_parse_end(query);
+
+    hvml_jo_query_destroy(query);
+    return ret;
+}
+
+// if the value starting is on the path, counting it as an element
+// of the array it is in
+static int on_path(hvml_jo_query_t *query) {
+    if (query->depth == 0) return 1;
+
+    query_frame_t *frame = query->frames + query->depth - 1;
+    query_step_t  *step  = query->steps  + query->depth - 1;
+    if (!frame->is_array) return frame->key_match;
+
+    size_t idx = frame->next++;
+    return step->kind == STEP_ANY || (step->kind == STEP_INDEX && step->index == idx);
+}
+
+static int emit(hvml_jo_query_t *query, hvml_jo_value_t *jo) {
+    ++query->matches;
+    int ret = query->on_match ? query->on_match(query->arg, jo) : 0;
+    hvml_jo_value_free(jo);
+    return ret;
+}
+
+// a scalar is wanted if it is matched or within a match
+static int wants(hvml_jo_query_t *query) {
+    if (query->jo) return 1;
+    return on_path(query) && query->depth == query->nsteps;
+}
+
+static int add_scalar(hvml_jo_query_t *query, hvml_jo_value_t *jo) {
+    if (!jo) return -1;
+    if (!query->jo) return emit(query, jo);
+
+    if (hvml_jo_value_push(query->jo, jo)) {
+        hvml_jo_value_free(jo);
+        return -1;
+    }
+    query->jo = hvml_jo_value_parent(jo);
+
+    return 0;
+}
+
+static int open_container(hvml_jo_query_t *query, int is_array) {
+    if (!query->jo) {
+        if (!on_path(query)) return HVML_JSON_PARSER_SKIP;
+        if (query->depth < query->nsteps) {
+            query_frame_t *frame = query->frames + query->depth++;
+            frame->is_array  = is_array;
+            frame->key_match = 0;
+            frame->next      = 0;
+            return 0;
+        }
+    }
+
+    hvml_jo_value_t *jo = is_array ? hvml_jo_array() : hvml_jo_object();
+    if (!jo) return -1;
+    if (query->jo && hvml_jo_value_push(query->jo, jo)) {
+        hvml_jo_value_free(jo);
+        return -1;
+    }
+    query->jo = jo;
+
+    return 0;
+}
+
+static int close_container(hvml_jo_query_t *query) {
+    if (!query->jo) {
+        A(query->depth>0, "internal logic error");
+        --query->depth;
+        return 0;
+    }
+
+    hvml_jo_value_t *jo = query->jo;
+    if (hvml_jo_value_type(jo) == MKJOT(J_OBJECT) && hvml_jo_object_reshape(jo)) return -1;
+
+    query->jo = hvml_jo_value_parent(jo);
+    if (query->jo) return 0;
+
+    return emit(query, jo);
+}
+
+static int on_open_array(void *arg) {
+    return open_container((hvml_jo_query_t*)arg, 1);
+}
+
+static int on_close_array(void *arg) {
+    return close_container((hvml_jo_query_t*)arg);
+}
+
+static int on_open_obj(void *arg) {
+    return open_container((hvml_jo_query_t*)arg, 0);
+}
+
+static int on_close_obj(void *arg) {
+    return close_container((hvml_jo_query_t*)arg);
+}
+
+static int on_key(void *arg, const char *key, size_t len) {
+    hvml_jo_query_t *query = (hvml_jo_query_t*)arg;
+    if (query->jo) {
+        hvml_jo_value_t *kv = hvml_jo_object_kv(key, len);
+        if (!kv) return -1;
+        if (hvml_jo_value_push(query->jo, kv)) {
+            hvml_jo_value_free(kv);
+            return -1;
+        }
+        query->jo = kv;
+        return 0;
+    }
+
+    A(query->depth>0, "internal logic error");
+    query_frame_t *frame = query->frames + query->depth - 1;
+    query_step_t  *step  = query->steps  + query->depth - 1;
+    frame->key_match = step->kind == STEP_ANY ||
+                       (step->kind == STEP_KEY && step->len == len && memcmp(step->key, key, len)==0);
+
+    return frame->key_match ? 0 : HVML_JSON_PARSER_SKIP;
+}
+
+static int on_true(void *arg) {
+    hvml_jo_query_t *query = (hvml_jo_query_t*)arg;
+    if (!wants(query)) return 0;
+    return add_scalar(query, hvml_jo_true());
+}
+
+static int on_false(void *arg) {
+    hvml_jo_query_t *query = (hvml_jo_query_t*)arg;
+    if (!wants(query)) return 0;
+    return add_scalar(query, hvml_jo_false());
+}
+
+static int on_null(void *arg) {
+    hvml_jo_query_t *query = (hvml_jo_query_t*)arg;
+    if (!wants(query)) return 0;
+    return add_scalar(query, hvml_jo_null());
+}
+
+static int on_string(void *arg, const char *val, size_t len) {
+    hvml_jo_query_t *query = (hvml_jo_query_t*)arg;
+    if (!wants(query)) return 0;
+    return add_scalar(query, hvml_jo_string(val, len));
+}
+
+static int on_integer(void *arg, const char *origin, int64_t val) {
+    hvml_jo_query_t *query = (hvml_jo_query_t*)arg;
+    if (!wants(query)) return 0;
+    return add_scalar(query, hvml_jo_integer(val, origin));
+}
+
+static int on_double(void *arg, const char *origin, double val) {
+    hvml_jo_query_t *query = (hvml_jo_query_t*)arg;
+    if (!wants(query)) return 0;
+    return add_scalar(query, hvml_jo_double(val, origin));
+}
+
@@ -17,14 +17,19 @@
 
 #include "hvml/hvml_dom.h"
 
+#include "hvml/hvml_dom_pos.h"
 #include "hvml/hvml_jo.h"
 #include "hvml/hvml_json_parser.h"
 #include "hvml/hvml_list.h"
+#include "hvml/hvml_mmap.h"
 #include "hvml/hvml_parser.h"
 #include "hvml/hvml_string.h"
 
 #include <ctype.h>
+#include <errno.h>
+#include <pthread.h>
 #include <string.h>
+#include <unistd.h>
 
 // for easy coding
 #define DOM_MEMBERS() \
@@ -59,8 +64,12 @@ typedef struct hvml_dom_tag_s               hvml_dom_tag_t;
 typedef struct hvml_dom_attr_s              hvml_dom_attr_t;
 typedef struct hvml_dom_text_s              hvml_dom_text_t;
 
+// the source span of an element, from its '<' to past its last '>';
+// keeps the tag no larger than an attr, so nodes don't grow
 struct hvml_dom_tag_s {
     hvml_string_t       name;
+    size_t              start;
+    size_t              end;
 };
 
 struct hvml_dom_attr_s {
@@ -86,11 +95,36 @@ struct hvml_dom_s {
     DOM_MEMBERS();
 };
 
+typedef struct hvml_dom_tmpl_init_s         hvml_dom_tmpl_init_t;
+
+struct hvml_dom_tmpl_init_s {
+    const hvml_string_t *as;
+    hvml_jo_value_t     *jo;
+};
+
+struct hvml_dom_tmpl_s {
+    hvml_dom_t            *dom;
+    size_t                 refs;
+
+    hvml_dom_tmpl_init_t  *ar_inits;
+    size_t                 inits;
+
+    // frozen session state, built on first share
+    hvml_jo_cow_t         *shared;
+};
+
 struct hvml_dom_gen_s {
     hvml_dom_t          *dom;
     hvml_dom_t          *root;
     hvml_parser_t       *parser;
     hvml_jo_value_t     *jo;
+    // node positions, when recorded: of the document being parsed, and
+    // of the last one parsed
+    hvml_dom_pos_t      *pos;
+    hvml_dom_pos_t      *done;
+    size_t               jo_start;
+    // keys of the json data of the document being built
+    hvml_jo_symtab_t    *symtab;
 };
 
 hvml_dom_t* hvml_dom_create() {
@@ -329,6 +363,74 @@ hvml_dom_t* hvml_dom_prev(hvml_dom_t *dom) {
     return DOM_PREV(dom);
 }
 
+HVML_DOM_TYPE hvml_dom_type(hvml_dom_t *dom) {
+    return dom->dt;
+}
+
+hvml_dom_t* hvml_dom_first_child(hvml_dom_t *dom) {
+    return DOM_HEAD(dom);
+}
+
+hvml_dom_t* hvml_dom_first_attr(hvml_dom_t *dom) {
+    return DOM_ATTR_HEAD(dom);
+}
+
+hvml_dom_t* hvml_dom_next_attr(hvml_dom_t *dom) {
+    return DOM_ATTR_NEXT(dom);
+}
+
+const char* hvml_dom_name(hvml_dom_t *dom, size_t *len) {
+    switch (dom->dt) {
+        case MKDOT(D_TAG):
+        {
+            *len = dom->tag.name.len;
+            return dom->tag.name.str;
+        } break;
+        case MKDOT(D_ATTR):
+        {
+            *len = dom->attr.key.len;
+            return dom->attr.key.str;
+        } break;
+        default:
+        {
+            A(0, "internal logic error");
+            return NULL;
+        } break;
+    }
+}
+
+const char* hvml_dom_value(hvml_dom_t *dom, size_t *len) {
+    switch (dom->dt) {
+        case MKDOT(D_ATTR):
+        {
+            *len = dom->attr.val.len;
+            return dom->attr.val.str;
+        } break;
+        case MKDOT(D_TEXT):
+        {
+            *len = dom->txt.txt.len;
+            return dom->txt.txt.str;
+        } break;
+        default:
+        {
+            A(0, "internal logic error");
+            return NULL;
+        } break;
+    }
+}
+
+hvml_jo_value_t* hvml_dom_jo(hvml_dom_t *dom) {
+    A(dom->dt == MKDOT(D_JSON), "internal logic error");
+    return dom->jo;
+}
+
+int hvml_dom_span(hvml_dom_t *dom, size_t *start, size_t *end) {
+    if (dom->dt != MKDOT(D_TAG)) return -1;
+    *start = dom->tag.start;
+    *end   = dom->tag.end;
+    return 0;
+}
+
 void hvml_dom_detach(hvml_dom_t *dom) {
     if (DOM_OWNER(dom)) {
         DOM_REMOVE(dom);
@@ -444,7 +546,7 @@ void hvml_dom_traverse(hvml_dom_t *dom, FILE *out, traverse_callback *out_funcs)
                 //fprintf(out, ">");
                 out_funcs->out_tag_close(out);
                 while (child) {
-                    hvml_dom_close(child, out);
+                    hvml_dom_traverse(child, out, out_funcs);
                     child = DOM_NEXT(child);
                 }
                 //fprintf(out, "</");
@@ -481,6 +583,134 @@ void hvml_dom_traverse(hvml_dom_t *dom, FILE *out, traverse_callback *out_funcs)
     }
 }
 
+static int hvml_dom_tmpl_collect_inits(hvml_dom_tmpl_t *tmpl, hvml_dom_t *dom) {
+    if (dom->dt != MKDOT(D_TAG)) return 0;
+
+    if (strcmp(dom->tag.name.str, "init")==0) {
+        const hvml_string_t *as = NULL;
+        hvml_dom_t *attr = DOM_ATTR_HEAD(dom);
+        while (attr) {
+            if (strcmp(attr->attr.key.str, "as")==0 && attr->attr.val.str) {
+                as = &attr->attr.val;
+                break;
+            }
+            attr = DOM_ATTR_NEXT(attr);
+        }
+        hvml_dom_t *child = DOM_HEAD(dom);
+        while (as && child) {
+            if (child->dt == MKDOT(D_JSON)) {
+                hvml_dom_tmpl_init_t *ar;
+                ar = (hvml_dom_tmpl_init_t*)realloc(tmpl->ar_inits, (tmpl->inits + 1) * sizeof(*ar));
+                if (!ar) return -1;
+                ar[tmpl->inits].as  = as;
+                ar[tmpl->inits].jo  = child->jo;
+                tmpl->ar_inits      = ar;
+                tmpl->inits        += 1;
+                break;
+            }
+            child = DOM_NEXT(child);
+        }
+        return 0;
+    }
+
+    hvml_dom_t *child = DOM_HEAD(dom);
+    while (child) {
+        // attention: recursive call
+        if (hvml_dom_tmpl_collect_inits(tmpl, child)) return -1;
+        child = DOM_NEXT(child);
+    }
+    return 0;
+}
+
+hvml_dom_tmpl_t* hvml_dom_tmpl_create(hvml_dom_t *dom) {
+    A(DOM_OWNER(dom)==NULL, "internal logic error");
+
+    hvml_dom_tmpl_t *tmpl = (hvml_dom_tmpl_t*)calloc(1, sizeof(*tmpl));
+    if (!tmpl) return NULL;
+
+    if (hvml_dom_tmpl_collect_inits(tmpl, dom)) {
+        free(tmpl->ar_inits);
+        free(tmpl);
+        return NULL;
+    }
+
+    tmpl->dom  = dom;
+    tmpl->refs = 1;
+
+    return tmpl;
+}
+
+hvml_dom_tmpl_t* hvml_dom_tmpl_ref(hvml_dom_tmpl_t *tmpl) {
+    __atomic_add_fetch(&tmpl->refs, 1, __ATOMIC_RELAXED);
+    return tmpl;
+}
+
+void hvml_dom_tmpl_unref(hvml_dom_tmpl_t *tmpl) {
+    if (__atomic_sub_fetch(&tmpl->refs, 1, __ATOMIC_ACQ_REL)) return;
+
+    hvml_dom_destroy(tmpl->dom);
+    tmpl->dom = NULL;
+    free(tmpl->ar_inits);
+    tmpl->ar_inits = NULL;
+    if (tmpl->shared) hvml_jo_cow_unref(tmpl->shared);
+    free(tmpl);
+}
+
+hvml_dom_t* hvml_dom_tmpl_dom(hvml_dom_tmpl_t *tmpl) {
+    return tmpl->dom;
+}
+
+size_t hvml_dom_tmpl_inits(hvml_dom_tmpl_t *tmpl) {
+    return tmpl->inits;
+}
+
+hvml_jo_value_t* hvml_dom_tmpl_fork_inits(hvml_dom_tmpl_t *tmpl) {
+    hvml_jo_value_t *state = hvml_jo_object();
+    if (!state) return NULL;
+
+    for (size_t i=0; i<tmpl->inits; ++i) {
+        const hvml_dom_tmpl_init_t *init = tmpl->ar_inits + i;
+        hvml_jo_value_t *kv  = hvml_jo_object_kv(init->as->str, init->as->len);
+        hvml_jo_value_t *val = hvml_jo_value_clone(init->jo);
+        int ok = 0;
+        do {
+            if (!kv || !val) break;
+            if (hvml_jo_value_push(kv, val)) break;
+            val = NULL; // owned by kv
+            if (hvml_jo_value_push(state, kv)) break;
+            ok  = 1;
+        } while (0);
+        if (ok) continue;
+        if (val) hvml_jo_value_free(val);
+        if (kv)  hvml_jo_value_free(kv);
+        hvml_jo_value_free(state);
+        return NULL;
+    }
+
+    return state;
+}
+
+hvml_jo_cow_t* hvml_dom_tmpl_share_inits(hvml_dom_tmpl_t *tmpl) {
+    hvml_jo_cow_t *shared = __atomic_load_n(&tmpl->shared, __ATOMIC_ACQUIRE);
+    if (shared) return hvml_jo_cow_ref(shared);
+
+    hvml_jo_value_t *state = hvml_dom_tmpl_fork_inits(tmpl);
+    if (!state) return NULL;
+    shared = hvml_jo_cow_freeze(state);
+    hvml_jo_value_free(state);
+    if (!shared) return NULL;
+
+    // first to freeze wins, the others drop theirs
+    hvml_jo_cow_t *expected = NULL;
+    if (!__atomic_compare_exchange_n(&tmpl->shared, &expected, shared, 0,
+                                     __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+    {
+        hvml_jo_cow_unref(shared);
+        shared = expected;
+    }
+    return hvml_jo_cow_ref(shared);
+}
+
 static int on_open_tag(void *arg, const char *tag);
 static int on_attr_key(void *arg, const char *key);
 static int on_attr_val(void *arg, const char *val);
@@ -531,7 +761,8 @@ hvml_dom_gen_t* hvml_dom_gen_create() {
 
 
     gen->parser = hvml_parser_create(conf);
-    if (!gen->parser) {
+    gen->symtab = hvml_jo_symtab_create();
+    if (!gen->parser || !gen->symtab) {
         hvml_dom_gen_destroy(gen);
         return NULL;
     }
@@ -552,13 +783,80 @@ void hvml_dom_gen_destroy(hvml_dom_gen_t *gen) {
     }
 
     if (gen->jo) {
-        hvml_jo_value_free(gen->jo);
+        hvml_jo_value_free(hvml_jo_value_root(gen->jo));
         gen->jo = NULL;
     }
 
+    hvml_dom_pos_destroy(gen->pos);
+    hvml_dom_pos_destroy(gen->done);
+
+    if (gen->symtab) {
+        hvml_jo_symtab_destroy(gen->symtab);
+        gen->symtab = NULL;
+    }
+
     free(gen);
 }
 
+void hvml_dom_gen_reset(hvml_dom_gen_t *gen) {
+    if (gen->dom) {
+        hvml_dom_t *root = hvml_dom_root(gen->dom);
+        hvml_dom_destroy(root);
+        gen->dom = NULL;
+    }
+    // the previous document, if any, belongs to the caller now
+    gen->root = NULL;
+
+    if (gen->jo) {
+        hvml_jo_value_free(hvml_jo_value_root(gen->jo));
+        gen->jo = NULL;
+    }
+
+    if (gen->pos) hvml_dom_pos_reset(gen->pos);
+    hvml_jo_symtab_reset(gen->symtab);
+
+    hvml_parser_reset(gen->parser);
+}
+
+// one ready generator kept per thread, destroyed when the thread exits
+static pthread_key_t  gen_pool_key;
+static pthread_once_t gen_pool_once = PTHREAD_ONCE_INIT;
+
+static void gen_pool_destroy(void *arg) {
+    hvml_dom_gen_destroy((hvml_dom_gen_t*)arg);
+}
+
+static void gen_pool_init(void) {
+    pthread_key_create(&gen_pool_key, gen_pool_destroy);
+}
+
+hvml_dom_gen_t* hvml_dom_gen_acquire() {
+    pthread_once(&gen_pool_once, gen_pool_init);
+
+    hvml_dom_gen_t *gen = (hvml_dom_gen_t*)pthread_getspecific(gen_pool_key);
+    if (gen) {
+        pthread_setspecific(gen_pool_key, NULL);
+        return gen;
+    }
+    return hvml_dom_gen_create();
+}
+
+void hvml_dom_gen_release(hvml_dom_gen_t *gen) {
+    if (!gen) return;
+
+    pthread_once(&gen_pool_once, gen_pool_init);
+
+    if (pthread_getspecific(gen_pool_key) ||
+        hvml_dom_gen_set_stats(gen, 0) ||
+        hvml_dom_gen_set_positions(gen, 0) ||
+        pthread_setspecific(gen_pool_key, gen))
+    {
+        hvml_dom_gen_destroy(gen);
+        return;
+    }
+    hvml_dom_gen_reset(gen);
+}
+
 int hvml_dom_gen_parse_char(hvml_dom_gen_t *gen, const char c) {
     return hvml_parser_parse_char(gen->parser, c);
 }
@@ -578,11 +876,50 @@ hvml_dom_t* hvml_dom_gen_parse_end(hvml_dom_gen_t *gen) {
     hvml_dom_t *dom   = gen->dom;
     gen->dom          = NULL;
 
+    if (gen->pos) {
+        // keep the buffers of the older ones for the next document
+        hvml_dom_pos_t *pos = gen->done;
+        gen->done = gen->pos;
+        gen->pos  = pos ? pos : hvml_dom_pos_create();
+        if (!gen->pos) {
+            hvml_dom_pos_destroy(gen->done);
+            gen->done = NULL;
+        } else {
+            hvml_dom_pos_reset(gen->pos);
+        }
+    }
+
     return dom;
 }
 
+int hvml_dom_gen_set_stats(hvml_dom_gen_t *gen, int enable) {
+    return hvml_parser_set_stats(gen->parser, enable);
+}
+
+int hvml_dom_gen_get_stats(hvml_dom_gen_t *gen, hvml_parser_stats_t *stats) {
+    return hvml_parser_get_stats(gen->parser, stats);
+}
+
+int hvml_dom_gen_set_positions(hvml_dom_gen_t *gen, int enable) {
+    if (!enable) {
+        hvml_dom_pos_destroy(gen->pos);
+        hvml_dom_pos_destroy(gen->done);
+        gen->pos  = NULL;
+        gen->done = NULL;
+        return 0;
+    }
+    if (!gen->pos) gen->pos = hvml_dom_pos_create();
+    return gen->pos ? 0 : -1;
+}
+
+hvml_dom_pos_t* hvml_dom_gen_take_positions(hvml_dom_gen_t *gen) {
+    hvml_dom_pos_t *pos = gen->done;
+    gen->done = NULL;
+    return pos;
+}
+
 hvml_dom_t* hvml_dom_load_from_stream(FILE *in) {
-    hvml_dom_gen_t *gen = hvml_dom_gen_create();
+    hvml_dom_gen_t *gen = hvml_dom_gen_acquire();
     if (!gen) return NULL;
 
     char buf[4096] = {0};
@@ -594,7 +931,7 @@ hvml_dom_t* hvml_dom_load_from_stream(FILE *in) {
         if (ret) break;
     }
     hvml_dom_t *dom = hvml_dom_gen_parse_end(gen);
-    hvml_dom_gen_destroy(gen);
+    hvml_dom_gen_release(gen);
 
     if (ret==0) {
         return dom;
@@ -603,15 +940,220 @@ hvml_dom_t* hvml_dom_load_from_stream(FILE *in) {
     return NULL;
 }
 
+// parse a document held in memory
+static hvml_dom_t* load_from_buffer(const char *buf, size_t len) {
+    hvml_dom_gen_t *gen = hvml_dom_gen_acquire();
+    if (!gen) return NULL;
+
+    int ret = hvml_dom_gen_parse(gen, buf, len);
+    hvml_dom_t *dom = hvml_dom_gen_parse_end(gen);
+    hvml_dom_gen_release(gen);
+
+    if (ret && dom) {
+        hvml_dom_destroy(dom);
+        dom = NULL;
+    }
+    return dom;
+}
+
+// `*err` is set to errno if the file could not be opened,
+// or -1 if it failed to parse
+static hvml_dom_t* load_from_file(const char *file, int *err) {
+    hvml_mmap_t map;
+    int r = hvml_mmap_open(&map, file);
+    if (r == -1) {
+        *err = errno ? errno : -1;
+        return NULL;
+    }
+
+    hvml_dom_t *dom = NULL;
+    if (r) {
+        FILE *in = fopen(file, "rb");
+        if (!in) {
+            *err = errno ? errno : -1;
+            return NULL;
+        }
+        dom = hvml_dom_load_from_stream(in);
+        fclose(in);
+    } else {
+        // the whole file in one go, no copy
+        dom = load_from_buffer(map.buf, map.len);
+        hvml_mmap_close(&map);
+    }
+
+    *err = dom ? 0 : -1;
+    return dom;
+}
+
+hvml_dom_t* hvml_dom_load_from_file(const char *file) {
+    int err = 0;
+    return load_from_file(file, &err);
+}
+
+typedef struct load_many_s          load_many_t;
+struct load_many_s {
+    const char     **files;
+    size_t           count;
+    hvml_dom_t     **doms;
+    int             *errs;
+    size_t           next;    // next file to be taken by a worker
+};
+
+static void* load_many_routine(void *arg) {
+    load_many_t *lm = (load_many_t*)arg;
+    while (1) {
+        size_t i = __atomic_fetch_add(&lm->next, 1, __ATOMIC_RELAXED);
+        if (i >= lm->count) break;
+
+        lm->doms[i] = load_from_file(lm->files[i], &lm->errs[i]);
+    }
+    return NULL;
+}
+
+int hvml_dom_load_many(const char **files, size_t count, int threads, hvml_dom_t **doms, int *errs) {
+    load_many_t lm = {0};
+    lm.files = files;
+    lm.count = count;
+    lm.doms  = doms;
+    lm.errs  = errs;
+
+    if (threads <= 0) threads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    if (threads <= 0) threads = 1;
+    if ((size_t)threads > count) threads = (int)count;
+
+    // the calling thread is one of the workers
+    pthread_t *tids    = NULL;
+    int        spawned = 0;
+    if (threads > 1) {
+        tids = (pthread_t*)calloc(threads - 1, sizeof(*tids));
+        for (int i=0; tids && i<threads-1; ++i) {
+            if (pthread_create(&tids[i], NULL, load_many_routine, &lm)) break;
+            ++spawned;
+        }
+    }
+    load_many_routine(&lm);
+    for (int i=0; i<spawned; ++i) {
+        pthread_join(tids[i], NULL);
+    }
+    free(tids);
+
+    int failed = 0;
+    for (size_t i=0; i<count; ++i) {
+        if (errs[i]) ++failed;
+    }
+    return failed;
+}
+
+
+
+
+// move the spans of the elements of the tree by `delta`, for those
+// starting at or after `from`, and stretch those enclosing `from`
+static void shift_spans(hvml_dom_t *dom, size_t from, size_t delta) {
+    if (dom->dt != MKDOT(D_TAG)) return;
+    if (dom->tag.start >= from) {
+        dom->tag.start += delta;
+        dom->tag.end   += delta;
+    } else if (dom->tag.end >= from) {
+        dom->tag.end   += delta;
+    } else {
+        return;
+    }
+    hvml_dom_t *child = DOM_HEAD(dom);
+    while (child) {
+        // attention: recursive call
+        shift_spans(child, from, delta);
+        child = DOM_NEXT(child);
+    }
+}
+
+// put `v` at the place of `old` amongst its siblings
+static void dom_replace(hvml_dom_t *old, hvml_dom_t *v) {
+    hvml_dom_t *owner = DOM_OWNER(old);
+    hvml_dom_t *prev  = DOM_PREV(old);
+    hvml_dom_t *next  = DOM_NEXT(old);
+    A(DOM_IS_ORPHAN(v), "internal logic error");
+
+    DOM_PREV(v)  = prev;
+    DOM_NEXT(v)  = next;
+    DOM_OWNER(v) = owner;
+    if (prev) DOM_NEXT(prev)  = v;
+    else      DOM_HEAD(owner) = v;
+    if (next) DOM_PREV(next)  = v;
+    else      DOM_TAIL(owner) = v;
+
+    DOM_PREV(old)  = NULL;
+    DOM_NEXT(old)  = NULL;
+    DOM_OWNER(old) = NULL;
+}
+
+hvml_dom_t* hvml_dom_reparse(hvml_dom_t *dom, const char *text, size_t len,
+                             size_t offset, size_t deleted, size_t inserted)
+{
+    A(DOM_OWNER(dom)==NULL, "internal logic error");
+    const size_t edit_end = offset + deleted;
+
+    // the deepest element holding the edit strictly within its span,
+    // so that both of its ends stay untouched
+    hvml_dom_t *elem = NULL;
+    if (dom->dt == MKDOT(D_TAG) && dom->tag.start < offset && edit_end < dom->tag.end) {
+        elem = dom;
+    }
+    hvml_dom_t *child = elem ? DOM_HEAD(elem) : NULL;
+    while (child) {
+        if (child->dt == MKDOT(D_TAG) &&
+            child->tag.start < offset && edit_end < child->tag.end)
+        {
+            elem  = child;
+            child = DOM_HEAD(elem);
+            continue;
+        }
+        child = DOM_NEXT(child);
+    }
+
+    // re-parse the element in its edited extent on its own, an element
+    // parsing the same wherever it is; go up a level if it fails
+    for (; elem; elem = DOM_OWNER(elem)) {
+        const size_t start = elem->tag.start;
+        const size_t end   = elem->tag.end - deleted + inserted;
+        if (end > len || end <= start) continue;
+
+        hvml_dom_t *v = load_from_buffer(text + start, end - start);
+        if (!v) continue;
+        if (v->dt != MKDOT(D_TAG) || v->tag.start != 0 || v->tag.end != end - start) {
+            hvml_dom_destroy(v);
+            continue;
+        }
 
+        if (elem != dom) {
+            // the spans out of the element first, the new one not in yet
+            shift_spans(dom, elem->tag.end, inserted - deleted);
+            dom_replace(elem, v);
+            hvml_dom_destroy(elem);
+        } else {
+            hvml_dom_destroy(dom);
+            dom = v;
+        }
+        shift_spans(v, 0, start);
+        return dom;
+    }
 
+    // the edit touches the root element's ends or what's around it
+    hvml_dom_t *v = load_from_buffer(text, len);
+    if (!v) return NULL;
+    hvml_dom_destroy(dom);
+    return v;
+}
 
 static int on_open_tag(void *arg, const char *tag) {
     hvml_dom_gen_t *gen = (hvml_dom_gen_t*)arg;
     hvml_dom_t *v       = hvml_dom_create();
     if (!v) return -1;
-    v->dt      = MKDOT(D_TAG);
-    if (hvml_string_set(&v->tag.name, tag, strlen(tag))) {
+    v->dt        = MKDOT(D_TAG);
+    v->tag.start = hvml_parser_markup_offset(gen->parser);
+    if (hvml_string_set(&v->tag.name, tag, strlen(tag)) ||
+        (gen->pos && hvml_dom_pos_append(gen->pos, v->tag.start)))
+    {
         hvml_dom_destroy(v);
         return -1;
     }
@@ -634,7 +1176,9 @@ static int on_attr_key(void *arg, const char *key) {
     hvml_dom_t *v       = hvml_dom_create();
     if (!v) return -1;
     v->dt      = MKDOT(D_ATTR);
-    if (hvml_string_set(&v->attr.key, key, strlen(key))) {
+    if (hvml_string_set(&v->attr.key, key, strlen(key)) ||
+        (gen->pos && hvml_dom_pos_append(gen->pos, hvml_parser_token_offset(gen->parser))))
+    {
         hvml_dom_destroy(v);
         return -1;
     }
@@ -671,6 +1215,7 @@ static int on_close_tag(void *arg) {
         A(gen->dom->dt == MKDOT(D_TAG), "internal logic error");
     }
     A(gen->dom->dt == MKDOT(D_TAG), "internal logic error");
+    gen->dom->tag.end = hvml_parser_offset(gen->parser) + 1;
     if (DOM_OWNER(gen->dom)) {
         gen->dom = DOM_OWNER(gen->dom);
         A(gen->dom->dt == MKDOT(D_TAG), "internal logic error");
@@ -686,7 +1231,9 @@ static int on_text(void *arg, const char *txt) {
     hvml_dom_t *v       = hvml_dom_create();
     if (!v) return -1;
     v->dt      = MKDOT(D_TEXT);
-    if (hvml_string_set(&v->txt.txt, txt, strlen(txt))) {
+    if (hvml_string_set(&v->txt.txt, txt, strlen(txt)) ||
+        (gen->pos && hvml_dom_pos_append(gen->pos, hvml_parser_token_offset(gen->parser))))
+    {
         hvml_dom_destroy(v);
         return -1;
     }
@@ -702,6 +1249,7 @@ static int on_text(void *arg, const char *txt) {
 
 static int on_begin(void *arg) {
     hvml_dom_gen_t *gen = (hvml_dom_gen_t*)arg;
+    gen->jo_start = hvml_parser_offset(gen->parser);
     return 0;
 }
 
@@ -753,6 +1301,8 @@ static int on_open_obj(void *arg) {
 static int on_close_obj(void *arg) {
     hvml_dom_gen_t *gen = (hvml_dom_gen_t*)arg;
 
+    if (hvml_jo_object_reshape(gen->jo)) return -1;
+
     hvml_jo_value_t *parent = hvml_jo_value_parent(gen->jo);
     if (!parent) return 0;
 
@@ -765,7 +1315,7 @@ static int on_key(void *arg, const char *key, size_t len) {
     hvml_dom_gen_t *gen = (hvml_dom_gen_t*)arg;
     A(hvml_jo_value_type(gen->jo) == MKJOT(J_OBJECT), "internal logic error");
 
-    hvml_jo_value_t *jo = hvml_jo_object_kv(key, len);
+    hvml_jo_value_t *jo = hvml_jo_object_kv_interned(gen->symtab, key, len);
     if (!jo) return -1;
 
     if (hvml_jo_value_push(gen->jo, jo)) {
@@ -911,6 +1461,10 @@ static int on_end(void *arg) {
     // hvml_jo_value_printf(val, stdout);
     // fprintf(stdout, "\n");
     // hvml_jo_value_free(val);
+    if (gen->pos && hvml_dom_pos_append(gen->pos, gen->jo_start)) {
+        hvml_jo_value_free(val);
+        return -1;
+    }
     hvml_dom_append_json(gen->dom, val);
     return 0;
 }
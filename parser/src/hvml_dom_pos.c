@@ -0,0 +1,196 @@
+// This file is a part of Purring Cat, a reference implementation of HVML.
+//
+// Copyright (C) 2020, <freemine@yeah.net>.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+
+#include "hvml/hvml_dom_pos.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+// an absolute offset every that many nodes, so that a lookup decodes no
+// more than that many deltas
+#define POS_STRIDE          64
+
+typedef struct pos_mark_s           pos_mark_t;
+
+struct pos_mark_s {
+    size_t              offset;     // of the node starting the stride
+    size_t              at;         // where its delta is in `deltas`
+};
+
+struct hvml_dom_pos_s {
+    // deltas to the previous node's offset, zigzag LEB128
+    unsigned char      *deltas;
+    size_t              len;
+    size_t              cap;
+
+    pos_mark_t         *marks;
+    size_t              nmarks;
+    size_t              cap_marks;
+
+    size_t              count;
+    size_t              last;
+
+    // start of each line, built on first line/col query
+    size_t             *lines;
+    size_t              nlines;
+};
+
+hvml_dom_pos_t* hvml_dom_pos_create(void) {
+    return (hvml_dom_pos_t*)calloc(1, sizeof(hvml_dom_pos_t));
+}
+
+void hvml_dom_pos_destroy(hvml_dom_pos_t *pos) {
+    if (!pos) return;
+    free(pos->deltas);
+    free(pos->marks);
+    free(pos->lines);
+    free(pos);
+}
+
+void hvml_dom_pos_reset(hvml_dom_pos_t *pos) {
+    pos->len    = 0;
+    pos->nmarks = 0;
+    pos->count  = 0;
+    pos->last   = 0;
+    free(pos->lines);
+    pos->lines  = NULL;
+    pos->nlines = 0;
+}
+
+int hvml_dom_pos_append(hvml_dom_pos_t *pos, size_t offset) {
+    if (pos->count % POS_STRIDE == 0) {
+        if (pos->nmarks == pos->cap_marks) {
+            size_t      cap   = pos->cap_marks ? pos->cap_marks * 2 : 16;
+            pos_mark_t *marks = (pos_mark_t*)realloc(pos->marks, cap * sizeof(*marks));
+            if (!marks) return -1;
+            pos->marks     = marks;
+            pos->cap_marks = cap;
+        }
+        pos->marks[pos->nmarks].offset = offset;
+        pos->marks[pos->nmarks].at     = pos->len;
+        ++pos->nmarks;
+    }
+
+    // a node may start before the previous one, e.g. text found to be
+    // one once the next markup is met
+    int64_t  d = (int64_t)offset - (int64_t)pos->last;
+    uint64_t z = ((uint64_t)d << 1) ^ (uint64_t)(d >> 63);
+
+    if (pos->cap - pos->len < 10) {
+        size_t         cap    = pos->cap ? pos->cap * 2 : 256;
+        unsigned char *deltas = (unsigned char*)realloc(pos->deltas, cap);
+        if (!deltas) return -1;
+        pos->deltas = deltas;
+        pos->cap    = cap;
+    }
+    while (z >= 0x80) {
+        pos->deltas[pos->len++] = (unsigned char)(z | 0x80);
+        z >>= 7;
+    }
+    pos->deltas[pos->len++] = (unsigned char)z;
+
+    pos->last = offset;
+    ++pos->count;
+    return 0;
+}
+
+size_t hvml_dom_pos_count(hvml_dom_pos_t *pos) {
+    return pos->count;
+}
+
+int hvml_dom_pos_offset(hvml_dom_pos_t *pos, size_t ordinal, size_t *offset) {
+    if (ordinal >= pos->count) return -1;
+
+    const pos_mark_t    *mark = pos->marks + ordinal / POS_STRIDE;
+    const unsigned char *p    = pos->deltas + mark->at;
+    size_t               v    = mark->offset;
+
+    // skip the delta of the marked node, its offset being known
+    while (*p++ & 0x80) ;
+    for (size_t n = ordinal % POS_STRIDE; n > 0; --n) {
+        uint64_t z     = 0;
+        int      shift = 0;
+        unsigned char b;
+        do {
+            b = *p++;
+            z |= (uint64_t)(b & 0x7f) << shift;
+            shift += 7;
+        } while (b & 0x80);
+        v += (size_t)(int64_t)((z >> 1) ^ (~(z & 1) + 1));
+    }
+    *offset = v;
+    return 0;
+}
+
+static int build_lines(hvml_dom_pos_t *pos, const char *text, size_t len) {
+    size_t n = 1;
+    for (const char *p = text; (p = (const char*)memchr(p, '\n', text + len - p)); ++p) ++n;
+
+    pos->lines = (size_t*)malloc(n * sizeof(*pos->lines));
+    if (!pos->lines) return -1;
+
+    pos->lines[0] = 0;
+    pos->nlines   = 1;
+    for (const char *p = text; (p = (const char*)memchr(p, '\n', text + len - p)); ++p) {
+        pos->lines[pos->nlines++] = (size_t)(p - text) + 1;
+    }
+    return 0;
+}
+
+int hvml_dom_pos_line_col(hvml_dom_pos_t *pos, const char *text, size_t len,
+                          size_t offset, size_t *line, size_t *col)
+{
+    if (offset > len) return -1;
+    if (!pos->lines && build_lines(pos, text, len)) return -1;
+
+    // the last line starting at or before `offset`
+    size_t lo = 0, hi = pos->nlines;
+    while (hi - lo > 1) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (pos->lines[mid] <= offset) lo = mid;
+        else                           hi = mid;
+    }
+    *line = lo + 1;
+    *col  = offset - pos->lines[lo] + 1;
+    return 0;
+}
+
+static int ordinal_of(hvml_dom_t *dom, hvml_dom_t *node, size_t *n) {
+    if (dom == node) return 1;
+    ++*n;
+    if (hvml_dom_type(dom) != MKDOT(D_TAG)) return 0;
+
+    for (hvml_dom_t *attr = hvml_dom_first_attr(dom); attr; attr = hvml_dom_next_attr(attr)) {
+        if (attr == node) return 1;
+        ++*n;
+    }
+    for (hvml_dom_t *child = hvml_dom_first_child(dom); child; child = hvml_dom_next(child)) {
+        // attributes are counted once, with their tag
+        if (hvml_dom_type(child) == MKDOT(D_ATTR)) continue;
+        // attention: recursive call
+        if (ordinal_of(child, node, n)) return 1;
+    }
+    return 0;
+}
+
+size_t hvml_dom_ordinal(hvml_dom_t *root, hvml_dom_t *node) {
+    size_t n = 0;
+    return ordinal_of(root, node, &n) ? n : (size_t)-1;
+}
+
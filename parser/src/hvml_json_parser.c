@@ -22,6 +22,7 @@
 
 #include <ctype.h>
 #include <string.h>
+#include <time.h>
 
 // unicode support, specifically utf-16be
 // ref: https://en.wikipedia.org/wiki/UTF-16
@@ -57,6 +58,7 @@ typedef enum {
         MKSTATE(DECIMAL),
         MKSTATE(ESYM),
         MKSTATE(EXPONENT),
+        MKSTATE(SKIP),
     MKSTATE(END),
 } HVML_JSON_PARSER_STATE;
 
@@ -64,15 +66,32 @@ struct hvml_json_parser_s {
     hvml_json_parser_conf_t        conf;
     HVML_JSON_PARSER_STATE        *ar_states;
     size_t                         states;
+    size_t                         states_cap;
     hvml_string_t                  cache;
     hvml_string_t                  curr;
 
     size_t                         line;
     size_t                         col;
 
+    // passing over a value, see HVML_JSON_PARSER_SKIP
+    size_t                         skip_depth;
+    uint64_t                      *skip_kinds;  // a bit per level, set for an array
+    size_t                         skip_kinds_cap;
+    unsigned int                   skip_next:1; // the value after the key
+    unsigned int                   skip_str:1;
+    unsigned int                   skip_esc:1;
+    unsigned int                   skip_any:1;  // any of the value seen yet
+
+    // true/false/null being matched in TFN, and how much of it is
+    const char                    *literal;
+    size_t                         matched;
+
     uint16_t                       shi;
     uint16_t                       slo;
     unsigned int                   shi_:1; // indicate if shi_ done
+
+    // null unless enabled; parse_ns holds the wall time until reported
+    hvml_parser_stats_t           *stats;
 };
 
 static int                    hvml_json_parser_push_state(hvml_json_parser_t *parser, HVML_JSON_PARSER_STATE state);
@@ -80,6 +99,8 @@ static HVML_JSON_PARSER_STATE hvml_json_parser_pop_state(hvml_json_parser_t *par
 static HVML_JSON_PARSER_STATE hvml_json_parser_peek_state(hvml_json_parser_t *parser);
 static HVML_JSON_PARSER_STATE hvml_json_parser_chg_state(hvml_json_parser_t *parser, HVML_JSON_PARSER_STATE state);
 static void                   dump_states(hvml_json_parser_t *parser);
+static int                    cache_push(hvml_json_parser_t *parser, hvml_string_t *str, const char c);
+static uint64_t               now_ns(void);
 
 #define get_line(parser) (parser->conf.offset_line + parser->line + 1)
 #define get_col(parser)  (parser->conf.offset_col  + parser->col  + 1)
@@ -90,6 +111,19 @@ static void                   dump_states(hvml_json_parser_t *parser);
       get_line(parser), get_col(parser),                                    \
       str_state)
 
+// invoke a user callback, accounted if stats are enabled
+#define CALLBACK(token, call)                                                                     \
+do {                                                                                              \
+    if (!parser->stats) {                                                                         \
+        ret = call;                                                                               \
+        break;                                                                                    \
+    }                                                                                             \
+    uint64_t t0_ = now_ns();                                                                      \
+    ret = call;                                                                                   \
+    parser->stats->callback_ns += now_ns() - t0_;                                                 \
+    ++parser->stats->tokens[HVML_PARSER_TOKEN_##token];                                           \
+} while (0)
+
 #define number_found()                                                                            \
 do {                                                                                              \
     if ((parser->cache.len==0) ||                                                                 \
@@ -101,7 +135,6 @@ do {
         break;                                                                                    \
     }                                                                                             \
     const char *s = hvml_string_str(&parser->cache);                                              \
-    size_t      l = hvml_string_len(&parser->cache);                                              \
     int64_t     v = 0;                                                                            \
     double      d = 0;                                                                            \
     if (strchr(s, '.') || strchr(s, 'e') || strchr(s, 'E')) {                                     \
@@ -112,7 +145,7 @@ do {
             break;                                                                                \
         }                                                                                         \
         if (parser->conf.on_double) {                                                             \
-            ret = parser->conf.on_double(parser->conf.arg, s, d);                                 \
+            CALLBACK(DOUBLE, parser->conf.on_double(parser->conf.arg, s, d));                     \
         }                                                                                         \
     } else {                                                                                      \
         ret = hvml_string_to_int64(s, &v);                                                        \
@@ -123,7 +156,7 @@ do {
             break;                                                                                \
         }                                                                                         \
         if (parser->conf.on_integer) {                                                            \
-            ret = parser->conf.on_integer(parser->conf.arg, s, v);                                \
+            CALLBACK(INTEGER, parser->conf.on_integer(parser->conf.arg, s, v));                   \
         }                                                                                         \
     }                                                                                             \
     hvml_string_reset(&parser->cache);                                                            \
@@ -145,16 +178,89 @@ void hvml_json_parser_destroy(hvml_json_parser_t *parser) {
     hvml_string_clear(&parser->cache);
     hvml_string_clear(&parser->curr);
     free(parser->ar_states); parser->ar_states = NULL;
+    free(parser->skip_kinds); parser->skip_kinds = NULL;
+    free(parser->stats);     parser->stats     = NULL;
     free(parser);
 }
 
+int hvml_json_parser_set_stats(hvml_json_parser_t *parser, int enable) {
+    if (!enable) {
+        free(parser->stats);
+        parser->stats = NULL;
+        return 0;
+    }
+    if (parser->stats) return 0;
+    parser->stats = (hvml_parser_stats_t*)calloc(1, sizeof(*parser->stats));
+    if (!parser->stats) return -1;
+    parser->stats->states_max = parser->states;
+    return 0;
+}
+
+int hvml_json_parser_get_stats(hvml_json_parser_t *parser, hvml_parser_stats_t *stats) {
+    if (!parser->stats) return -1;
+    *stats = *parser->stats;
+    // wall time so far, callbacks included; an embedded parser is
+    // timed by its host instead
+    stats->parse_ns = stats->parse_ns > stats->callback_ns ? stats->parse_ns - stats->callback_ns : 0;
+    return 0;
+}
+
 void hvml_json_parser_reset(hvml_json_parser_t *parser) {
-    hvml_string_clear(&parser->cache);
-    hvml_string_clear(&parser->curr);
+    // buffers are kept for the next document
+    hvml_string_reset(&parser->cache);
+    hvml_string_reset(&parser->curr);
     parser->states = 0;
     hvml_json_parser_push_state(parser, MKSTATE(BEGIN));
     parser->line   = 0;
     parser->col    = 0;
+    parser->shi    = 0;
+    parser->slo    = 0;
+    parser->shi_   = 0;
+    parser->skip_depth = 0;
+    parser->skip_next  = 0;
+    parser->skip_str   = 0;
+    parser->skip_esc   = 0;
+    parser->skip_any   = 0;
+    parser->literal    = NULL;
+    parser->matched    = 0;
+}
+
+// one level deeper into what is passed over, remembering its kind
+static int skip_push(hvml_json_parser_t *parser, int array) {
+    size_t word = parser->skip_depth / 64;
+    if (word >= parser->skip_kinds_cap) {
+        size_t    cap   = parser->skip_kinds_cap ? parser->skip_kinds_cap * 2 : 1;
+        uint64_t *kinds = (uint64_t*)realloc(parser->skip_kinds, cap * sizeof(*kinds));
+        if (!kinds) return -1;
+        parser->skip_kinds     = kinds;
+        parser->skip_kinds_cap = cap;
+    }
+    uint64_t bit = 1ULL << (parser->skip_depth % 64);
+    if (array) parser->skip_kinds[word] |= bit;
+    else       parser->skip_kinds[word] &= ~bit;
+    ++parser->skip_depth;
+    return 0;
+}
+
+// one level up, -1 if closed by the other kind of bracket
+static int skip_pop(hvml_json_parser_t *parser, int array) {
+    size_t depth = parser->skip_depth - 1;
+    int    kind  = (parser->skip_kinds[depth / 64] >> (depth % 64)) & 1;
+    if (kind != array) return -1;
+    parser->skip_depth = depth;
+    return 0;
+}
+
+// a container just opened is passed over if its callback asked to
+static int skip_or_fail(hvml_json_parser_t *parser, int ret) {
+    if (ret != HVML_JSON_PARSER_SKIP) return ret;
+    int array = hvml_json_parser_peek_state(parser) == MKSTATE(OPEN_ARRAY);
+    hvml_json_parser_chg_state(parser, MKSTATE(SKIP));
+    parser->skip_depth = 0;
+    parser->skip_str   = 0;
+    parser->skip_esc   = 0;
+    parser->skip_any   = 1;
+    return skip_push(parser, array);
 }
 
 static int hvml_json_parser_at_begin(hvml_json_parser_t *parser, const char c, const char *str_state) {
@@ -166,12 +272,12 @@ static int hvml_json_parser_at_begin(hvml_json_parser_t *parser, const char c, c
             hvml_json_parser_push_state(parser, MKSTATE(OPEN_OBJ));
             int ret = 0;
             if (parser->conf.on_begin) {
-                ret = parser->conf.on_begin(parser->conf.arg);
+                CALLBACK(BEGIN, parser->conf.on_begin(parser->conf.arg));
             }
             if (ret==0 && parser->conf.on_open_obj) {
-                ret = parser->conf.on_open_obj(parser->conf.arg);
+                CALLBACK(OPEN_OBJ, parser->conf.on_open_obj(parser->conf.arg));
             }
-            if (ret) return ret;
+            if (ret) return skip_or_fail(parser, ret);
         } break;
         case '[': // ']'
         {
@@ -179,12 +285,12 @@ static int hvml_json_parser_at_begin(hvml_json_parser_t *parser, const char c, c
             hvml_json_parser_push_state(parser, MKSTATE(OPEN_ARRAY));
             int ret = 0;
             if (parser->conf.on_begin) {
-                ret = parser->conf.on_begin(parser->conf.arg);
+                CALLBACK(BEGIN, parser->conf.on_begin(parser->conf.arg));
             }
             if (ret==0 && parser->conf.on_open_array) {
-                ret = parser->conf.on_open_array(parser->conf.arg);
+                CALLBACK(OPEN_ARRAY, parser->conf.on_open_array(parser->conf.arg));
             }
-            if (ret) return ret;
+            if (ret) return skip_or_fail(parser, ret);
         } break;
         case '"': // '"'
         {
@@ -192,7 +298,7 @@ static int hvml_json_parser_at_begin(hvml_json_parser_t *parser, const char c, c
             hvml_json_parser_push_state(parser, MKSTATE(STR));
             int ret = 0;
             if (parser->conf.on_begin) {
-                ret = parser->conf.on_begin(parser->conf.arg);
+                CALLBACK(BEGIN, parser->conf.on_begin(parser->conf.arg));
             }
             if (ret) return ret;
         } break;
@@ -204,7 +310,7 @@ static int hvml_json_parser_at_begin(hvml_json_parser_t *parser, const char c, c
             hvml_json_parser_push_state(parser, MKSTATE(TFN));
             int ret = 0;
             if (parser->conf.on_begin) {
-                ret = parser->conf.on_begin(parser->conf.arg);
+                CALLBACK(BEGIN, parser->conf.on_begin(parser->conf.arg));
             }
             if (ret) return ret;
             return 1; // retry
@@ -226,7 +332,7 @@ static int hvml_json_parser_at_begin(hvml_json_parser_t *parser, const char c, c
             hvml_json_parser_push_state(parser, MKSTATE(NUMBER));
             int ret = 0;
             if (parser->conf.on_begin) {
-                ret = parser->conf.on_begin(parser->conf.arg);
+                CALLBACK(BEGIN, parser->conf.on_begin(parser->conf.arg));
             }
             if (ret) return ret;
             return 1; // retry
@@ -255,7 +361,7 @@ static int hvml_json_parser_at_open_obj(hvml_json_parser_t *parser, const char c
             hvml_json_parser_pop_state(parser);
             int ret = 0;
             if (parser->conf.on_close_obj) {
-                ret = parser->conf.on_close_obj(parser->conf.arg);
+                CALLBACK(CLOSE_OBJ, parser->conf.on_close_obj(parser->conf.arg));
             }
             if (ret) return ret;
         } break;
@@ -287,7 +393,7 @@ static int hvml_json_parser_at_key_done(hvml_json_parser_t *parser, const char c
 static int hvml_json_parser_at_str(hvml_json_parser_t *parser, const char c, const char *str_state) {
     if (parser->shi_) {
         if (c=='\\') {
-            hvml_string_push(&parser->cache, c);
+            cache_push(parser, &parser->cache, c);
             hvml_json_parser_chg_state(parser, MKSTATE(ESCAPE));
             return 0;
         }
@@ -305,16 +411,20 @@ static int hvml_json_parser_at_str(hvml_json_parser_t *parser, const char c, con
                 {
                     int ret = 0;
                     if (parser->conf.on_key) {
-                        ret = parser->conf.on_key(parser->conf.arg, hvml_string_str(&parser->cache), hvml_string_len(&parser->cache));
+                        CALLBACK(KEY, parser->conf.on_key(parser->conf.arg, hvml_string_str(&parser->cache), hvml_string_len(&parser->cache)));
                     }
                     hvml_string_reset(&parser->cache);
+                    if (ret == HVML_JSON_PARSER_SKIP) {
+                        parser->skip_next = 1;
+                        ret = 0;
+                    }
                     if (ret) return ret;
                 } break;
                 case MKSTATE(VAL_DONE):
                 {
                     int ret = 0;
                     if (parser->conf.on_string) {
-                        ret = parser->conf.on_string(parser->conf.arg, hvml_string_str(&parser->cache), hvml_string_len(&parser->cache));
+                        CALLBACK(STRING, parser->conf.on_string(parser->conf.arg, hvml_string_str(&parser->cache), hvml_string_len(&parser->cache)));
                     }
                     hvml_string_reset(&parser->cache);
                     if (ret) return ret;
@@ -323,7 +433,7 @@ static int hvml_json_parser_at_str(hvml_json_parser_t *parser, const char c, con
                 {
                     int ret = 0;
                     if (parser->conf.on_string) {
-                        ret = parser->conf.on_string(parser->conf.arg, hvml_string_str(&parser->cache), hvml_string_len(&parser->cache));
+                        CALLBACK(STRING, parser->conf.on_string(parser->conf.arg, hvml_string_str(&parser->cache), hvml_string_len(&parser->cache)));
                     }
                     hvml_string_reset(&parser->cache);
                     if (ret) return ret;
@@ -332,7 +442,7 @@ static int hvml_json_parser_at_str(hvml_json_parser_t *parser, const char c, con
                 {
                     int ret = 0;
                     if (parser->conf.on_string) {
-                        ret = parser->conf.on_string(parser->conf.arg, hvml_string_str(&parser->cache), hvml_string_len(&parser->cache));
+                        CALLBACK(STRING, parser->conf.on_string(parser->conf.arg, hvml_string_str(&parser->cache), hvml_string_len(&parser->cache)));
                     }
                     hvml_string_reset(&parser->cache);
                     if (ret) return ret;
@@ -347,11 +457,11 @@ static int hvml_json_parser_at_str(hvml_json_parser_t *parser, const char c, con
         case '\\':
         {
             hvml_json_parser_push_state(parser, MKSTATE(ESCAPE));
-            hvml_string_push(&parser->cache, c);
+            cache_push(parser, &parser->cache, c);
         } break;
         default:
         {
-            hvml_string_push(&parser->cache, c);
+            cache_push(parser, &parser->cache, c);
         } break;
     }
     return 0;
@@ -360,7 +470,7 @@ static int hvml_json_parser_at_str(hvml_json_parser_t *parser, const char c, con
 static int hvml_json_parser_at_escape(hvml_json_parser_t *parser, const char c, const char *str_state) {
     if (parser->shi_) {
         if (c=='u') {
-            hvml_string_push(&parser->cache, c);
+            cache_push(parser, &parser->cache, c);
             hvml_json_parser_chg_state(parser, MKSTATE(ESCAPE_U));
             return 0;
         }
@@ -411,7 +521,7 @@ static int hvml_json_parser_at_escape(hvml_json_parser_t *parser, const char c,
         } break;
         case 'u':
         {
-            hvml_string_push(&parser->cache, c);
+            cache_push(parser, &parser->cache, c);
             A(parser->shi  == 0, "internal logic error");
             A(parser->slo  == 0, "internal logic error");
             A(parser->shi_ == 0, "internal logic error");
@@ -431,7 +541,7 @@ static int hvml_json_parser_at_escape_u(hvml_json_parser_t *parser, const char c
         EPARSE();
         return -1;
     }
-    hvml_string_push(&parser->cache, c);
+    cache_push(parser, &parser->cache, c);
     if (!parser->shi_) {
         parser->shi |= (HEX_TO_BIN(c))<<12;
     } else {
@@ -446,7 +556,7 @@ static int hvml_json_parser_at_escape_u1(hvml_json_parser_t *parser, const char
         EPARSE();
         return -1;
     }
-    hvml_string_push(&parser->cache, c);
+    cache_push(parser, &parser->cache, c);
     if (!parser->shi_) {
         parser->shi |= (HEX_TO_BIN(c))<<8;
     } else {
@@ -461,7 +571,7 @@ static int hvml_json_parser_at_escape_u2(hvml_json_parser_t *parser, const char
         EPARSE();
         return -1;
     }
-    hvml_string_push(&parser->cache, c);
+    cache_push(parser, &parser->cache, c);
     if (!parser->shi_) {
         parser->shi |= (HEX_TO_BIN(c))<<4;
     } else {
@@ -476,7 +586,7 @@ static int hvml_json_parser_at_escape_u3(hvml_json_parser_t *parser, const char
         EPARSE();
         return -1;
     }
-    hvml_string_push(&parser->cache, c);
+    cache_push(parser, &parser->cache, c);
     if (!parser->shi_) {
         parser->shi |= (HEX_TO_BIN(c));
     } else {
@@ -502,14 +612,14 @@ static int hvml_json_parser_at_escape_u3(hvml_json_parser_t *parser, const char
             case '\0': {
                 parser->cache.len -= 6;
                 parser->cache.str[parser->cache.len] = '\0';
-                hvml_string_push(&parser->cache, ucs);
+                cache_push(parser, &parser->cache, ucs);
             } break;
             default: {
                 parser->cache.len -= 6;
                 parser->cache.str[parser->cache.len] = '\0';
-                hvml_string_push(&parser->cache, 0xe0 | (ucs >> 12));
-                hvml_string_push(&parser->cache, 0x80 | ((ucs >> 6) & 0x3f));
-                hvml_string_push(&parser->cache, 0x80 | (ucs & 0x3f));
+                cache_push(parser, &parser->cache, 0xe0 | (ucs >> 12));
+                cache_push(parser, &parser->cache, 0x80 | ((ucs >> 6) & 0x3f));
+                cache_push(parser, &parser->cache, 0x80 | (ucs & 0x3f));
             } break;
         }
         parser->shi = 0;
@@ -530,10 +640,10 @@ static int hvml_json_parser_at_escape_u3(hvml_json_parser_t *parser, const char
     }
     parser->cache.len -= 12;
     parser->cache.str[parser->cache.len] = '\0';
-    hvml_string_push(&parser->cache, 0xf0 | ((ucs >> 18) & 0x07));
-    hvml_string_push(&parser->cache, 0x80 | ((ucs >> 12) & 0x3f));
-    hvml_string_push(&parser->cache, 0x80 | ((ucs >> 6) & 0x3f));
-    hvml_string_push(&parser->cache, 0x80 | (ucs & 0x3f));
+    cache_push(parser, &parser->cache, 0xf0 | ((ucs >> 18) & 0x07));
+    cache_push(parser, &parser->cache, 0x80 | ((ucs >> 12) & 0x3f));
+    cache_push(parser, &parser->cache, 0x80 | ((ucs >> 6) & 0x3f));
+    cache_push(parser, &parser->cache, 0x80 | (ucs & 0x3f));
     parser->shi  = 0;
     parser->slo  = 0;
     parser->shi_ = 0;
@@ -543,6 +653,16 @@ static int hvml_json_parser_at_escape_u3(hvml_json_parser_t *parser, const char
 
 static int hvml_json_parser_at_colon(hvml_json_parser_t *parser, const char c, const char *str_state) {
     if (isspace(c)) return 0;
+    if (parser->skip_next) {
+        parser->skip_next = 0;
+        hvml_json_parser_chg_state(parser, MKSTATE(VAL_DONE));
+        hvml_json_parser_push_state(parser, MKSTATE(SKIP));
+        parser->skip_depth = 0;
+        parser->skip_str   = 0;
+        parser->skip_esc   = 0;
+        parser->skip_any   = 0;
+        return 1; // retry
+    }
     switch (c) {
         case '{': // '}'
         {
@@ -550,9 +670,9 @@ static int hvml_json_parser_at_colon(hvml_json_parser_t *parser, const char c, c
             hvml_json_parser_push_state(parser, MKSTATE(OPEN_OBJ));
             int ret = 0;
             if (ret==0 && parser->conf.on_open_obj) {
-                ret = parser->conf.on_open_obj(parser->conf.arg);
+                CALLBACK(OPEN_OBJ, parser->conf.on_open_obj(parser->conf.arg));
             }
-            if (ret) return ret;
+            if (ret) return skip_or_fail(parser, ret);
         } break;
         case '[': // ']'
         {
@@ -560,9 +680,9 @@ static int hvml_json_parser_at_colon(hvml_json_parser_t *parser, const char c, c
             hvml_json_parser_push_state(parser, MKSTATE(OPEN_ARRAY));
             int ret = 0;
             if (ret==0 && parser->conf.on_open_array) {
-                ret = parser->conf.on_open_array(parser->conf.arg);
+                CALLBACK(OPEN_ARRAY, parser->conf.on_open_array(parser->conf.arg));
             }
-            if (ret) return ret;
+            if (ret) return skip_or_fail(parser, ret);
         } break;
         case '"':
         {
@@ -612,7 +732,7 @@ static int hvml_json_parser_at_val_done(hvml_json_parser_t *parser, const char c
             hvml_json_parser_pop_state(parser);
             int ret = 0;
             if (parser->conf.on_close_obj) {
-                ret = parser->conf.on_close_obj(parser->conf.arg);
+                CALLBACK(CLOSE_OBJ, parser->conf.on_close_obj(parser->conf.arg));
             }
             if (ret) return ret;
         } break;
@@ -667,7 +787,7 @@ static int hvml_json_parser_at_open_array(hvml_json_parser_t *parser, const char
             hvml_json_parser_pop_state(parser);
             int ret = 0;
             if (parser->conf.on_close_array) {
-                ret = parser->conf.on_close_array(parser->conf.arg);
+                CALLBACK(CLOSE_ARRAY, parser->conf.on_close_array(parser->conf.arg));
             }
             if (ret) return ret;
         } break;
@@ -677,9 +797,9 @@ static int hvml_json_parser_at_open_array(hvml_json_parser_t *parser, const char
             hvml_json_parser_push_state(parser, MKSTATE(OPEN_OBJ));
             int ret = 0;
             if (parser->conf.on_open_obj) {
-                ret = parser->conf.on_open_obj(parser->conf.arg);
+                CALLBACK(OPEN_OBJ, parser->conf.on_open_obj(parser->conf.arg));
             }
-            if (ret) return ret;
+            if (ret) return skip_or_fail(parser, ret);
         } break;
         case '[': // ']'
         {
@@ -687,9 +807,9 @@ static int hvml_json_parser_at_open_array(hvml_json_parser_t *parser, const char
             hvml_json_parser_push_state(parser, MKSTATE(OPEN_ARRAY));
             int ret = 0;
             if (ret==0 && parser->conf.on_open_array) {
-                ret = parser->conf.on_open_array(parser->conf.arg);
+                CALLBACK(OPEN_ARRAY, parser->conf.on_open_array(parser->conf.arg));
             }
-            if (ret) return ret;
+            if (ret) return skip_or_fail(parser, ret);
         } break;
         case '"': // '"'
         {
@@ -721,7 +841,7 @@ static int hvml_json_parser_at_open_array(hvml_json_parser_t *parser, const char
             hvml_json_parser_push_state(parser, MKSTATE(NUMBER));
             int ret = 0;
             if (parser->conf.on_begin) {
-                ret = parser->conf.on_begin(parser->conf.arg);
+                CALLBACK(BEGIN, parser->conf.on_begin(parser->conf.arg));
             }
             if (ret) return ret;
             return 1; // retry
@@ -748,7 +868,7 @@ static int hvml_json_parser_at_item_done(hvml_json_parser_t *parser, const char
             hvml_json_parser_pop_state(parser);
             int ret = 0;
             if (parser->conf.on_close_array) {
-                ret = parser->conf.on_close_array(parser->conf.arg);
+                CALLBACK(CLOSE_ARRAY, parser->conf.on_close_array(parser->conf.arg));
             }
             if (ret) return ret;
         } break;
@@ -770,9 +890,9 @@ static int hvml_json_parser_at_array_comma(hvml_json_parser_t *parser, const cha
             hvml_json_parser_push_state(parser, MKSTATE(OPEN_OBJ));
             int ret = 0;
             if (ret==0 && parser->conf.on_open_obj) {
-                ret = parser->conf.on_open_obj(parser->conf.arg);
+                CALLBACK(OPEN_OBJ, parser->conf.on_open_obj(parser->conf.arg));
             }
-            if (ret) return ret;
+            if (ret) return skip_or_fail(parser, ret);
         } break;
         case '[': // ']'
         {
@@ -780,9 +900,9 @@ static int hvml_json_parser_at_array_comma(hvml_json_parser_t *parser, const cha
             hvml_json_parser_push_state(parser, MKSTATE(OPEN_ARRAY));
             int ret = 0;
             if (ret==0 && parser->conf.on_open_array) {
-                ret = parser->conf.on_open_array(parser->conf.arg);
+                CALLBACK(OPEN_ARRAY, parser->conf.on_open_array(parser->conf.arg));
             }
-            if (ret) return ret;
+            if (ret) return skip_or_fail(parser, ret);
         } break;
         case '"': // '"'
         {
@@ -836,67 +956,53 @@ static int hvml_json_parser_at_array_comma(hvml_json_parser_t *parser, const cha
 }
 
 static int hvml_json_parser_at_tfn(hvml_json_parser_t *parser, const char c, const char *str_state) {
-    const char tfn_true[]  = "true";
-    const char tfn_false[] = "false";
-    const char tfn_null[]  = "null";
-    if (parser->cache.len==0) {
+    if (!parser->literal) {
+        // the first char picks the literal, the rest is compared in place
         switch (c) {
-            case 't':
-            case 'f':
-            case 'n':
-            {
-                hvml_string_push(&parser->cache, c);
-            } break;
+            case 't': parser->literal = "true";  break;
+            case 'f': parser->literal = "false"; break;
+            case 'n': parser->literal = "null";  break;
             default:
             {
                 EPARSE();
                 return -1;
             } break;
         }
+        parser->matched = 1;
         return 0;
     }
-    if (parser->cache.str[0] == 't') {
-        if (tfn_true[parser->cache.len] == c) {
-            hvml_string_push(&parser->cache, c);
-            if (parser->cache.len < sizeof(tfn_true) - 1) return 0;
-            int ret = 0;
+    if (parser->literal[parser->matched] != c) {
+        EPARSE();
+        return -1;
+    }
+    if (parser->literal[++parser->matched]) return 0;
+
+    int ret = 0;
+    switch (parser->literal[0]) {
+        case 't':
+        {
             if (parser->conf.on_true) {
-                ret = parser->conf.on_true(parser->conf.arg);
+                CALLBACK(TRUE, parser->conf.on_true(parser->conf.arg));
             }
-            hvml_string_reset(&parser->cache);
-            hvml_json_parser_pop_state(parser);
-            if (ret) return ret;
-            return 0;
-        }
-    } else if (parser->cache.str[0] == 'f') {
-        if (tfn_false[parser->cache.len] == c) {
-            hvml_string_push(&parser->cache, c);
-            if (parser->cache.len < sizeof(tfn_false) - 1) return 0;
-            int ret = 0;
+        } break;
+        case 'f':
+        {
             if (parser->conf.on_false) {
-                ret = parser->conf.on_false(parser->conf.arg);
+                CALLBACK(FALSE, parser->conf.on_false(parser->conf.arg));
             }
-            hvml_string_reset(&parser->cache);
-            hvml_json_parser_pop_state(parser);
-            if (ret) return ret;
-            return 0;
-        }
-    } else if (parser->cache.str[0] == 'n') {
-        if (tfn_null[parser->cache.len] == c) {
-            hvml_string_push(&parser->cache, c);
-            if (parser->cache.len < sizeof(tfn_null) - 1) return 0;
-            int ret = 0;
+        } break;
+        default:
+        {
             if (parser->conf.on_null) {
-                ret = parser->conf.on_null(parser->conf.arg);
+                CALLBACK(NULL, parser->conf.on_null(parser->conf.arg));
             }
-            hvml_string_reset(&parser->cache);
-            hvml_json_parser_pop_state(parser);
-            if (ret) return ret;
-            return 0;
-        }
+        } break;
     }
-    EPARSE();
-    return -1;
+    parser->literal = NULL;
+    parser->matched = 0;
+    hvml_json_parser_pop_state(parser);
+    if (ret) return ret;
+    return 0;
 }
 
 static int hvml_json_parser_at_number(hvml_json_parser_t *parser, const char c, const char *str_state) {
@@ -904,12 +1010,12 @@ static int hvml_json_parser_at_number(hvml_json_parser_t *parser, const char c,
         case '+': // not in json standard
         case '-':
         {
-            hvml_string_push(&parser->cache, c);
+            cache_push(parser, &parser->cache, c);
             hvml_json_parser_chg_state(parser, MKSTATE(MINUS));
         } break;
         case '0':
         {
-            hvml_string_push(&parser->cache, c);
+            cache_push(parser, &parser->cache, c);
             hvml_json_parser_chg_state(parser, MKSTATE(ZERO));
         } break;
         case '1':
@@ -922,7 +1028,7 @@ static int hvml_json_parser_at_number(hvml_json_parser_t *parser, const char c,
         case '8':
         case '9':
         {
-            hvml_string_push(&parser->cache, c);
+            cache_push(parser, &parser->cache, c);
             hvml_json_parser_chg_state(parser, MKSTATE(INTEGER));
         } break;
         default:
@@ -938,7 +1044,7 @@ static int hvml_json_parser_at_minus(hvml_json_parser_t *parser, const char c, c
     switch (c) {
         case '0':
         {
-            hvml_string_push(&parser->cache, c);
+            cache_push(parser, &parser->cache, c);
             hvml_json_parser_chg_state(parser, MKSTATE(ZERO));
         } break;
         case '1':
@@ -951,7 +1057,7 @@ static int hvml_json_parser_at_minus(hvml_json_parser_t *parser, const char c, c
         case '8':
         case '9':
         {
-            hvml_string_push(&parser->cache, c);
+            cache_push(parser, &parser->cache, c);
             hvml_json_parser_chg_state(parser, MKSTATE(INTEGER));
         } break;
         default:
@@ -967,13 +1073,13 @@ static int hvml_json_parser_at_zero(hvml_json_parser_t *parser, const char c, co
     switch (c) {
         case '.':
         {
-            hvml_string_push(&parser->cache, c);
+            cache_push(parser, &parser->cache, c);
             hvml_json_parser_chg_state(parser, MKSTATE(DECIMAL));
         } break;
         case 'e':
         case 'E':
         {
-            hvml_string_push(&parser->cache, c);
+            cache_push(parser, &parser->cache, c);
             hvml_json_parser_chg_state(parser, MKSTATE(ESYM));
         } break;
         default:
@@ -992,13 +1098,13 @@ static int hvml_json_parser_at_integer(hvml_json_parser_t *parser, const char c,
     switch (c) {
         case '.':
         {
-            hvml_string_push(&parser->cache, c);
+            cache_push(parser, &parser->cache, c);
             hvml_json_parser_chg_state(parser, MKSTATE(DECIMAL));
         } break;
         case 'e':
         case 'E':
         {
-            hvml_string_push(&parser->cache, c);
+            cache_push(parser, &parser->cache, c);
             hvml_json_parser_chg_state(parser, MKSTATE(ESYM));
         } break;
         case '0':
@@ -1012,7 +1118,7 @@ static int hvml_json_parser_at_integer(hvml_json_parser_t *parser, const char c,
         case '8':
         case '9':
         {
-            hvml_string_push(&parser->cache, c);
+            cache_push(parser, &parser->cache, c);
         } break;
         default:
         {
@@ -1031,7 +1137,7 @@ static int hvml_json_parser_at_decimal(hvml_json_parser_t *parser, const char c,
         case 'e':
         case 'E':
         {
-            hvml_string_push(&parser->cache, c);
+            cache_push(parser, &parser->cache, c);
             hvml_json_parser_chg_state(parser, MKSTATE(ESYM));
         } break;
         case '0':
@@ -1045,7 +1151,7 @@ static int hvml_json_parser_at_decimal(hvml_json_parser_t *parser, const char c,
         case '8':
         case '9':
         {
-            hvml_string_push(&parser->cache, c);
+            cache_push(parser, &parser->cache, c);
         } break;
         default:
         {
@@ -1076,7 +1182,7 @@ static int hvml_json_parser_at_esym(hvml_json_parser_t *parser, const char c, co
         case '8':
         case '9':
         {
-            hvml_string_push(&parser->cache, c);
+            cache_push(parser, &parser->cache, c);
             hvml_json_parser_chg_state(parser, MKSTATE(EXPONENT));
         } break;
         default:
@@ -1101,7 +1207,7 @@ static int hvml_json_parser_at_exponent(hvml_json_parser_t *parser, const char c
         case '8':
         case '9':
         {
-            hvml_string_push(&parser->cache, c);
+            cache_push(parser, &parser->cache, c);
         } break;
         default:
         {
@@ -1115,6 +1221,66 @@ static int hvml_json_parser_at_exponent(hvml_json_parser_t *parser, const char c
     return 0;
 }
 
+// a scalar is over at what follows it, a string at its closing quote,
+// a container when its depth is back to 0. brackets are matched by kind
+// and a value must be there, anything else is left unchecked
+static int hvml_json_parser_at_skip(hvml_json_parser_t *parser, const char c, const char *str_state) {
+    if (parser->skip_str) {
+        if (parser->skip_esc) {
+            parser->skip_esc = 0;
+        } else if (c=='\\') {
+            parser->skip_esc = 1;
+        } else if (c=='"') {
+            parser->skip_str = 0;
+            if (parser->skip_depth==0) hvml_json_parser_pop_state(parser);
+        }
+        return 0;
+    }
+    switch (c) {
+        case '"':
+        {
+            parser->skip_str = 1;
+        } break;
+        case '{': // '}'
+        case '[': // ']'
+        {
+            if (skip_push(parser, c=='[')) return -1;
+        } break;
+        // '{'
+        case '}':
+        // '['
+        case ']':
+        {
+            if (parser->skip_depth==0) {
+                if (!parser->skip_any) {
+                    EPARSE();
+                    return -1;
+                }
+                hvml_json_parser_pop_state(parser);
+                return 1; // retry
+            }
+            if (skip_pop(parser, c==']')) {
+                EPARSE();
+                return -1;
+            }
+            if (parser->skip_depth==0) hvml_json_parser_pop_state(parser);
+        } break;
+        default:
+        {
+            if (parser->skip_depth==0 && (c==',' || isspace(c))) {
+                if (!parser->skip_any) {
+                    EPARSE();
+                    return -1;
+                }
+                hvml_json_parser_pop_state(parser);
+                return 1; // retry
+            }
+        } break;
+    }
+    parser->skip_any = 1;
+    return 0;
+}
+
 static int hvml_json_parser_at_end(hvml_json_parser_t *parser, const char c, const char *str_state) {
     if (isspace(c)) return 0;
     switch (c) {
@@ -1126,7 +1292,7 @@ static int hvml_json_parser_at_end(hvml_json_parser_t *parser, const char c, con
         {
             int ret = 0;
             if (parser->conf.on_end) {
-                ret = parser->conf.on_end(parser->conf.arg);
+                CALLBACK(END, parser->conf.on_end(parser->conf.arg));
             }
             if (ret) return ret;
             if (parser->conf.embedded) return -1;
@@ -1232,6 +1398,10 @@ static int do_hvml_json_parser_parse_char(hvml_json_parser_t *parser, const char
         {
             return hvml_json_parser_at_exponent(parser, c, MKSTR(EXPONENT));
         } break;
+        case MKSTATE(SKIP):
+        {
+            return hvml_json_parser_at_skip(parser, c, MKSTR(SKIP));
+        } break;
         case MKSTATE(END):
         {
             return hvml_json_parser_at_end(parser, c, MKSTR(END));
@@ -1245,10 +1415,16 @@ static int do_hvml_json_parser_parse_char(hvml_json_parser_t *parser, const char
     return 0;
 }
 
-int hvml_json_parser_parse_char(hvml_json_parser_t *parser, const char c) {
+static int hvml_json_parser_parse_char_(hvml_json_parser_t *parser, const char c) {
     int ret = 1;
+    if (parser->stats) {
+        ++parser->stats->bytes;
+        // the host of an embedded parser decodes utf-8 by itself
+        if (!parser->conf.embedded && (c & 0xC0)==0xC0) ++parser->stats->utf8_multibyte;
+    }
     do {
         ret = do_hvml_json_parser_parse_char(parser, c);
+        if (ret==1 && parser->stats) ++parser->stats->retries;
     } while (ret==1); // ret==1: to retry
     if (ret==0) {
         if (c=='\n') {
@@ -1257,19 +1433,92 @@ int hvml_json_parser_parse_char(hvml_json_parser_t *parser, const char c) {
             parser->conf.offset_col = 0;
             parser->col = 0;
         } else {
-            hvml_string_push(&parser->curr, c);
+            cache_push(parser, &parser->curr, c);
             ++parser->col;
         }
     }
     return ret;
 }
 
+int hvml_json_parser_parse_char(hvml_json_parser_t *parser, const char c) {
+    if (!parser->stats || parser->conf.embedded) return hvml_json_parser_parse_char_(parser, c);
+
+    uint64_t t0 = now_ns();
+    int ret = hvml_json_parser_parse_char_(parser, c);
+    parser->stats->parse_ns += now_ns() - t0;
+    return ret;
+}
+
+#define SWAR_ONES    0x0101010101010101ULL
+#define SWAR_HIGHS   0x8080808080808080ULL
+// non-zero if any of the 8 bytes of `v` equals `c`
+#define SWAR_HAS(v, c)                                               \
+    ((((v) ^ (SWAR_ONES * (c))) - SWAR_ONES) &                       \
+     ~((v) ^ (SWAR_ONES * (c))) & SWAR_HIGHS)
+
+// pass over 8 bytes at a time while skipping within a container or a
+// string, as long as none of them may end or nest it: within a string
+// only quotes and backslashes do, outside of one quotes and brackets.
+// line and col follow the newlines passed over, the line kept for error
+// messages does not; return # of bytes passed over
+static size_t skip_plain(hvml_json_parser_t *parser, const char *buf, size_t len) {
+    if (!parser->skip_str && parser->skip_depth==0) return 0;
+    if (parser->skip_esc) return 0;
+
+    const char *p   = buf;
+    const char *end = buf + len;
+    while (end - p >= 8) {
+        uint64_t v;
+        memcpy(&v, p, sizeof(v));
+        uint64_t hit = SWAR_HAS(v, '"');
+        if (parser->skip_str) {
+            hit |= SWAR_HAS(v, '\\');
+        } else {
+            // or'ing 0x20 folds '[' into '{' and ']' into '}'
+            uint64_t w = v | (SWAR_ONES * 0x20);
+            hit |= SWAR_HAS(w, '{') | SWAR_HAS(w, '}');
+        }
+        if (hit) break;
+
+        if (SWAR_HAS(v, '\n')) {
+            for (int i=0; i<8; ++i) {
+                if (p[i]=='\n') {
+                    hvml_string_reset(&parser->curr);
+                    ++parser->line;
+                    parser->conf.offset_col = 0;
+                    parser->col = 0;
+                } else {
+                    ++parser->col;
+                }
+            }
+        } else {
+            parser->col += 8;
+        }
+        if (parser->stats && !parser->conf.embedded) {
+            // lead bytes of multi-byte utf-8 sequences, 11xxxxxx
+            parser->stats->utf8_multibyte += __builtin_popcountll(v & (v << 1) & SWAR_HIGHS);
+        }
+        p += 8;
+    }
+
+    if (parser->stats) parser->stats->bytes += (uint64_t)(p - buf);
+    return (size_t)(p - buf);
+}
+
 int hvml_json_parser_parse(hvml_json_parser_t *parser, const char *buf, size_t len) {
+    int      timed = parser->stats && !parser->conf.embedded;
+    uint64_t t0    = timed ? now_ns() : 0;
+    int      ret   = 0;
     for (size_t i=0; i<len; ++i) {
-        int ret = hvml_json_parser_parse_char(parser, buf[i]);
-        if (ret) return ret;
+        if (parser->ar_states[parser->states - 1] == MKSTATE(SKIP)) {
+            i += skip_plain(parser, buf + i, len - i);
+            if (i == len) break;
+        }
+        ret = hvml_json_parser_parse_char_(parser, buf[i]);
+        if (ret) break;
     }
-    return 0;
+    if (timed) parser->stats->parse_ns += now_ns() - t0;
+    return ret;
 }
 
 int hvml_json_parser_parse_string(hvml_json_parser_t *parser, const char *str) {
@@ -1326,12 +1575,20 @@ void hvml_json_str_printf(FILE *out, const char *s, size_t len) {
 
 
 static int hvml_json_parser_push_state(hvml_json_parser_t *parser, HVML_JSON_PARSER_STATE state) {
-    HVML_JSON_PARSER_STATE *st = (HVML_JSON_PARSER_STATE*)realloc(parser->ar_states, (parser->states + 1) * sizeof(*st));
-    if (!st) return -1;
+    if (parser->states == parser->states_cap) {
+        size_t cap = parser->states_cap ? parser->states_cap * 2 : 16;
+        HVML_JSON_PARSER_STATE *st = (HVML_JSON_PARSER_STATE*)realloc(parser->ar_states, cap * sizeof(*st));
+        if (!st) return -1;
+        parser->ar_states  = st;
+        parser->states_cap = cap;
+    }
 
-    st[parser->states] = state;
-    parser->states    += 1;
-    parser->ar_states  = st;
+    parser->ar_states[parser->states] = state;
+    parser->states                   += 1;
+
+    if (parser->stats && parser->states > parser->stats->states_max) {
+        parser->stats->states_max = parser->states;
+    }
 
     return 0;
 }
@@ -1370,3 +1627,15 @@ static void dump_states(hvml_json_parser_t *parser) {
     D("==");
 }
 
+static int cache_push(hvml_json_parser_t *parser, hvml_string_t *str, const char c) {
+    // every push reallocs
+    if (parser->stats) ++parser->stats->cache_reallocs;
+    return hvml_string_push(str, c);
+}
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
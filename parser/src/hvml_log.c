@@ -17,17 +17,71 @@
 
 #include "hvml/hvml_log.h"
 
+#include <errno.h>
 #include <inttypes.h>
 #include <libgen.h>
+#include <limits.h>
 #include <pthread.h>
 #include <stdarg.h>
+#include <string.h>
 #include <sys/syscall.h>
 #include <sys/time.h>
 #include <time.h>
 #include <unistd.h>
 
+// per-thread ring of pending records in async mode, written by its
+// thread only and read by the drain thread only
+#define RING_SIZE      (64 * 1024)
+#define RING_ALIGN(n)  (((n) + 7) & ~(size_t)7)
+
+typedef struct log_rec_s        log_rec_t;
+typedef struct log_ring_s       log_ring_t;
+
+struct log_rec_s {
+    uint32_t            size;     // of the whole record, 0-level records are padding
+    char                level;
+    char                output_only;
+    int                 cline;
+    const char         *cfile;
+    const char         *cfunc;
+    FILE               *out;
+    struct timeval      tv;
+    // followed by the thread name and the message, both nul-terminated
+};
+
+struct log_ring_s {
+    uint64_t            head;     // bytes written, by the owner thread
+    uint64_t            tail;     // bytes drained, by the drain thread
+    uint64_t            dropped;  // records lost to a full ring
+    int                 dead;     // owner thread has exited
+    log_ring_t         *next;
+    char                buf[RING_SIZE];
+};
+
 static __thread char               thread_name[64] = {0};
+static __thread log_ring_t        *thread_ring     = NULL;
+static __thread int                thread_ring_dead = 0;
 static int                         output_only     = 0;
+int                                hvml_log_min_level = HVML_LOG_LEVEL_V;
+
+static int                         async_on        = 0;
+static int                         async_stop      = 0;
+static uint64_t                    drain_passes    = 0;
+static pthread_t                   drain_thread;
+static pthread_mutex_t             rings_lock      = PTHREAD_MUTEX_INITIALIZER;
+static log_ring_t                 *rings           = NULL;
+static pthread_key_t               ring_key;
+static pthread_once_t              ring_key_once   = PTHREAD_ONCE_INIT;
+
+static int  level_rank(const char level);
+static void log_emit(FILE *out, const char level, const struct timeval *tv, const char *name,
+                     const char *cfile, int cline, const char *cfunc, int output_only_set,
+                     const char *msg);
+static int  log_push(const char *cfile, int cline, const char *cfunc, FILE *out, const char level,
+                     int output_only_set, const char *msg, size_t msg_len);
+static int  log_drain(void);
+static void* log_drain_routine(void *arg);
+static void log_async_atexit(void);
 
 void hvml_log_set_thread_type(const char *type) {
     uint64_t tid = 0;
@@ -42,48 +96,264 @@ void hvml_log_set_thread_type(const char *type) {
 
 // if set, no prefix/postfix info
 void hvml_log_set_output_only(int set) {
-    output_only = set;
+    __atomic_store_n(&output_only, set, __ATOMIC_RELAXED);
+}
+
+void hvml_log_set_level(const char level) {
+    __atomic_store_n(&hvml_log_min_level, level_rank(level), __ATOMIC_RELAXED);
+}
+
+int hvml_log_set_async(int set) {
+    static int atexit_registered = 0;
+
+    if (set) {
+        if (async_on) return 0;
+        async_stop = 0;
+        if (pthread_create(&drain_thread, NULL, log_drain_routine, NULL)) return -1;
+        if (!atexit_registered) {
+            atexit(log_async_atexit);
+            atexit_registered = 1;
+        }
+        __atomic_store_n(&async_on, 1, __ATOMIC_RELEASE);
+    } else {
+        if (!async_on) return 0;
+        __atomic_store_n(&async_on, 0, __ATOMIC_SEQ_CST);
+        __atomic_store_n(&async_stop, 1, __ATOMIC_RELEASE);
+        pthread_join(drain_thread, NULL);
+        // pushed by threads that saw async_on before it was cleared,
+        // see log_push
+        __atomic_thread_fence(__ATOMIC_SEQ_CST);
+        log_drain();
+    }
+    return 0;
+}
+
+void hvml_log_flush(void) {
+    if (!__atomic_load_n(&async_on, __ATOMIC_ACQUIRE)) return;
+
+    // what is pending now has been written out once a whole drain pass
+    // has started after this point
+    uint64_t passes = __atomic_load_n(&drain_passes, __ATOMIC_ACQUIRE);
+    while (__atomic_load_n(&drain_passes, __ATOMIC_ACQUIRE) < passes + 2 &&
+           __atomic_load_n(&async_on, __ATOMIC_ACQUIRE))
+    {
+        usleep(100);
+    }
 }
 
 __attribute__ ((format (printf, 6, 7)))
 void hvml_log_printf(const char *cfile, int cline, const char *cfunc, FILE *out, const char level, const char *fmt, ...) {
+    int rank = level_rank(level);
+    if (rank < __atomic_load_n(&hvml_log_min_level, __ATOMIC_RELAXED) && level != 'A') return;
+
     if (thread_name[0]=='\0') hvml_log_set_thread_type("unknown");
 
     char   buf[4096];
-    int    bytes = sizeof(buf);
-    char  *p     = buf;
-    int    n;
-
-    struct timeval tv      = {0};
-    struct tm      tm      = {0};
-    long           tv_usec = 0;
-
-    int output_only_set    = output_only;
-
-    do {
-        if (!output_only_set) {
-            gettimeofday(&tv, NULL);
-            localtime_r(&tv.tv_sec, &tm);
-            tv_usec = tv.tv_usec;
-            n = snprintf(p, bytes, "%c %02d:%02d:%02d.%06ld@%s: ", level,
-                    tm.tm_hour, tm.tm_min, tm.tm_sec, tv_usec, thread_name);
-
-            bytes -= n;
-            p     += n;
-            if (bytes<=0) break;
-        }
+    int    output_only_set = __atomic_load_n(&output_only, __ATOMIC_RELAXED);
+
+    va_list arg;
+    va_start(arg, fmt);
+    int n = vsnprintf(buf, sizeof(buf), fmt, arg);
+    va_end(arg);
+    if (n < 0) n = 0;
+    if ((size_t)n >= sizeof(buf)) n = sizeof(buf) - 1;
+
+    if (level != 'A' && __atomic_load_n(&async_on, __ATOMIC_ACQUIRE)) {
+        if (log_push(cfile, cline, cfunc, out, level, output_only_set, buf, n)==0) return;
+    }
+
+    // an assertion is about to abort, get the records before it out first
+    if (level == 'A') hvml_log_flush();
+
+    struct timeval tv = {0};
+    if (!output_only_set) gettimeofday(&tv, NULL);
+    log_emit(out, level, &tv, thread_name, cfile, cline, cfunc, output_only_set, buf);
+}
+
+static int level_rank(const char level) {
+    switch (level) {
+        case 'V': return HVML_LOG_LEVEL_V;
+        case 'D': return HVML_LOG_LEVEL_D;
+        case 'I': return HVML_LOG_LEVEL_I;
+        case 'W': return HVML_LOG_LEVEL_W;
+        case 'E': return HVML_LOG_LEVEL_E;
+        default:  return HVML_LOG_LEVEL_E + 1;
+    }
+}
+
+static void log_emit(FILE *out, const char level, const struct timeval *tv, const char *name,
+                     const char *cfile, int cline, const char *cfunc, int output_only_set,
+                     const char *msg)
+{
+    if (output_only_set) {
+        fprintf(out, "%s\n", msg);
+        return;
+    }
+
+    struct tm tm = {0};
+    time_t    sec = tv->tv_sec;
+    localtime_r(&sec, &tm);
+
+    // basename may modify its argument
+    char file[PATH_MAX];
+    snprintf(file, sizeof(file), "%s", cfile);
+
+    fprintf(out, "%c %02d:%02d:%02d.%06ld@%s: %s =%s[%d]%s()=\n", level,
+            tm.tm_hour, tm.tm_min, tm.tm_sec, (long)tv->tv_usec, name, msg,
+            basename(file), cline, cfunc);
+}
+
+static void ring_key_destroy(void *arg) {
+    log_ring_t *ring = (log_ring_t*)arg;
+    // freed by the drain thread once empty, so later destructors of this
+    // thread that still log must not touch it, they write synchronously
+    thread_ring      = NULL;
+    thread_ring_dead = 1;
+    __atomic_store_n(&ring->dead, 1, __ATOMIC_RELEASE);
+}
+
+static void ring_key_create(void) {
+    pthread_key_create(&ring_key, ring_key_destroy);
+}
+
+static log_ring_t* log_ring_get(void) {
+    if (thread_ring) return thread_ring;
+    if (thread_ring_dead) return NULL;
+
+    pthread_once(&ring_key_once, ring_key_create);
+
+    log_ring_t *ring = (log_ring_t*)calloc(1, sizeof(*ring));
+    if (!ring) return NULL;
+    if (pthread_setspecific(ring_key, ring)) {
+        free(ring);
+        return NULL;
+    }
 
-        va_list arg;
-        va_start(arg, fmt);
-        n = vsnprintf(p, bytes, fmt, arg);
-        va_end(arg);
+    pthread_mutex_lock(&rings_lock);
+    ring->next = rings;
+    rings      = ring;
+    pthread_mutex_unlock(&rings_lock);
 
-    } while (0);
+    thread_ring = ring;
+    return ring;
+}
+
+static int log_push(const char *cfile, int cline, const char *cfunc, FILE *out, const char level,
+                    int output_only_set, const char *msg, size_t msg_len)
+{
+    log_ring_t *ring = log_ring_get();
+    if (!ring) return -1;
+
+    size_t name_len = strlen(thread_name);
+    size_t max_msg  = RING_SIZE / 4 - sizeof(log_rec_t) - name_len - 2;
+    if (msg_len > max_msg) msg_len = max_msg;
+    size_t need = RING_ALIGN(sizeof(log_rec_t) + name_len + 1 + msg_len + 1);
+
+    uint64_t head = ring->head;
+    uint64_t tail = __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE);
+    size_t   pos  = head % RING_SIZE;
+    size_t   pad  = (RING_SIZE - pos < need) ? RING_SIZE - pos : 0;
+
+    if (RING_SIZE - (head - tail) < pad + need) {
+        // never block the caller on a slow stderr
+        __atomic_add_fetch(&ring->dropped, 1, __ATOMIC_RELAXED);
+        return 0;
+    }
+
+    if (pad) {
+        log_rec_t *rec = (log_rec_t*)(ring->buf + pos);
+        rec->size  = pad;
+        rec->level = 0;
+        pos = 0;
+    }
 
-    if (!output_only_set) {
-        fprintf(out, "%s =%s[%d]%s()=\n", buf, basename((char*)cfile), cline, cfunc);
+    log_rec_t *rec = (log_rec_t*)(ring->buf + pos);
+    rec->size        = need;
+    rec->level       = level;
+    rec->output_only = output_only_set;
+    rec->cline       = cline;
+    rec->cfile       = cfile;
+    rec->cfunc       = cfunc;
+    rec->out         = out;
+    if (output_only_set) {
+        rec->tv.tv_sec  = 0;
+        rec->tv.tv_usec = 0;
     } else {
-        fprintf(out, "%s\n", buf);
+        gettimeofday(&rec->tv, NULL);
     }
+    char *p = (char*)(rec + 1);
+    memcpy(p, thread_name, name_len + 1);
+    p += name_len + 1;
+    memcpy(p, msg, msg_len);
+    p[msg_len] = '\0';
+
+    __atomic_store_n(&ring->head, head + pad + need, __ATOMIC_RELEASE);
+
+    // async mode turned off meanwhile, its last drain may have missed
+    // this record, so get it out now
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    if (!__atomic_load_n(&async_on, __ATOMIC_RELAXED)) log_drain();
+    return 0;
 }
 
+// write out what is pending in all rings, return the number of records
+static int log_drain(void) {
+    int n = 0;
+    FILE *last_out = NULL;
+
+    pthread_mutex_lock(&rings_lock);
+    log_ring_t **pp = &rings;
+    while (*pp) {
+        log_ring_t *ring = *pp;
+        int dead = __atomic_load_n(&ring->dead, __ATOMIC_ACQUIRE);
+        uint64_t head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+        uint64_t tail = ring->tail;
+
+        uint64_t dropped = __atomic_exchange_n(&ring->dropped, 0, __ATOMIC_RELAXED);
+        if (dropped) {
+            fprintf(stderr, "%"PRIu64" log records dropped\n", dropped);
+        }
+
+        while (tail < head) {
+            log_rec_t *rec = (log_rec_t*)(ring->buf + tail % RING_SIZE);
+            if (rec->level) {
+                const char *name = (const char*)(rec + 1);
+                const char *msg  = name + strlen(name) + 1;
+                log_emit(rec->out, rec->level, &rec->tv, name,
+                         rec->cfile, rec->cline, rec->cfunc, rec->output_only, msg);
+                if (last_out && last_out != rec->out) fflush(last_out);
+                last_out = rec->out;
+                ++n;
+            }
+            tail += rec->size;
+        }
+        __atomic_store_n(&ring->tail, tail, __ATOMIC_RELEASE);
+
+        // no more records once dead is seen, but only free it when the
+        // records pushed before that have all been written out
+        if (dead && tail == __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE)) {
+            *pp = ring->next;
+            free(ring);
+        } else {
+            pp = &ring->next;
+        }
+    }
+    pthread_mutex_unlock(&rings_lock);
+
+    if (last_out) fflush(last_out);
+    __atomic_add_fetch(&drain_passes, 1, __ATOMIC_RELEASE);
+    return n;
+}
+
+static void* log_drain_routine(void *arg) {
+    (void)arg;
+    while (!__atomic_load_n(&async_stop, __ATOMIC_ACQUIRE)) {
+        if (log_drain()==0) usleep(1000);
+    }
+    log_drain();
+    return NULL;
+}
+
+static void log_async_atexit(void) {
+    hvml_log_set_async(0);
+}
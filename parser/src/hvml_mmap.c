@@ -0,0 +1,58 @@
+// This file is a part of Purring Cat, a reference implementation of HVML.
+//
+// Copyright (C) 2020, <freemine@yeah.net>.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#include "hvml/hvml_mmap.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+int hvml_mmap_open(hvml_mmap_t *map, const char *file) {
+    map->buf = NULL;
+    map->len = 0;
+
+    int fd = open(file, O_RDONLY | O_CLOEXEC);
+    if (fd == -1) return -1;
+
+    struct stat st;
+    if (fstat(fd, &st) || !S_ISREG(st.st_mode)) {
+        close(fd);
+        return -2;
+    }
+    if (st.st_size == 0) {
+        close(fd);
+        map->buf = "";
+        return 0;
+    }
+
+    void *p = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (p == MAP_FAILED) return -2;
+
+    posix_madvise(p, st.st_size, POSIX_MADV_SEQUENTIAL);
+    map->buf = (const char*)p;
+    map->len = st.st_size;
+    return 0;
+}
+
+void hvml_mmap_close(hvml_mmap_t *map) {
+    if (map->len) munmap((void*)map->buf, map->len);
+    map->buf = NULL;
+    map->len = 0;
+}
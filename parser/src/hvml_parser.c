@@ -23,6 +23,7 @@
 
 #include <ctype.h>
 #include <string.h>
+#include <time.h>
 
 #define MKSTATE(state) HVML_PARSER_STATE_##state
 #define MKSTR(state)  "HVML_PARSER_STATE_"#state
@@ -32,6 +33,19 @@
       string_get(&parser->curr), c, c, c,                              \
       parser->line+1, parser->col+1, str_state)
 
+// invoke a user callback, accounted if stats are enabled
+#define CALLBACK(token, call)                                          \
+do {                                                                   \
+    if (!parser->stats) {                                              \
+        ret = call;                                                    \
+        break;                                                         \
+    }                                                                  \
+    uint64_t t0_ = now_ns();                                           \
+    ret = call;                                                        \
+    parser->stats->callback_ns += now_ns() - t0_;                      \
+    ++parser->stats->tokens[HVML_PARSER_TOKEN_##token];                \
+} while (0)
+
 typedef enum {
     MKSTATE(BEGIN),
         MKSTATE(MARKUP),
@@ -92,6 +106,7 @@ struct string_s {
     size_t                 len;
 };
 static int         string_append(string_t *str, const char c);
+static int         string_extend(string_t *str, const char *s, size_t len);
 static void        string_reset(string_t *str);
 static void        string_clear(string_t *str);
 static const char* string_get(string_t *str); // if not initialized, return null string rather than null pointer
@@ -100,22 +115,39 @@ struct hvml_parser_s {
     hvml_parser_conf_t             conf;
     HVML_PARSER_STATE             *ar_states;
     size_t                         states;
+    size_t                         states_cap;
     string_t                       cache;
 
     string_t                       curr;
 
     char                         **ar_tags;
     size_t                         tags;
+    // if the content of the innermost element is json, as of <init>
+    unsigned int                   json:1;
 
     unsigned int                   declared:2; // 0:undefined;1:defining;2:defined;3:notexist
-    unsigned int                   commenting:1;
     unsigned int                   rooted:1;
 
+    // the keyword being matched in place, and how much of it is
+    const char                    *keyword;
+    size_t                         matched;
+    // the last chars of the comment text, and how many there are
+    char                           tail[4];
+    size_t                         commented;
+
     size_t                         line;
     size_t                         col;
+    // byte offset of the char being parsed, of the last '<' opening
+    // a markup, and of the first char cached for the current token
+    size_t                         offset;
+    size_t                         markup;
+    size_t                         token;
 
     hvml_json_parser_t            *jp;
     hvml_utf8_decoder_t           *decoder;
+
+    // null unless enabled; parse_ns holds the wall time until reported
+    hvml_parser_stats_t           *stats;
 };
 
 static int               hvml_parser_push_state(hvml_parser_t *parser, HVML_PARSER_STATE state);
@@ -123,45 +155,38 @@ static HVML_PARSER_STATE hvml_parser_pop_state(hvml_parser_t *parser);
 static HVML_PARSER_STATE hvml_parser_peek_state(hvml_parser_t *parser);
 static HVML_PARSER_STATE hvml_parser_chg_state(hvml_parser_t *parser, HVML_PARSER_STATE state);
 static void              dump_states(hvml_parser_t *parser);
+static int               cache_append(hvml_parser_t *parser, string_t *str, const char c);
+static int               keyword_match(hvml_parser_t *parser, const char *keyword, const char c);
+static void              comment_push(hvml_parser_t *parser, const char c);
+static int               comment_ends(hvml_parser_t *parser, const char *s);
+static uint64_t          now_ns(void);
 
 static int         hvml_parser_push_tag(hvml_parser_t *parser, const char *tag);
 static void        hvml_parser_pop_tag(hvml_parser_t *parser);
 static const char* hvml_parser_peek_tag(hvml_parser_t *parser);
 
-static int on_begin(void *arg);
-static int on_open_array(void *arg);
-static int on_close_array(void *arg);
-static int on_open_obj(void *arg);
-static int on_close_obj(void *arg);
-static int on_key(void *arg, const char *key, size_t len);
-static int on_true(void *arg);
-static int on_false(void *arg);
-static int on_null(void *arg);
-static int on_string(void *arg, const char *val, size_t len);
-static int on_integer(void *arg, const char *origin, int64_t val);
-static int on_double(void *arg, const char *origin, double val);
-static int on_end(void *arg);
-
 hvml_parser_t* hvml_parser_create(hvml_parser_conf_t conf) {
     hvml_parser_t *parser = (hvml_parser_t*)calloc(1, sizeof(*parser));
     if (!parser) return NULL;
 
+    // the json callbacks are handed to the embedded parser as they are,
+    // called by it with the user's arg directly
     hvml_json_parser_conf_t jp_conf = {0};
     jp_conf.embedded            = 1;
-    jp_conf.arg                 = parser;
-    jp_conf.on_begin            = on_begin;
-    jp_conf.on_open_array       = on_open_array;
-    jp_conf.on_close_array      = on_close_array;
-    jp_conf.on_open_obj         = on_open_obj;
-    jp_conf.on_close_obj        = on_close_obj;
-    jp_conf.on_key              = on_key;
-    jp_conf.on_true             = on_true;
-    jp_conf.on_false            = on_false;
-    jp_conf.on_null             = on_null;
-    jp_conf.on_string           = on_string;
-    jp_conf.on_integer          = on_integer;
-    jp_conf.on_double           = on_double;
-    jp_conf.on_end              = on_end;
+    jp_conf.arg                 = conf.arg;
+    jp_conf.on_begin            = conf.on_begin;
+    jp_conf.on_open_array       = conf.on_open_array;
+    jp_conf.on_close_array      = conf.on_close_array;
+    jp_conf.on_open_obj         = conf.on_open_obj;
+    jp_conf.on_close_obj        = conf.on_close_obj;
+    jp_conf.on_key              = conf.on_key;
+    jp_conf.on_true             = conf.on_true;
+    jp_conf.on_false            = conf.on_false;
+    jp_conf.on_null             = conf.on_null;
+    jp_conf.on_string           = conf.on_string;
+    jp_conf.on_integer          = conf.on_integer;
+    jp_conf.on_double           = conf.on_double;
+    jp_conf.on_end              = conf.on_end;
 
     parser->jp   = hvml_json_parser_create(jp_conf);
     if (!parser->jp) {
@@ -194,15 +219,77 @@ void hvml_parser_destroy(hvml_parser_t *parser) {
     free(parser->ar_states); parser->ar_states = NULL;
     hvml_json_parser_destroy(parser->jp); parser->jp = NULL;
     hvml_utf8_decoder_destroy(parser->decoder); parser->decoder = NULL;
+    free(parser->stats); parser->stats = NULL;
 
     free(parser);
 }
 
+void hvml_parser_reset(hvml_parser_t *parser) {
+    // buffers and stacks are kept for the next document
+    string_reset(&parser->cache);
+    string_reset(&parser->curr);
+    while (parser->tags) {
+        hvml_parser_pop_tag(parser);
+    }
+    parser->declared   = 0;
+    parser->rooted     = 0;
+    parser->keyword    = NULL;
+    parser->matched    = 0;
+    parser->commented  = 0;
+    parser->line       = 0;
+    parser->col        = 0;
+    parser->offset     = 0;
+    parser->markup     = 0;
+    parser->token      = 0;
+
+    hvml_json_parser_reset(parser->jp);
+    hvml_json_parser_set_offset(parser->jp, 0, 0);
+    hvml_utf8_decoder_reset(parser->decoder);
+
+    parser->states = 0;
+    hvml_parser_push_state(parser, MKSTATE(BEGIN));
+}
+
+int hvml_parser_set_stats(hvml_parser_t *parser, int enable) {
+    if (hvml_json_parser_set_stats(parser->jp, enable)) return -1;
+    if (!enable) {
+        free(parser->stats);
+        parser->stats = NULL;
+        return 0;
+    }
+    if (parser->stats) return 0;
+    parser->stats = (hvml_parser_stats_t*)calloc(1, sizeof(*parser->stats));
+    if (!parser->stats) {
+        hvml_json_parser_set_stats(parser->jp, 0);
+        return -1;
+    }
+    parser->stats->states_max = parser->states;
+    return 0;
+}
+
+int hvml_parser_get_stats(hvml_parser_t *parser, hvml_parser_stats_t *stats) {
+    if (!parser->stats) return -1;
+
+    hvml_parser_stats_t jp_stats;
+    if (hvml_json_parser_get_stats(parser->jp, &jp_stats)) return -1;
+
+    *stats = *parser->stats;
+    // json bytes are part of ours already, and its wall time is in ours
+    jp_stats.bytes    = 0;
+    jp_stats.parse_ns = 0;
+    hvml_parser_stats_add(stats, &jp_stats);
+
+    stats->parse_ns = parser->stats->parse_ns > stats->callback_ns ?
+                      parser->stats->parse_ns - stats->callback_ns : 0;
+    return 0;
+}
+
 static int hvml_parser_at_begin(hvml_parser_t *parser, const char c, const char *str_state) {
     if (isspace(c)) return 0;
     switch (c) {
         case '<':
         {
+            parser->markup = parser->offset;
             hvml_parser_push_state(parser, MKSTATE(MARKUP));
         } break;
         default:
@@ -251,50 +338,41 @@ static int hvml_parser_at_markup(hvml_parser_t *parser, const char c, const char
 }
 
 static int hvml_parser_at_exclamation(hvml_parser_t *parser, const char c, const char *str_state) {
-    static const char doctype[] = "DOCTYPE";
-    switch (c) {
-        case 'D':
-        case 'O':
-        case 'C':
-        case 'T':
-        case 'Y':
-        case 'P':
-        case 'E':
-        {
-            if (parser->commenting) {
-                EPARSE();
-                return -1;
-            }
-            switch (parser->declared) {
-                case 0: parser->declared = 1; break;
-                case 1: break;
-                default:
-                {
+    if (!parser->keyword) {
+        // what follows "<!" is told by its first char
+        switch (c) {
+            case 'D':
+            {
+                if (parser->declared) {
                     EPARSE();
                     return -1;
-                } break;
-            }
-            if (parser->cache.len>=sizeof(doctype)-1 || doctype[parser->cache.len]!=c) {
+                }
+                parser->declared = 1;
+                parser->keyword  = "DOCTYPE";
+            } break;
+            case '-':
+            {
+                parser->keyword  = "--";
+            } break;
+            default:
+            {
                 EPARSE();
                 return -1;
-            }
-            string_append(&parser->cache, c);
-            if (parser->cache.len<sizeof(doctype)-1) break;
-            parser->declared = 2;
-            hvml_parser_chg_state(parser, MKSTATE(IN_DECL));
-        } break;
-        case '-':
+            } break;
+        }
+    }
+    switch (keyword_match(parser, parser->keyword, c)) {
+        case 0: break;
+        case 1:
         {
-            if (parser->declared==1) {
-                EPARSE();
-                return -1;
+            if (parser->keyword[0] == 'D') {
+                parser->declared = 2;
+                hvml_parser_chg_state(parser, MKSTATE(IN_DECL));
+            } else {
+                parser->commented = 0;
+                hvml_parser_chg_state(parser, MKSTATE(COMMENT));
             }
-            parser->commenting = 1;
-            string_append(&parser->cache, c);
-            if (parser->cache.len<2) break;
-            parser->commenting = 0;
-            hvml_parser_chg_state(parser, MKSTATE(COMMENT));
-            string_reset(&parser->cache);
+            parser->keyword = NULL;
         } break;
         default:
         {
@@ -311,7 +389,6 @@ static int hvml_parser_at_in_decl(hvml_parser_t *parser, const char c, const cha
         case 'h':
         {
             hvml_parser_push_state(parser, MKSTATE(HVML));
-            string_reset(&parser->cache);
             return 1; // retry
         } break;
         case '>':
@@ -328,21 +405,11 @@ static int hvml_parser_at_in_decl(hvml_parser_t *parser, const char c, const cha
 }
 
 static int hvml_parser_at_hvml(hvml_parser_t *parser, const char c, const char *str_state) {
-    static const char hvml[] = "hvml";
-    switch (c) {
-        case 'h':
-        case 'v':
-        case 'm':
-        case 'l':
+    switch (keyword_match(parser, "hvml", c)) {
+        case 0: break;
+        case 1:
         {
-            string_append(&parser->cache, c);
-            if (strstr(hvml, string_get(&parser->cache))!=hvml) {
-                EPARSE();
-                return -1;
-            }
-            if (parser->cache.len<sizeof(hvml)-1) break;
             hvml_parser_pop_state(parser);
-            string_reset(&parser->cache);
         } break;
         default:
         {
@@ -355,13 +422,13 @@ static int hvml_parser_at_hvml(hvml_parser_t *parser, const char c, const char *
 
 static int hvml_parser_at_stag(hvml_parser_t *parser, const char c, const char *str_state) {
     if (IS_TAG(c)) {
-        string_append(&parser->cache, c);
+        cache_append(parser, &parser->cache, c);
         return 0;
     }
     if (isspace(c) || c=='/' || c=='>') {
         int ret = 0;
         if (parser->conf.on_open_tag) {
-            ret = parser->conf.on_open_tag(parser->conf.arg, string_get(&parser->cache));
+            CALLBACK(OPEN_TAG, parser->conf.on_open_tag(parser->conf.arg, string_get(&parser->cache)));
         }
         hvml_parser_push_tag(parser, string_get(&parser->cache));
         string_reset(&parser->cache);
@@ -398,7 +465,7 @@ static int hvml_parser_at_emptytag(hvml_parser_t *parser, const char c, const ch
         {
             int ret = 0;
             if (parser->conf.on_close_tag) {
-                ret = parser->conf.on_close_tag(parser->conf.arg);
+                CALLBACK(CLOSE_TAG, parser->conf.on_close_tag(parser->conf.arg));
             }
             hvml_parser_pop_state(parser);
             hvml_parser_pop_tag(parser);
@@ -443,13 +510,13 @@ static int hvml_parser_at_attr_or_end(hvml_parser_t *parser, const char c, const
 
 static int hvml_parser_at_attr(hvml_parser_t *parser, const char c, const char *str_state) {
     if (IS_ATTR(c)) {
-        string_append(&parser->cache, c);
+        cache_append(parser, &parser->cache, c);
         return 0;
     }
     if (isspace(c) || c=='=' || c=='/' || c=='>') {
         int ret = 0;
         if (parser->conf.on_attr_key) {
-            ret = parser->conf.on_attr_key(parser->conf.arg, string_get(&parser->cache));
+            CALLBACK(ATTR_KEY, parser->conf.on_attr_key(parser->conf.arg, string_get(&parser->cache)));
         }
         string_reset(&parser->cache);
         if (ret) return ret;
@@ -502,7 +569,7 @@ static int hvml_parser_at_attr_done(hvml_parser_t *parser, const char c, const c
     if (IS_ATTR(c)) {
         hvml_parser_chg_state(parser, MKSTATE(ATTR));
         string_reset(&parser->cache);
-        string_append(&parser->cache, c);
+        cache_append(parser, &parser->cache, c);
         return 0;
     }
     switch (c) {
@@ -545,7 +612,7 @@ static int hvml_parser_at_str(hvml_parser_t *parser, const char c, const char *s
         { // '"'
             int ret = 0;
             if (parser->conf.on_attr_val) {
-                ret = parser->conf.on_attr_val(parser->conf.arg, string_get(&parser->cache));
+                CALLBACK(ATTR_VAL, parser->conf.on_attr_val(parser->conf.arg, string_get(&parser->cache)));
             }
             string_reset(&parser->cache);
             hvml_parser_pop_state(parser);
@@ -557,7 +624,7 @@ static int hvml_parser_at_str(hvml_parser_t *parser, const char c, const char *s
         } break;
         default:
         {
-            string_append(&parser->cache, c);
+            cache_append(parser, &parser->cache, c);
         } break;
     }
     return 0;
@@ -569,7 +636,7 @@ static int hvml_parser_at_str1(hvml_parser_t *parser, const char c, const char *
         {
             int ret = 0;
             if (parser->conf.on_attr_val) {
-                ret = parser->conf.on_attr_val(parser->conf.arg, string_get(&parser->cache));
+                CALLBACK(ATTR_VAL, parser->conf.on_attr_val(parser->conf.arg, string_get(&parser->cache)));
             }
             string_reset(&parser->cache);
             hvml_parser_pop_state(parser);
@@ -581,7 +648,7 @@ static int hvml_parser_at_str1(hvml_parser_t *parser, const char c, const char *
         } break;
         default:
         {
-            string_append(&parser->cache, c);
+            cache_append(parser, &parser->cache, c);
         } break;
     }
     return 0;
@@ -591,42 +658,42 @@ static int hvml_parser_at_escape(hvml_parser_t *parser, const char c, const char
     switch (c) {
         case 'b':
         {
-            string_append(&parser->cache, '\b');
+            cache_append(parser, &parser->cache, '\b');
             hvml_parser_pop_state(parser);
         } break;
         case 't':
         {
-            string_append(&parser->cache, '\t');
+            cache_append(parser, &parser->cache, '\t');
             hvml_parser_pop_state(parser);
         } break;
         case 'f':
         {
-            string_append(&parser->cache, '\f');
+            cache_append(parser, &parser->cache, '\f');
             hvml_parser_pop_state(parser);
         } break;
         case 'r':
         {
-            string_append(&parser->cache, '\r');
+            cache_append(parser, &parser->cache, '\r');
             hvml_parser_pop_state(parser);
         } break;
         case 'n':
         {
-            string_append(&parser->cache, '\n');
+            cache_append(parser, &parser->cache, '\n');
             hvml_parser_pop_state(parser);
         } break;
         case '\\':
         {
-            string_append(&parser->cache, '\\');
+            cache_append(parser, &parser->cache, '\\');
             hvml_parser_pop_state(parser);
         } break;
         case '\'':
         {
-            string_append(&parser->cache, '\'');
+            cache_append(parser, &parser->cache, '\'');
             hvml_parser_pop_state(parser);
         } break;
         case '"':
         { // '"'
-            string_append(&parser->cache, '"');
+            cache_append(parser, &parser->cache, '"');
             hvml_parser_pop_state(parser);
         } break;
         default:
@@ -639,8 +706,7 @@ static int hvml_parser_at_escape(hvml_parser_t *parser, const char c, const char
 }
 
 static int hvml_parser_at_element(hvml_parser_t *parser, const char c, const char *str_state) {
-    const char* tag = hvml_parser_peek_tag(parser);
-    const int parse_json = (strcmp(tag,"init")==0) || (strcmp(tag, "archedata")==0);
+    const int parse_json = parser->json;
     if (parse_json) {
         int ret = hvml_json_parser_parse_char(parser->jp, c);
         if (ret==0) return 0;
@@ -658,21 +724,23 @@ static int hvml_parser_at_element(hvml_parser_t *parser, const char c, const cha
                 int ret = 0;
                 if (parser->cache.len>0) {
                     if (parser->conf.on_text) {
-                        ret = parser->conf.on_text(parser->conf.arg, string_get(&parser->cache));
+                        CALLBACK(TEXT, parser->conf.on_text(parser->conf.arg, string_get(&parser->cache)));
                     }
                     string_reset(&parser->cache);
                 }
                 if (ret) return ret;
+                parser->markup = parser->offset;
                 hvml_parser_push_state(parser, MKSTATE(MARKUP));
             } else {
                 hvml_json_parser_reset(parser->jp);
+                parser->markup = parser->offset;
                 hvml_parser_push_state(parser, MKSTATE(MARKUP));
             }
         } break;
         default:
         {
             if (!parse_json) {
-                string_append(&parser->cache, c);
+                cache_append(parser, &parser->cache, c);
             } else {
                 EPARSE();
                 return -1;
@@ -682,9 +750,21 @@ static int hvml_parser_at_element(hvml_parser_t *parser, const char c, const cha
     return 0;
 }
 
+// the element is closed at the '>' of its end tag, so that it spans the
+// whole end tag
+static int hvml_parser_close_etag(hvml_parser_t *parser) {
+    int ret = 0;
+    if (parser->conf.on_close_tag) {
+        CALLBACK(CLOSE_TAG, parser->conf.on_close_tag(parser->conf.arg));
+    }
+    hvml_parser_pop_tag(parser);
+    hvml_parser_pop_state(parser);
+    return ret;
+}
+
 static int hvml_parser_at_etag(hvml_parser_t *parser, const char c, const char *str_state) {
     if (IS_TAG(c)) {
-        string_append(&parser->cache, c);
+        cache_append(parser, &parser->cache, c);
         return 0;
     }
     if (isspace(c) || c=='>') {
@@ -693,21 +773,14 @@ static int hvml_parser_at_etag(hvml_parser_t *parser, const char c, const char *
             EPARSE();
             return -1;
         }
-        int ret = 0;
-        if (parser->conf.on_close_tag) {
-            ret = parser->conf.on_close_tag(parser->conf.arg);
-        }
         string_reset(&parser->cache);
-        hvml_parser_pop_tag(parser);
-        if (ret) return ret;
     }
     if (isspace(c)) {
         hvml_parser_chg_state(parser, MKSTATE(EXP_GREATER));
         return 0;
     }
     if (c=='>') {
-        hvml_parser_pop_state(parser);
-        return 0;
+        return hvml_parser_close_etag(parser);
     }
     switch (c) {
         default: {
@@ -723,7 +796,7 @@ static int hvml_parser_at_exp_greater(hvml_parser_t *parser, const char c, const
     switch (c) {
         case '>':
         {
-            hvml_parser_pop_state(parser);
+            return hvml_parser_close_etag(parser);
         } break;
         default:
         {
@@ -738,62 +811,45 @@ static int hvml_parser_at_comment(hvml_parser_t *parser, const char c, const cha
     switch (c) {
         case '>':
         {
-            if (parser->cache.len == 0) {
+            if (parser->commented == 0) {
                 E("comment text starting with >");
                 EPARSE();
                 return -1;
             }
-            if (parser->cache.len == 1 && parser->cache.str[0] == '-') {
+            if (parser->commented == 1 && comment_ends(parser, "-")) {
                 E("comment text starting with ->");
                 EPARSE();
                 return -1;
             }
-            if ((parser->cache.len >= 2) &&
-                (parser->cache.str[parser->cache.len-1]=='-') &&
-                (parser->cache.str[parser->cache.len-2]=='-'))
-            {
+            if (comment_ends(parser, "--")) {
                 hvml_parser_pop_state(parser);
-                string_reset(&parser->cache);
+                parser->commented = 0;
                 break;
             }
-            if ((parser->cache.len >= 3) &&
-                (parser->cache.str[parser->cache.len-1]=='!') &&
-                (parser->cache.str[parser->cache.len-2]=='-') &&
-                (parser->cache.str[parser->cache.len-3]=='-'))
-            {
+            if (comment_ends(parser, "--!")) {
                 E("comment text containing --!>");
                 EPARSE();
                 return -1;
             }
-            string_append(&parser->cache, c);
+            comment_push(parser, c);
         } break;
         case '-':
         {
-            if ((parser->cache.len >= 4) &&
-                (parser->cache.str[parser->cache.len-1]=='-') &&
-                (parser->cache.str[parser->cache.len-2]=='-') &&
-                (parser->cache.str[parser->cache.len-3]=='!') &&
-                (parser->cache.str[parser->cache.len-4]=='<'))
-            {
+            if (comment_ends(parser, "<!--")) {
                 E("comment text ending with <!-");
                 EPARSE();
                 return -1;
             }
-            string_append(&parser->cache, c);
+            comment_push(parser, c);
         } break;
         default:
         {
-            if ((parser->cache.len >= 4) &&
-                (parser->cache.str[parser->cache.len-1]=='-') &&
-                (parser->cache.str[parser->cache.len-2]=='-') &&
-                (parser->cache.str[parser->cache.len-3]=='!') &&
-                (parser->cache.str[parser->cache.len-4]=='<'))
-            {
+            if (comment_ends(parser, "<!--")) {
                 E("comment text containing <!--");
                 EPARSE();
                 return -1;
             }
-            string_append(&parser->cache, c);
+            comment_push(parser, c);
         } break;
     }
     return 0;
@@ -906,15 +962,17 @@ do {                                             \
         ++parser->line;                          \
         parser->col = 0;                         \
     } else {                                     \
-        string_append(&parser->curr, c);         \
+        cache_append(parser, &parser->curr, c);         \
         ++parser->col;                           \
     }                                            \
+    ++parser->offset;                            \
 } while (0)
 
 static int hvml_parser_parse_char_(hvml_parser_t *parser, const char c) {
     int ret = 1;
     do {
         ret = do_hvml_parser_parse_char(parser, c);
+        if (ret==1 && parser->stats) ++parser->stats->retries;
     } while (ret==1); // ret==1: to retry
     if (ret==0) {
         APPEND_TO_CURR();
@@ -922,9 +980,10 @@ static int hvml_parser_parse_char_(hvml_parser_t *parser, const char c) {
     return ret;
 }
 
-int hvml_parser_parse_char(hvml_parser_t *parser, const char c) {
+static int hvml_parser_feed(hvml_parser_t *parser, const char c) {
     int ret = 1;
     uint64_t cp = 0;
+    if (parser->stats) ++parser->stats->bytes;
     ret = hvml_utf8_decoder_push(parser->decoder, c, &cp);
     if (ret==-1) {
         size_t len = 0;
@@ -941,6 +1000,7 @@ int hvml_parser_parse_char(hvml_parser_t *parser, const char c) {
     if (ret==0) return 0;
     size_t len = 0;
     const char *cache = hvml_utf8_decoder_cache(parser->decoder, &len);
+    if (len>1 && parser->stats) ++parser->stats->utf8_multibyte;
     ret = 0;
     for (size_t i=0; cache && i<len; ++i) {
         ret = hvml_parser_parse_char_(parser, cache[i]);
@@ -949,18 +1009,150 @@ int hvml_parser_parse_char(hvml_parser_t *parser, const char c) {
     return ret;
 }
 
+int hvml_parser_parse_char(hvml_parser_t *parser, const char c) {
+    if (!parser->stats) return hvml_parser_feed(parser, c);
+
+    uint64_t t0 = now_ns();
+    int ret = hvml_parser_feed(parser, c);
+    parser->stats->parse_ns += now_ns() - t0;
+    return ret;
+}
+
+#define SWAR_ONES    0x0101010101010101ULL
+#define SWAR_HIGHS   0x8080808080808080ULL
+// non-zero if any of the 8 bytes of `v` equals `c`
+#define SWAR_HAS(v, c)                                               \
+    ((((v) ^ (SWAR_ONES * (c))) - SWAR_ONES) &                       \
+     ~((v) ^ (SWAR_ONES * (c))) & SWAR_HIGHS)
+// the high bit of each byte of `v` that equals `c`, exactly
+#define SWAR_EQ(v, c)                                                \
+    (~(((((v) ^ (SWAR_ONES * (c))) & ~SWAR_HIGHS) + ~SWAR_HIGHS) |   \
+       ((v) ^ (SWAR_ONES * (c)))) & SWAR_HIGHS)
+
+#define IS_BLANK(c)      (c==' ' || c=='\t' || c=='\n' || c=='\r')
+
+// # of leading bytes of buf being blanks
+static size_t span_blank(const char *buf, size_t len) {
+    size_t n = 0;
+    for (; len - n >= 8; n += 8) {
+        uint64_t v;
+        memcpy(&v, buf + n, sizeof(v));
+        uint64_t blank = SWAR_EQ(v, ' ') | SWAR_EQ(v, '\t') | SWAR_EQ(v, '\n') | SWAR_EQ(v, '\r');
+        if (blank != SWAR_HIGHS) break;
+    }
+    while (n < len && IS_BLANK(buf[n])) ++n;
+    return n;
+}
+
+// # of leading bytes of buf being ascii and neither `a` nor `b`
+static size_t span_ascii_until(const char *buf, size_t len, const char a, const char b) {
+    size_t n = 0;
+    for (; len - n >= 8; n += 8) {
+        uint64_t v;
+        memcpy(&v, buf + n, sizeof(v));
+        if ((v & SWAR_HIGHS) | SWAR_HAS(v, a) | SWAR_HAS(v, b)) break;
+    }
+    while (n < len && !(buf[n] & 0x80) && buf[n] != a && buf[n] != b) ++n;
+    return n;
+}
+
+// pass over a run of bytes that would each leave the state as it is, had
+// they been fed one by one: blanks where they are ignored, comment text
+// other than '-' and '>', and element text up to '<'. only ascii is passed
+// over, the rest is left to the utf-8 decoder. line, col, offset and the
+// line kept for error messages follow the newlines passed over;
+// return # of bytes passed over
+static size_t skip_run(hvml_parser_t *parser, const char *buf, size_t len) {
+    size_t n = 0;
+    switch (hvml_parser_peek_state(parser)) {
+        case MKSTATE(BEGIN):
+        case MKSTATE(IN_DECL):
+        case MKSTATE(ATTR_OR_END):
+        case MKSTATE(ATTR_DONE):
+        case MKSTATE(ATTR_VAL):
+        case MKSTATE(EXP_GREATER):
+        case MKSTATE(END):
+        {
+            n = span_blank(buf, len);
+        } break;
+        case MKSTATE(COMMENT):
+        {
+            // the char after "<!--" is checked as it comes
+            if (comment_ends(parser, "-")) return 0;
+            n = span_ascii_until(buf, len, '-', '>');
+            if (n==0) break;
+            if (parser->commented == 0) parser->token = parser->offset;
+            const size_t keep = sizeof(parser->tail);
+            if (n >= keep) {
+                memcpy(parser->tail, buf + n - keep, keep);
+            } else {
+                memmove(parser->tail, parser->tail + n, keep - n);
+                memcpy(parser->tail + keep - n, buf, n);
+            }
+            parser->commented += n;
+        } break;
+        case MKSTATE(ELEMENT):
+        {
+            if (parser->json) return 0;
+            n = span_ascii_until(buf, len, '<', '<');
+            if (n==0) break;
+            if (parser->cache.len == 0) parser->token = parser->offset;
+            if (parser->stats) ++parser->stats->cache_reallocs;
+            if (string_extend(&parser->cache, buf, n)) return 0;
+        } break;
+        default: break;
+    }
+    if (n==0) return 0;
+
+    const char *end  = buf + n;
+    const char *line = buf; // where the last line passed over starts
+    for (const char *p = buf; (p = (const char*)memchr(p, '\n', (size_t)(end - p))); ++p) {
+        ++parser->line;
+        line = p + 1;
+    }
+    if (line != buf) {
+        string_reset(&parser->curr);
+        parser->col = 0;
+    }
+    string_extend(&parser->curr, line, (size_t)(end - line));
+    parser->col    += (size_t)(end - line);
+    parser->offset += n;
+    if (parser->stats) parser->stats->bytes += n;
+
+    return n;
+}
+
 int hvml_parser_parse(hvml_parser_t *parser, const char *buf, size_t len) {
+    uint64_t t0  = parser->stats ? now_ns() : 0;
+    int      ret = 0;
     for (size_t i=0; i<len; ++i) {
-        int ret = hvml_parser_parse_char(parser, buf[i]);
-        if (ret) return ret;
+        if (hvml_utf8_decoder_ready(parser->decoder)) {
+            i += skip_run(parser, buf + i, len - i);
+            if (i == len) break;
+        }
+        ret = hvml_parser_feed(parser, buf[i]);
+        if (ret) break;
     }
-    return 0;
+    if (parser->stats) parser->stats->parse_ns += now_ns() - t0;
+    return ret;
 }
 
 int hvml_parser_parse_string(hvml_parser_t *parser, const char *str) {
     return hvml_parser_parse(parser, (const char *)str, strlen(str));
 }
 
+size_t hvml_parser_offset(hvml_parser_t *parser) {
+    return parser->offset;
+}
+
+size_t hvml_parser_markup_offset(hvml_parser_t *parser) {
+    return parser->markup;
+}
+
+size_t hvml_parser_token_offset(hvml_parser_t *parser) {
+    return parser->token;
+}
+
 int hvml_parser_parse_end(hvml_parser_t *parser) {
     if (parser->tags != 0) {
         E("open tag [%s] not closed", parser->ar_tags[parser->tags - 1]);
@@ -982,6 +1174,47 @@ int hvml_parser_parse_end(hvml_parser_t *parser) {
 
 
 
+static int cache_append(hvml_parser_t *parser, string_t *str, const char c) {
+    // every append reallocs
+    if (parser->stats) ++parser->stats->cache_reallocs;
+    if (str == &parser->cache && str->len == 0) parser->token = parser->offset;
+    return string_append(str, c);
+}
+
+// matches c against the keyword in place rather than collecting and
+// searching it; 1 once complete, 0 while a prefix of it, -1 otherwise
+static int keyword_match(hvml_parser_t *parser, const char *keyword, const char c) {
+    if (keyword[parser->matched] != c) {
+        parser->matched = 0;
+        return -1;
+    }
+    if (parser->matched == 0) parser->token = parser->offset;
+    if (keyword[++parser->matched]) return 0;
+    parser->matched = 0;
+    return 1;
+}
+
+// only the last chars of a comment are kept, enough to tell its end and
+// the sequences it must not contain
+static void comment_push(hvml_parser_t *parser, const char c) {
+    if (parser->commented == 0) parser->token = parser->offset;
+    memmove(parser->tail, parser->tail + 1, sizeof(parser->tail) - 1);
+    parser->tail[sizeof(parser->tail) - 1] = c;
+    ++parser->commented;
+}
+
+static int comment_ends(hvml_parser_t *parser, const char *s) {
+    const size_t n = strlen(s);
+    return parser->commented >= n &&
+           memcmp(parser->tail + sizeof(parser->tail) - n, s, n) == 0;
+}
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
 static int string_append(string_t *str, const char c) {
     // one extra null-terminator
     // actually, won't realloc new mem everytime
@@ -994,6 +1227,17 @@ static int string_append(string_t *str, const char c) {
     return 0;
 }
 
+static int string_extend(string_t *str, const char *s, size_t len) {
+    if (len==0) return 0;
+    char *p = (char*)realloc(str->str, (str->len + len + 1) * sizeof(*p));
+    if (!p) return -1;
+    memcpy(p + str->len, s, len);
+    p[str->len+len] = '\0';
+    str->str        = p;
+    str->len       += len;
+    return 0;
+}
+
 static void string_reset(string_t *str) {
     if (str->len==0) return;
     str->str[0] = '\0';
@@ -1012,12 +1256,20 @@ static const char* string_get(string_t *str) {
 }
 
 static int hvml_parser_push_state(hvml_parser_t *parser, HVML_PARSER_STATE state) {
-    HVML_PARSER_STATE *st = (HVML_PARSER_STATE*)realloc(parser->ar_states, (parser->states + 1) * sizeof(*st));
-    if (!st) return -1;
+    if (parser->states == parser->states_cap) {
+        size_t cap = parser->states_cap ? parser->states_cap * 2 : 16;
+        HVML_PARSER_STATE *st = (HVML_PARSER_STATE*)realloc(parser->ar_states, cap * sizeof(*st));
+        if (!st) return -1;
+        parser->ar_states  = st;
+        parser->states_cap = cap;
+    }
+
+    parser->ar_states[parser->states] = state;
+    parser->states                   += 1;
 
-    st[parser->states] = state;
-    parser->states    += 1;
-    parser->ar_states  = st;
+    if (parser->stats && parser->states > parser->stats->states_max) {
+        parser->stats->states_max = parser->states;
+    }
 
     return 0;
 }
@@ -1057,6 +1309,10 @@ static void dump_states(hvml_parser_t *parser) {
 }
 
 
+static int tag_holds_json(const char *tag) {
+    return strcmp(tag, "init")==0 || strcmp(tag, "archedata")==0;
+}
+
 static int hvml_parser_push_tag(hvml_parser_t *parser, const char *tag) {
     char *s   = strdup(tag);
     if (!s)  return -1;
@@ -1069,6 +1325,7 @@ static int hvml_parser_push_tag(hvml_parser_t *parser, const char *tag) {
     ar[parser->tags] = s;
     parser->tags    += 1;
     parser->ar_tags  = ar;
+    parser->json     = tag_holds_json(s);
 
     return 0;
 }
@@ -1079,6 +1336,7 @@ static void hvml_parser_pop_tag(hvml_parser_t *parser) {
     char *tag      = parser->ar_tags[parser->tags - 1];
     parser->tags  -= 1;
     free(tag);
+    parser->json   = parser->tags>0 && tag_holds_json(parser->ar_tags[parser->tags - 1]);
 }
 
 static const char* hvml_parser_peek_tag(hvml_parser_t *parser) {
@@ -1089,121 +1347,3 @@ static const char* hvml_parser_peek_tag(hvml_parser_t *parser) {
     return tag;
 }
 
-// json callbacks
-static int on_begin(void *arg) {
-    hvml_parser_t *parser = (hvml_parser_t*)arg;
-    int ret = 0;
-    if (parser->conf.on_begin) {
-        ret = parser->conf.on_begin(parser->conf.arg);
-    }
-    return ret;
-}
-
-static int on_open_array(void *arg) {
-    hvml_parser_t *parser = (hvml_parser_t*)arg;
-    int ret = 0;
-    if (parser->conf.on_open_array) {
-        ret = parser->conf.on_open_array(parser->conf.arg);
-    }
-    return ret;
-}
-
-static int on_close_array(void *arg) {
-    hvml_parser_t *parser = (hvml_parser_t*)arg;
-    int ret = 0;
-    if (parser->conf.on_close_array) {
-        ret = parser->conf.on_close_array(parser->conf.arg);
-    }
-    return ret;
-}
-
-static int on_open_obj(void *arg) {
-    hvml_parser_t *parser = (hvml_parser_t*)arg;
-    int ret = 0;
-    if (parser->conf.on_open_obj) {
-        ret = parser->conf.on_open_obj(parser->conf.arg);
-    }
-    return ret;
-}
-
-static int on_close_obj(void *arg) {
-    hvml_parser_t *parser = (hvml_parser_t*)arg;
-    int ret = 0;
-    if (parser->conf.on_close_obj) {
-        ret = parser->conf.on_close_obj(parser->conf.arg);
-    }
-    return ret;
-}
-
-static int on_key(void *arg, const char *key, size_t len) {
-    hvml_parser_t *parser = (hvml_parser_t*)arg;
-    int ret = 0;
-    if (parser->conf.on_key) {
-        ret = parser->conf.on_key(parser->conf.arg, key, len);
-    }
-    return ret;
-}
-
-static int on_true(void *arg) {
-    hvml_parser_t *parser = (hvml_parser_t*)arg;
-    int ret = 0;
-    if (parser->conf.on_true) {
-        ret = parser->conf.on_true(parser->conf.arg);
-    }
-    return ret;
-}
-
-static int on_false(void *arg) {
-    hvml_parser_t *parser = (hvml_parser_t*)arg;
-    int ret = 0;
-    if (parser->conf.on_false) {
-        ret = parser->conf.on_false(parser->conf.arg);
-    }
-    return ret;
-}
-
-static int on_null(void *arg) {
-    hvml_parser_t *parser = (hvml_parser_t*)arg;
-    int ret = 0;
-    if (parser->conf.on_null) {
-        ret = parser->conf.on_null(parser->conf.arg);
-    }
-    return ret;
-}
-
-static int on_string(void *arg, const char *val, size_t len) {
-    hvml_parser_t *parser = (hvml_parser_t*)arg;
-    int ret = 0;
-    if (parser->conf.on_string) {
-        ret = parser->conf.on_string(parser->conf.arg, val, len);
-    }
-    return ret;
-}
-
-static int on_integer(void *arg, const char *origin, int64_t val) {
-    hvml_parser_t *parser = (hvml_parser_t*)arg;
-    int ret = 0;
-    if (parser->conf.on_integer) {
-        ret = parser->conf.on_integer(parser->conf.arg, origin, val);
-    }
-    return ret;
-}
-
-static int on_double(void *arg, const char *origin, double val) {
-    hvml_parser_t *parser = (hvml_parser_t*)arg;
-    int ret = 0;
-    if (parser->conf.on_double) {
-        ret = parser->conf.on_double(parser->conf.arg, origin, val);
-    }
-    return ret;
-}
-
-static int on_end(void *arg) {
-    hvml_parser_t *parser = (hvml_parser_t*)arg;
-    int ret = 0;
-    if (parser->conf.on_end) {
-        ret = parser->conf.on_end(parser->conf.arg);
-    }
-    return ret;
-}
-
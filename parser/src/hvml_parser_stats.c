@@ -0,0 +1,72 @@
+// This file is a part of Purring Cat, a reference implementation of HVML.
+//
+// Copyright (C) 2020, <freemine@yeah.net>.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#include "hvml/hvml_parser_stats.h"
+
+#include <inttypes.h>
+
+static const char *token_names[HVML_PARSER_TOKEN_MAX] = {
+    "open_tag",
+    "attr_key",
+    "attr_val",
+    "close_tag",
+    "text",
+    "begin",
+    "open_array",
+    "close_array",
+    "open_obj",
+    "close_obj",
+    "key",
+    "true",
+    "false",
+    "null",
+    "string",
+    "integer",
+    "double",
+    "end",
+};
+
+void hvml_parser_stats_add(hvml_parser_stats_t *dst, const hvml_parser_stats_t *src) {
+    dst->bytes          += src->bytes;
+    for (int i=0; i<HVML_PARSER_TOKEN_MAX; ++i) {
+        dst->tokens[i]  += src->tokens[i];
+    }
+    if (src->states_max > dst->states_max) dst->states_max = src->states_max;
+    dst->cache_reallocs += src->cache_reallocs;
+    dst->utf8_multibyte += src->utf8_multibyte;
+    dst->retries        += src->retries;
+    dst->callback_ns    += src->callback_ns;
+    dst->parse_ns       += src->parse_ns;
+}
+
+const char* hvml_parser_stats_token_name(HVML_PARSER_TOKEN token) {
+    if (token<0 || token>=HVML_PARSER_TOKEN_MAX) return "unknown";
+    return token_names[token];
+}
+
+void hvml_parser_stats_printf(const hvml_parser_stats_t *stats, const char *prefix, FILE *out) {
+    fprintf(out, "%s_bytes %"PRIu64"\n", prefix, stats->bytes);
+    for (int i=0; i<HVML_PARSER_TOKEN_MAX; ++i) {
+        fprintf(out, "%s_tokens{type=\"%s\"} %"PRIu64"\n", prefix, token_names[i], stats->tokens[i]);
+    }
+    fprintf(out, "%s_states_max %"PRIu64"\n",     prefix, stats->states_max);
+    fprintf(out, "%s_cache_reallocs %"PRIu64"\n", prefix, stats->cache_reallocs);
+    fprintf(out, "%s_utf8_multibyte %"PRIu64"\n", prefix, stats->utf8_multibyte);
+    fprintf(out, "%s_retries %"PRIu64"\n",        prefix, stats->retries);
+    fprintf(out, "%s_callback_ns %"PRIu64"\n",    prefix, stats->callback_ns);
+    fprintf(out, "%s_parse_ns %"PRIu64"\n",       prefix, stats->parse_ns);
+}
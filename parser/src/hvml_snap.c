@@ -0,0 +1,658 @@
+// This file is a part of Purring Cat, a reference implementation of HVML.
+//
+// Copyright (C) 2020, <freemine@yeah.net>.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#include "hvml/hvml_snap.h"
+
+#include "hvml/hvml_json_parser.h"
+#include "hvml/hvml_log.h"
+#include "hvml/hvml_mmap.h"
+
+#include <inttypes.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define SNAP_MAGIC          "HVMLSNAP"
+#define SNAP_BYTE_ORDER     0x01020304
+
+// FNV-1a, 64 bits
+#define HASH_INIT           (14695981039346656037ULL)
+#define HASH_PRIME          (1099511628211ULL)
+
+typedef struct snap_header_s        snap_header_t;
+typedef struct snap_node_s          snap_node_t;
+typedef struct snap_value_s         snap_value_t;
+typedef struct snap_str_s           snap_str_t;
+typedef struct snap_writer_s        snap_writer_t;
+
+// the node records follow the header, then the json value records, then
+// the string pool; all sizes are multiples of 8
+struct snap_header_s {
+    char            magic[8];
+    uint32_t        version;
+    uint32_t        byte_order;
+    uint64_t        size;           // of the whole snapshot
+    uint64_t        checksum;       // of all that follows the header
+    uint32_t        nodes;
+    uint32_t        values;
+    uint64_t        pool_len;
+};
+
+// links only ever point forward, thus a verified snapshot has no cycle
+struct snap_node_s {
+    uint32_t        type;
+    uint32_t        parent;
+    uint32_t        next;
+    uint32_t        first;          // first child of a tag, value of a json
+    uint32_t        attrs;          // first attr of a tag
+    uint32_t        name;           // tag name, attr key
+    uint32_t        name_len;
+    uint32_t        val;            // attr val, text content
+    uint32_t        val_len;
+    uint32_t        reserved;
+};
+
+struct snap_value_s {
+    uint32_t        type;
+    uint32_t        integer;
+    uint32_t        next;
+    uint32_t        first;
+    uint32_t        str;            // string, key, number's origin
+    uint32_t        str_len;
+    union {
+        int64_t     v_i;
+        double      v_d;
+    };
+};
+
+struct hvml_snap_s {
+    hvml_mmap_t          map;
+    const snap_header_t *hdr;
+    const snap_node_t   *nodes;
+    const snap_value_t  *values;
+    const char          *pool;
+};
+
+struct snap_str_s {
+    uint64_t        hash;
+    uint32_t        off;
+    uint32_t        len;
+};
+
+struct snap_writer_s {
+    snap_node_t    *nodes;
+    size_t          nodes_count;
+    size_t          nodes_cap;
+
+    snap_value_t   *values;
+    size_t          values_count;
+    size_t          values_cap;
+
+    char           *pool;
+    size_t          pool_len;
+    size_t          pool_cap;
+
+    // strings already in the pool, open addressing, `strs_cap` a power of 2
+    snap_str_t     *strs;
+    size_t          strs_count;
+    size_t          strs_cap;
+};
+
+static uint64_t hash_bytes(uint64_t h, const void *buf, size_t len) {
+    const unsigned char *p = (const unsigned char*)buf;
+    for (size_t i=0; i<len; ++i) {
+        h ^= p[i];
+        h *= HASH_PRIME;
+    }
+    return h;
+}
+
+static int grow(void **buf, size_t *cap, size_t need, size_t size) {
+    if (need <= *cap) return 0;
+    size_t n = *cap ? *cap : 64;
+    while (n < need) n *= 2;
+    void *p = realloc(*buf, n * size);
+    if (!p) return -1;
+    *buf = p;
+    *cap = n;
+    return 0;
+}
+
+// put the string into the pool once, whatever times it's added
+static int pool_add(snap_writer_t *w, const char *str, size_t len, uint32_t *off, uint32_t *olen) {
+    if (!str) {
+        *off  = HVML_SNAP_NONE;
+        *olen = 0;
+        return 0;
+    }
+    if (len >= UINT32_MAX - w->pool_len - 1) return -1;
+
+    if ((w->strs_count + 1) * 2 > w->strs_cap) {
+        size_t      cap  = w->strs_cap ? w->strs_cap * 2 : 256;
+        snap_str_t *strs = (snap_str_t*)calloc(cap, sizeof(*strs));
+        if (!strs) return -1;
+        for (size_t i=0; i<w->strs_cap; ++i) {
+            if (w->strs[i].len == 0 && w->strs[i].off == 0) continue;
+            size_t j = w->strs[i].hash & (cap - 1);
+            while (strs[j].len || strs[j].off) j = (j + 1) & (cap - 1);
+            strs[j] = w->strs[i];
+        }
+        free(w->strs);
+        w->strs     = strs;
+        w->strs_cap = cap;
+    }
+
+    // slots are empty when zeroed, strings are stored at offset 1 and on
+    uint64_t h = hash_bytes(HASH_INIT, str, len);
+    size_t   j = h & (w->strs_cap - 1);
+    while (w->strs[j].len || w->strs[j].off) {
+        snap_str_t *s = w->strs + j;
+        if (s->hash == h && s->len == len && memcmp(w->pool + s->off, str, len)==0) {
+            *off  = s->off;
+            *olen = s->len;
+            return 0;
+        }
+        j = (j + 1) & (w->strs_cap - 1);
+    }
+
+    if (grow((void**)&w->pool, &w->pool_cap, w->pool_len + len + 1, 1)) return -1;
+    memcpy(w->pool + w->pool_len, str, len);
+    w->pool[w->pool_len + len] = '\0';
+
+    w->strs[j].hash  = h;
+    w->strs[j].off   = (uint32_t)w->pool_len;
+    w->strs[j].len   = (uint32_t)len;
+    w->strs_count   += 1;
+
+    *off          = (uint32_t)w->pool_len;
+    *olen         = (uint32_t)len;
+    w->pool_len  += len + 1;
+    return 0;
+}
+
+static int write_jo(snap_writer_t *w, hvml_jo_value_t *jo, uint32_t *id) {
+    if (w->values_count >= HVML_SNAP_NONE) return -1;
+    if (grow((void**)&w->values, &w->values_cap, w->values_count + 1, sizeof(*w->values))) return -1;
+
+    *id = (uint32_t)w->values_count++;
+    snap_value_t v;
+    memset(&v, 0, sizeof(v));
+    v.type  = hvml_jo_value_type(jo);
+    v.next  = HVML_SNAP_NONE;
+    v.first = HVML_SNAP_NONE;
+    v.str   = HVML_SNAP_NONE;
+
+    const char *str = NULL;
+    size_t      len = 0;
+    switch (hvml_jo_value_type(jo)) {
+        case MKJOT(J_NUMBER): {
+            v.integer = hvml_jo_value_is_integer(jo);
+            if (v.integer) v.v_i = hvml_jo_value_integer(jo);
+            else           v.v_d = hvml_jo_value_double(jo);
+            // none if canonical, as in the json value
+            str = hvml_jo_value_origin(jo);
+            len = str ? strlen(str) : 0;
+        } break;
+        case MKJOT(J_STRING):
+        case MKJOT(J_OBJECT_KV): {
+            str = hvml_jo_value_str(jo, &len);
+        } break;
+        default: break;
+    }
+    if (pool_add(w, str, len, &v.str, &v.str_len)) return -1;
+    w->values[*id] = v;
+
+    uint32_t         prev  = HVML_SNAP_NONE;
+    hvml_jo_value_t *child = hvml_jo_value_first(jo);
+    while (child) {
+        uint32_t c;
+        // attention: recursive call
+        if (write_jo(w, child, &c)) return -1;
+        if (prev == HVML_SNAP_NONE) w->values[*id].first = c;
+        else                        w->values[prev].next = c;
+        prev  = c;
+        child = hvml_jo_value_next(child);
+    }
+    return 0;
+}
+
+static int write_node(snap_writer_t *w, hvml_dom_t *dom, uint32_t parent, uint32_t *id) {
+    if (w->nodes_count >= HVML_SNAP_NONE) return -1;
+    if (grow((void**)&w->nodes, &w->nodes_cap, w->nodes_count + 1, sizeof(*w->nodes))) return -1;
+
+    *id = (uint32_t)w->nodes_count++;
+    snap_node_t n;
+    memset(&n, 0, sizeof(n));
+    n.type   = hvml_dom_type(dom);
+    n.parent = parent;
+    n.next   = HVML_SNAP_NONE;
+    n.first  = HVML_SNAP_NONE;
+    n.attrs  = HVML_SNAP_NONE;
+    n.name   = HVML_SNAP_NONE;
+    n.val    = HVML_SNAP_NONE;
+
+    const char *str = NULL;
+    size_t      len = 0;
+    switch (hvml_dom_type(dom)) {
+        case MKDOT(D_TAG):
+        {
+            str = hvml_dom_name(dom, &len);
+            if (pool_add(w, str, len, &n.name, &n.name_len)) return -1;
+        } break;
+        case MKDOT(D_ATTR):
+        {
+            str = hvml_dom_name(dom, &len);
+            if (pool_add(w, str, len, &n.name, &n.name_len)) return -1;
+            str = hvml_dom_value(dom, &len);
+            if (pool_add(w, str, len, &n.val, &n.val_len)) return -1;
+        } break;
+        case MKDOT(D_TEXT):
+        {
+            str = hvml_dom_value(dom, &len);
+            if (pool_add(w, str ? str : "", len, &n.val, &n.val_len)) return -1;
+        } break;
+        case MKDOT(D_JSON):
+        {
+            if (write_jo(w, hvml_dom_jo(dom), &n.first)) return -1;
+        } break;
+        default:
+        {
+            A(0, "internal logic error");
+        } break;
+    }
+    w->nodes[*id] = n;
+
+    if (hvml_dom_type(dom) != MKDOT(D_TAG)) return 0;
+
+    uint32_t    prev = HVML_SNAP_NONE;
+    hvml_dom_t *attr = hvml_dom_first_attr(dom);
+    while (attr) {
+        uint32_t a;
+        if (write_node(w, attr, *id, &a)) return -1;
+        if (prev == HVML_SNAP_NONE) w->nodes[*id].attrs = a;
+        else                        w->nodes[prev].next = a;
+        prev = a;
+        attr = hvml_dom_next_attr(attr);
+    }
+
+    prev = HVML_SNAP_NONE;
+    hvml_dom_t *child = hvml_dom_first_child(dom);
+    while (child) {
+        uint32_t c;
+        // attention: recursive call
+        if (write_node(w, child, *id, &c)) return -1;
+        if (prev == HVML_SNAP_NONE) w->nodes[*id].first = c;
+        else                        w->nodes[prev].next = c;
+        prev  = c;
+        child = hvml_dom_next(child);
+    }
+    return 0;
+}
+
+int hvml_snap_write(hvml_dom_t *dom, FILE *out) {
+    snap_writer_t w;
+    memset(&w, 0, sizeof(w));
+
+    // the pool never starts with a string, so that offset 0 marks an
+    // empty slot in the dedup table
+    int      ret = -1;
+    uint32_t root;
+    do {
+        if (grow((void**)&w.pool, &w.pool_cap, 8, 1)) break;
+        memset(w.pool, 0, 8);
+        w.pool_len = 1;
+
+        if (write_node(&w, dom, HVML_SNAP_NONE, &root)) break;
+
+        // keep the size of the pool a multiple of 8
+        size_t pad = (8 - w.pool_len % 8) % 8;
+        if (grow((void**)&w.pool, &w.pool_cap, w.pool_len + pad, 1)) break;
+        memset(w.pool + w.pool_len, 0, pad);
+        w.pool_len += pad;
+
+        snap_header_t hdr;
+        memset(&hdr, 0, sizeof(hdr));
+        memcpy(hdr.magic, SNAP_MAGIC, sizeof(hdr.magic));
+        hdr.version     = HVML_SNAP_VERSION;
+        hdr.byte_order  = SNAP_BYTE_ORDER;
+        hdr.nodes       = (uint32_t)w.nodes_count;
+        hdr.values      = (uint32_t)w.values_count;
+        hdr.pool_len    = w.pool_len;
+        hdr.size        = sizeof(hdr)
+                        + w.nodes_count * sizeof(*w.nodes)
+                        + w.values_count * sizeof(*w.values)
+                        + w.pool_len;
+        uint64_t h = HASH_INIT;
+        h = hash_bytes(h, w.nodes, w.nodes_count * sizeof(*w.nodes));
+        h = hash_bytes(h, w.values, w.values_count * sizeof(*w.values));
+        h = hash_bytes(h, w.pool, w.pool_len);
+        hdr.checksum    = h;
+
+        if (fwrite(&hdr, sizeof(hdr), 1, out) != 1) break;
+        if (w.nodes_count &&
+            fwrite(w.nodes, sizeof(*w.nodes), w.nodes_count, out) != w.nodes_count) break;
+        if (w.values_count &&
+            fwrite(w.values, sizeof(*w.values), w.values_count, out) != w.values_count) break;
+        if (fwrite(w.pool, 1, w.pool_len, out) != w.pool_len) break;
+        ret = 0;
+    } while (0);
+
+    free(w.nodes);
+    free(w.values);
+    free(w.pool);
+    free(w.strs);
+    return ret;
+}
+
+static int str_valid(hvml_snap_t *snap, uint32_t off, uint32_t len) {
+    uint64_t pool_len = snap->hdr->pool_len;
+    if (off >= pool_len || len >= pool_len - off) return 0;
+    return snap->pool[off + len] == '\0';
+}
+
+static int link_valid(uint32_t link, uint32_t self, uint32_t count) {
+    return link == HVML_SNAP_NONE || (link > self && link < count);
+}
+
+static int snap_verify(hvml_snap_t *snap) {
+    const snap_header_t *hdr = snap->hdr;
+
+    for (uint32_t i=0; i<hdr->nodes; ++i) {
+        const snap_node_t *n = snap->nodes + i;
+        if (i == 0 && n->parent != HVML_SNAP_NONE) return -1;
+        if (i && n->parent >= i) return -1;
+        if (!link_valid(n->next, i, hdr->nodes)) return -1;
+        if (n->name != HVML_SNAP_NONE && !str_valid(snap, n->name, n->name_len)) return -1;
+        if (n->val != HVML_SNAP_NONE && !str_valid(snap, n->val, n->val_len)) return -1;
+        switch (n->type) {
+            case MKDOT(D_TAG):
+            {
+                if (n->name == HVML_SNAP_NONE) return -1;
+                if (!link_valid(n->first, i, hdr->nodes)) return -1;
+                if (!link_valid(n->attrs, i, hdr->nodes)) return -1;
+            } break;
+            case MKDOT(D_ATTR):
+            {
+                if (n->name == HVML_SNAP_NONE) return -1;
+                if (n->first != HVML_SNAP_NONE || n->attrs != HVML_SNAP_NONE) return -1;
+            } break;
+            case MKDOT(D_TEXT):
+            {
+                if (n->val == HVML_SNAP_NONE) return -1;
+                if (n->first != HVML_SNAP_NONE || n->attrs != HVML_SNAP_NONE) return -1;
+            } break;
+            case MKDOT(D_JSON):
+            {
+                if (n->first >= hdr->values || n->attrs != HVML_SNAP_NONE) return -1;
+            } break;
+            default: return -1;
+        }
+    }
+
+    for (uint32_t i=0; i<hdr->values; ++i) {
+        const snap_value_t *v = snap->values + i;
+        if (!link_valid(v->next, i, hdr->values)) return -1;
+        if (!link_valid(v->first, i, hdr->values)) return -1;
+        if (v->str != HVML_SNAP_NONE && !str_valid(snap, v->str, v->str_len)) return -1;
+        switch (v->type) {
+            case MKJOT(J_TRUE):
+            case MKJOT(J_FALSE):
+            case MKJOT(J_NULL):
+            case MKJOT(J_OBJECT):
+            case MKJOT(J_ARRAY):
+                break;
+            case MKJOT(J_NUMBER):
+                // no origin if canonical
+                break;
+            case MKJOT(J_STRING):
+            case MKJOT(J_OBJECT_KV):
+            {
+                if (v->str == HVML_SNAP_NONE) return -1;
+            } break;
+            default: return -1;
+        }
+    }
+
+    return 0;
+}
+
+hvml_snap_t* hvml_snap_open(const char *file) {
+    hvml_snap_t *snap = (hvml_snap_t*)calloc(1, sizeof(*snap));
+    if (!snap) return NULL;
+
+    if (hvml_mmap_open(&snap->map, file)) {
+        E("failed to map snapshot: %s", file);
+        free(snap);
+        return NULL;
+    }
+
+    const char          *buf = snap->map.buf;
+    const snap_header_t *hdr = (const snap_header_t*)buf;
+    do {
+        if (snap->map.len < sizeof(*hdr)) break;
+        if (memcmp(hdr->magic, SNAP_MAGIC, sizeof(hdr->magic))) break;
+        if (hdr->version != HVML_SNAP_VERSION) break;
+        if (hdr->byte_order != SNAP_BYTE_ORDER) break;
+        if (hdr->size != snap->map.len) break;
+        if (hdr->nodes == 0) break;
+
+        uint64_t nodes_len  = (uint64_t)hdr->nodes * sizeof(snap_node_t);
+        uint64_t values_len = (uint64_t)hdr->values * sizeof(snap_value_t);
+        if (hdr->pool_len == 0 || hdr->pool_len > hdr->size) break;
+        if (sizeof(*hdr) + nodes_len + values_len + hdr->pool_len != hdr->size) break;
+
+        const char *body = buf + sizeof(*hdr);
+        if (hash_bytes(HASH_INIT, body, hdr->size - sizeof(*hdr)) != hdr->checksum) break;
+
+        snap->hdr    = hdr;
+        snap->nodes  = (const snap_node_t*)body;
+        snap->values = (const snap_value_t*)(body + nodes_len);
+        snap->pool   = body + nodes_len + values_len;
+        if (snap_verify(snap)) break;
+
+        return snap;
+    } while (0);
+
+    E("not a valid snapshot: %s", file);
+    hvml_snap_close(snap);
+    return NULL;
+}
+
+void hvml_snap_close(hvml_snap_t *snap) {
+    if (!snap) return;
+    hvml_mmap_close(&snap->map);
+    free(snap);
+}
+
+size_t hvml_snap_nodes(hvml_snap_t *snap) {
+    return snap->hdr->nodes;
+}
+
+HVML_DOM_TYPE hvml_snap_type(hvml_snap_t *snap, uint32_t node) {
+    return (HVML_DOM_TYPE)snap->nodes[node].type;
+}
+
+uint32_t hvml_snap_parent(hvml_snap_t *snap, uint32_t node) {
+    return snap->nodes[node].parent;
+}
+
+uint32_t hvml_snap_next(hvml_snap_t *snap, uint32_t node) {
+    return snap->nodes[node].next;
+}
+
+uint32_t hvml_snap_first_child(hvml_snap_t *snap, uint32_t node) {
+    const snap_node_t *n = snap->nodes + node;
+    return n->type == MKDOT(D_TAG) ? n->first : HVML_SNAP_NONE;
+}
+
+uint32_t hvml_snap_first_attr(hvml_snap_t *snap, uint32_t node) {
+    return snap->nodes[node].attrs;
+}
+
+const char* hvml_snap_name(hvml_snap_t *snap, uint32_t node, size_t *len) {
+    const snap_node_t *n = snap->nodes + node;
+    *len = n->name_len;
+    return n->name == HVML_SNAP_NONE ? NULL : snap->pool + n->name;
+}
+
+const char* hvml_snap_value(hvml_snap_t *snap, uint32_t node, size_t *len) {
+    const snap_node_t *n = snap->nodes + node;
+    *len = n->val_len;
+    return n->val == HVML_SNAP_NONE ? NULL : snap->pool + n->val;
+}
+
+uint32_t hvml_snap_jo(hvml_snap_t *snap, uint32_t node) {
+    const snap_node_t *n = snap->nodes + node;
+    return n->type == MKDOT(D_JSON) ? n->first : HVML_SNAP_NONE;
+}
+
+HVML_JO_TYPE hvml_snap_jo_type(hvml_snap_t *snap, uint32_t jo) {
+    return (HVML_JO_TYPE)snap->values[jo].type;
+}
+
+uint32_t hvml_snap_jo_first(hvml_snap_t *snap, uint32_t jo) {
+    return snap->values[jo].first;
+}
+
+uint32_t hvml_snap_jo_next(hvml_snap_t *snap, uint32_t jo) {
+    return snap->values[jo].next;
+}
+
+int hvml_snap_jo_is_integer(hvml_snap_t *snap, uint32_t jo) {
+    return snap->values[jo].integer;
+}
+
+int64_t hvml_snap_jo_integer(hvml_snap_t *snap, uint32_t jo) {
+    const snap_value_t *v = snap->values + jo;
+    return v->integer ? v->v_i : (int64_t)v->v_d;
+}
+
+double hvml_snap_jo_double(hvml_snap_t *snap, uint32_t jo) {
+    const snap_value_t *v = snap->values + jo;
+    return v->integer ? (double)v->v_i : v->v_d;
+}
+
+const char* hvml_snap_jo_str(hvml_snap_t *snap, uint32_t jo, size_t *len) {
+    const snap_value_t *v = snap->values + jo;
+    *len = v->str_len;
+    return v->str == HVML_SNAP_NONE ? NULL : snap->pool + v->str;
+}
+
+void hvml_snap_printf(hvml_snap_t *snap, uint32_t node, FILE *out) {
+    const snap_node_t *n = snap->nodes + node;
+    switch (n->type) {
+        case MKDOT(D_TAG):
+        {
+            fprintf(out, "<");
+            fprintf(out, "%s", snap->pool + n->name);
+            uint32_t attr = n->attrs;
+            while (attr != HVML_SNAP_NONE) {
+                fprintf(out, " ");
+                hvml_snap_printf(snap, attr, out);
+                attr = snap->nodes[attr].next;
+            }
+            uint32_t child = n->first;
+            if (child == HVML_SNAP_NONE) {
+                fprintf(out, "/>");
+            } else {
+                fprintf(out, ">");
+                while (child != HVML_SNAP_NONE) {
+                    // attention: recursive call
+                    hvml_snap_printf(snap, child, out);
+                    child = snap->nodes[child].next;
+                }
+                fprintf(out, "</");
+                fprintf(out, "%s", snap->pool + n->name);
+                fprintf(out, ">");
+            }
+        } break;
+        case MKDOT(D_ATTR):
+        {
+            fprintf(out, "%s", snap->pool + n->name);
+            if (n->val != HVML_SNAP_NONE) {
+                fprintf(out, ":\"");
+                hvml_dom_attr_val_serialize(snap->pool + n->val, n->val_len, out);
+                fprintf(out, "\"");
+            }
+        } break;
+        case MKDOT(D_TEXT):
+        {
+            hvml_dom_str_serialize(snap->pool + n->val, n->val_len, out);
+        } break;
+        case MKDOT(D_JSON):
+        {
+            hvml_snap_jo_printf(snap, n->first, out);
+        } break;
+        default:
+        {
+            A(0, "internal logic error");
+        } break;
+    }
+}
+
+void hvml_snap_jo_printf(hvml_snap_t *snap, uint32_t jo, FILE *out) {
+    const snap_value_t *v = snap->values + jo;
+    switch (v->type) {
+        case MKJOT(J_TRUE): {
+            fprintf(out, "true");
+        } break;
+        case MKJOT(J_FALSE): {
+            fprintf(out, "false");
+        } break;
+        case MKJOT(J_NULL): {
+            fprintf(out, "null");
+        } break;
+        case MKJOT(J_NUMBER): {
+            if (v->integer) {
+                fprintf(out, "%"PRId64"", v->v_i);
+            } else if (v->str == HVML_SNAP_NONE) {
+                char buf[32];
+                hvml_jo_number_canonical(0, 0, v->v_d, buf, sizeof(buf));
+                fputs(buf, out);
+            } else {
+                fprintf(out, "%.*g", (int)v->str_len, v->v_d);
+            }
+        } break;
+        case MKJOT(J_STRING): {
+            hvml_json_str_printf(out, snap->pool + v->str, v->str_len);
+        } break;
+        case MKJOT(J_OBJECT_KV): {
+            hvml_json_str_printf(out, snap->pool + v->str, v->str_len);
+            if (v->first != HVML_SNAP_NONE) {
+                fprintf(out, ":");
+                // attention: recursive call
+                hvml_snap_jo_printf(snap, v->first, out);
+            }
+        } break;
+        case MKJOT(J_OBJECT):
+        case MKJOT(J_ARRAY): {
+            const int obj = v->type == MKJOT(J_OBJECT);
+            fprintf(out, obj ? "{" : "[");
+            uint32_t c = v->first;
+            while (c != HVML_SNAP_NONE) {
+                // attention: recursive call
+                hvml_snap_jo_printf(snap, c, out);
+                c = snap->values[c].next;
+                if (c == HVML_SNAP_NONE) break;
+                fprintf(out, ",");
+            }
+            fprintf(out, obj ? "}" : "]");
+        } break;
+        default: {
+            A(0, "print json type [%d]: not implemented yet", v->type);
+        } break;
+    }
+}
@@ -56,6 +56,12 @@ void hvml_utf8_decoder_destroy(hvml_utf8_decoder_t *decoder) {
     free(decoder);
 }
 
+void hvml_utf8_decoder_reset(hvml_utf8_decoder_t *decoder) {
+    decoder->state = MKDT(D_INIT);
+    decoder->cp    = 0;
+    hvml_string_reset(&decoder->cache);
+}
+
 #define do_output()                                    \
 do {                                                   \
     if (cp) {                                          \
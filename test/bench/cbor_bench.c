@@ -0,0 +1,173 @@
+// This file is a part of Purring Cat, a reference implementation of HVML.
+//
+// Copyright (C) 2020, <freemine@yeah.net>.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+// time a json value's round trip through json text and through cbor,
+// the value being test/parser/test/sample.json repeated `copies` times
+// in an array:
+//   cbor_bench [sample.json] [copies] [rounds]
+
+#include "hvml/hvml_jo.h"
+#include "hvml/hvml_jo_cbor.h"
+#include "hvml/hvml_log.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+static double now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static char* read_file(const char *file, size_t *len) {
+    FILE *in = fopen(file, "rb");
+    if (!in) return NULL;
+    char   *buf = NULL;
+    size_t  cap = 0;
+    *len = 0;
+    while (1) {
+        if (*len == cap) {
+            cap = cap ? cap * 2 : 4096;
+            char *p = (char*)realloc(buf, cap);
+            if (!p) break;
+            buf = p;
+        }
+        size_t n = fread(buf + *len, 1, cap - *len, in);
+        if (n == 0) break;
+        *len += n;
+    }
+    fclose(in);
+    return buf;
+}
+
+// "[" sample "," sample ... "]"
+static char* scale(const char *sample, size_t len, int copies, size_t *out_len) {
+    char *buf = NULL;
+    FILE *out = open_memstream(&buf, out_len);
+    if (!out) return NULL;
+    fputc('[', out);
+    for (int i=0; i<copies; ++i) {
+        if (i) fputc(',', out);
+        fwrite(sample, 1, len, out);
+    }
+    fputc(']', out);
+    fclose(out);
+    return buf;
+}
+
+static hvml_jo_value_t* parse_text(const char *buf, size_t len) {
+    hvml_jo_gen_t *gen = hvml_jo_gen_acquire();
+    if (!gen) return NULL;
+    int ret = hvml_jo_gen_parse(gen, buf, len);
+    hvml_jo_value_t *jo = hvml_jo_gen_parse_end(gen);
+    hvml_jo_gen_release(gen);
+    if (ret && jo) {
+        hvml_jo_value_free(jo);
+        jo = NULL;
+    }
+    return jo;
+}
+
+static hvml_jo_value_t* parse_cbor(const char *buf, size_t len, size_t chunk) {
+    hvml_jo_cbor_dec_t *dec = hvml_jo_cbor_dec_create();
+    if (!dec) return NULL;
+    int ret = 0;
+    for (size_t i=0; ret==0 && i<len; i+=chunk) {
+        ret = hvml_jo_cbor_dec_parse(dec, buf + i, len - i < chunk ? len - i : chunk);
+    }
+    hvml_jo_value_t *jo = ret ? NULL : hvml_jo_cbor_dec_parse_end(dec);
+    hvml_jo_cbor_dec_destroy(dec);
+    return jo;
+}
+
+int main(int argc, char *argv[]) {
+    const char *file   = argc > 1 ? argv[1] : "test/parser/test/sample.json";
+    int         copies = argc > 2 ? atoi(argv[2]) : 1000;
+    int         rounds = argc > 3 ? atoi(argv[3]) : 10;
+    if (copies <= 0) copies = 1;
+    if (rounds <= 0) rounds = 1;
+
+    hvml_log_set_thread_type("bench");
+
+    size_t len = 0;
+    char  *sample = read_file(file, &len);
+    if (!sample) {
+        fprintf(stderr, "failed to read %s\n", file);
+        return 1;
+    }
+    size_t text_len = 0;
+    char  *text     = scale(sample, len, copies, &text_len);
+    free(sample);
+    if (!text) return 1;
+
+    hvml_jo_value_t *jo = parse_text(text, text_len);
+    if (!jo) {
+        fprintf(stderr, "failed to parse %s\n", file);
+        return 1;
+    }
+
+    char  *cbor     = NULL;
+    size_t cbor_len = 0;
+    FILE  *out      = open_memstream(&cbor, &cbor_len);
+    if (!out || hvml_jo_cbor_write(jo, out)) return 1;
+    fclose(out);
+
+    // the decoder is streaming, chunks of any size shall do
+    hvml_jo_value_t *back = parse_cbor(cbor, cbor_len, 7);
+    if (!back || !hvml_jo_value_equal(jo, back)) {
+        fprintf(stderr, "cbor round trip mismatch\n");
+        return 1;
+    }
+    hvml_jo_value_free(back);
+    hvml_jo_value_free(jo);
+
+    char   *buf     = NULL;
+    size_t  buf_len = 0;
+
+    double start = now();
+    for (int r=0; r<rounds; ++r) {
+        hvml_jo_value_t *v = parse_text(text, text_len);
+        out = open_memstream(&buf, &buf_len);
+        hvml_jo_value_printf(v, out);
+        fclose(out);
+        free(buf);
+        hvml_jo_value_free(v);
+    }
+    double text_secs = now() - start;
+
+    start = now();
+    for (int r=0; r<rounds; ++r) {
+        hvml_jo_value_t *v = parse_cbor(cbor, cbor_len, 4096);
+        out = open_memstream(&buf, &buf_len);
+        hvml_jo_cbor_write(v, out);
+        fclose(out);
+        free(buf);
+        hvml_jo_value_free(v);
+    }
+    double cbor_secs = now() - start;
+
+    printf("json text: %zu bytes, %.3fs, %.1f MB/s\n", text_len, text_secs,
+           text_len * (double)rounds / text_secs / 1e6);
+    printf("cbor:      %zu bytes, %.3fs, %.1f MB/s of json text\n", cbor_len, cbor_secs,
+           text_len * (double)rounds / cbor_secs / 1e6);
+
+    free(text);
+    free(cbor);
+    return 0;
+}
@@ -0,0 +1,105 @@
+// This file is a part of Purring Cat, a reference implementation of HVML.
+//
+// Copyright (C) 2020, <freemine@yeah.net>.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+// time parsing a corpus of malformed json, with logging written to
+// /dev/null and with logging turned off at runtime:
+//   json_neg_bench [rounds]
+// json_neg_bench_quiet runs the same against libraries built with
+// HVML_LOG_LEVEL=HVML_LOG_LEVEL_I
+
+#include "hvml/hvml_jo.h"
+#include "hvml/hvml_log.h"
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+static const char *corpus[] = {
+    "{",
+    "[",
+    "{\"a\":",
+    "{\"a\" 1}",
+    "{\"a\":1,}",
+    "[1,2,]",
+    "[1 2]",
+    "{a:1}",
+    "{\"a\":tru}",
+    "[nul]",
+    "[fals]",
+    "[01]",
+    "[-]",
+    "[1.]",
+    "[1e]",
+    "[.5]",
+    "[\"\\x\"]",
+    "[\"\\u12\"]",
+    "[\"abc",
+    "[1.5, 2.25, 1e3, -0.0, 3.14159",
+    "{\"k\":[1.5,2.5,{\"x\":1e-3}]",
+    "]",
+    "}",
+    "[1]]",
+    "{\"a\":1}}",
+    "[true false]",
+};
+
+#define CORPUS_SIZE (sizeof(corpus)/sizeof(corpus[0]))
+
+static double now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static double run(int rounds) {
+    double start = now();
+    for (int r=0; r<rounds; ++r) {
+        for (size_t i=0; i<CORPUS_SIZE; ++i) {
+            hvml_jo_gen_t *gen = hvml_jo_gen_create();
+            if (!gen) return -1;
+            hvml_jo_value_t *jo = NULL;
+            if (hvml_jo_gen_parse_string(gen, corpus[i])==0) {
+                jo = hvml_jo_gen_parse_end(gen);
+            }
+            if (jo) hvml_jo_value_free(jo);
+            hvml_jo_gen_destroy(gen);
+        }
+    }
+    return now() - start;
+}
+
+int main(int argc, char *argv[]) {
+    int rounds = argc > 1 ? atoi(argv[1]) : 20000;
+    if (rounds <= 0) rounds = 1;
+
+    if (!freopen("/dev/null", "w", stderr)) return 1;
+
+    hvml_log_set_thread_type("bench");
+
+    double logged = run(rounds);
+    hvml_log_set_level('A');
+    double silent = run(rounds);
+
+    size_t docs = (size_t)rounds * CORPUS_SIZE;
+    printf("documents:            %zu\n", docs);
+    printf("logging to /dev/null: %.3fs, %.0f ns/doc\n", logged, logged * 1e9 / docs);
+    printf("logging off:          %.3fs, %.0f ns/doc\n", silent, silent * 1e9 / docs);
+
+    return 0;
+}
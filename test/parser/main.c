@@ -18,20 +18,43 @@
 #include "hvml/hvml_parser.h"
 
 #include "hvml/hvml_dom.h"
+#include "hvml/hvml_dom_pos.h"
 #include "hvml/hvml_jo.h"
+#include "hvml/hvml_jo_cbor.h"
+#include "hvml/hvml_jo_cow.h"
+#include "hvml/hvml_jo_query.h"
 #include "hvml/hvml_json_parser.h"
 #include "hvml/hvml_log.h"
+#include "hvml/hvml_mmap.h"
+#include "hvml/hvml_snap.h"
 #include "hvml/hvml_utf8.h"
 
 #include <inttypes.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 
 static const char* file_ext(const char *file);
-static int process(FILE *in, const char *ext);
-static int process_hvml(FILE *in);
-static int process_json(FILE *in);
+static int process(FILE *in, const char *file, const char *ext);
+static int process_hvml(const char *file);
+static int process_json(const char *file);
+static int process_snap(const char *file);
+static int compile(const char *file, const char *snap);
+static int process_cbor(FILE *in);
+static int convert(const char *file, const char *to);
+static int edit(const char *file, const char *from, const char *to);
+static int positions(const char *file);
+static int update(const char *file, const char *path, const char *json);
+static int column(const char *file, const char *key);
+static int query(const char *file, const char *path);
+static int equal(const char *file);
+static int tmpl(const char *file);
+static int stats(const char *file);
 static int process_utf8(FILE *in);
+static int process_many(int threads, int count, const char **files);
+
+// with -j, each json file is parsed on that many threads as well
+static int json_threads = 0;
 
 int main(int argc, char *argv[]) {
     if (argc == 1) return 0;
@@ -40,8 +63,83 @@ int main(int argc, char *argv[]) {
         hvml_log_set_output_only(1);
     }
 
+    // e.g. I, so that what is logged doesn't hang on the levels compiled
+    // in, see HVML_LOG_LEVEL
+    const char *level = getenv("HVML_LOG_MIN_LEVEL");
+    if (level && level[0]) {
+        hvml_log_set_level(level[0]);
+    }
+
+    if (getenv("HVML_LOG_ASYNC")) {
+        hvml_log_set_async(1);
+    }
+
     hvml_log_set_thread_type("main");
 
+    // hp --compile file.hvml file.snap: write the parsed file as a snapshot
+    if (argc == 4 && strcmp(argv[1], "--compile")==0) {
+        return compile(argv[2], argv[3]);
+    }
+
+    // hp --convert file.json file.cbor, or back
+    if (argc == 4 && strcmp(argv[1], "--convert")==0) {
+        return convert(argv[2], argv[3]);
+    }
+
+    // hp --edit file.hvml from to: re-parse the file after replacing the
+    // first `from` in it with `to`
+    if (argc == 5 && strcmp(argv[1], "--edit")==0) {
+        return edit(argv[2], argv[3], argv[4]);
+    }
+
+    // hp --positions file.hvml: where each node starts, in document order
+    if (argc == 3 && strcmp(argv[1], "--positions")==0) {
+        return positions(argv[2]);
+    }
+
+    // hp --update file.json path [json]: a version of the file with the
+    // value at `path`, e.g. `[1].name`, set to `json`, or removed
+    if ((argc == 4 || argc == 5) && strcmp(argv[1], "--update")==0) {
+        return update(argv[2], argv[3], argc == 5 ? argv[4] : NULL);
+    }
+
+    // hp --column file.json key: the values of `key` in the objects of
+    // the top-level array, then how many of them share shapes
+    if (argc == 4 && strcmp(argv[1], "--column")==0) {
+        return column(argv[2], argv[3]);
+    }
+
+    // hp --query file.json path: the values at `path`, e.g.
+    // `$.items[*].id`, one per line, without loading the whole file
+    if (argc == 4 && strcmp(argv[1], "--query")==0) {
+        return query(argv[2], argv[3]);
+    }
+
+    // hp --equal file.json: for each member of the top-level array, the
+    // other members equal to it, checked to hash the same
+    if (argc == 3 && strcmp(argv[1], "--equal")==0) {
+        return equal(argv[2]);
+    }
+
+    // hp --tmpl file.hvml: the session state of the file as a template,
+    // forked twice with one fork updated, then shared with one version
+    // updated; each followed by whether the template's state is intact
+    if (argc == 3 && strcmp(argv[1], "--tmpl")==0) {
+        return tmpl(argv[2]);
+    }
+
+    // hp --stats file: the parser counters from loading the file, the
+    // timings left out
+    if (argc == 3 && strcmp(argv[1], "--stats")==0) {
+        return stats(argv[2]);
+    }
+
+    // hp -j N files...: load the hvml files on N threads
+    if (argc > 2 && strcmp(argv[1], "-j")==0) {
+        json_threads = atoi(argv[2]);
+        return process_many(json_threads, argc - 3, (const char**)argv + 3);
+    }
+
     for (int i=1; i<argc; ++i) {
         const char *file = argv[i];
         const char *ext  = file_ext(file);
@@ -53,7 +151,7 @@ int main(int argc, char *argv[]) {
         }
 
         I("processing file: %s", file);
-        int ret = process(in, ext);
+        int ret = process(in, file, ext);
 
         if (in) fclose(in);
 
@@ -68,18 +166,23 @@ static const char* file_ext(const char *file) {
     return p ? p : "";
 }
 
-static int process(FILE *in, const char *ext) {
+// hvml and json files are loaded by path, memory-mapped
+static int process(FILE *in, const char *file, const char *ext) {
     if (strcmp(ext, ".utf8")==0) {
         return process_utf8(in);
     }else if (strcmp(ext, ".json")==0) {
-        return process_json(in);
+        return process_json(file);
+    } else if (strcmp(ext, ".snap")==0) {
+        return process_snap(file);
+    } else if (strcmp(ext, ".cbor")==0) {
+        return process_cbor(in);
     } else {
-        return process_hvml(in);
+        return process_hvml(file);
     }
 }
 
-static int process_hvml(FILE *in) {
-    hvml_dom_t *dom = hvml_dom_load_from_stream(in);
+static int process_hvml(const char *file) {
+    hvml_dom_t *dom = hvml_dom_load_from_file(file);
     if (dom) {
         hvml_dom_printf(dom, stdout);
         hvml_dom_destroy(dom);
@@ -89,8 +192,622 @@ static int process_hvml(FILE *in) {
     return 1;
 }
 
-static int process_json(FILE *in) {
-    hvml_jo_value_t *jo = hvml_jo_value_load_from_stream(in);
+static int process_snap(const char *file) {
+    hvml_snap_t *snap = hvml_snap_open(file);
+    if (snap) {
+        hvml_snap_printf(snap, 0, stdout);
+        hvml_snap_close(snap);
+        printf("\n");
+        return 0;
+    }
+    return 1;
+}
+
+static int compile(const char *file, const char *snap) {
+    hvml_dom_t *dom = hvml_dom_load_from_file(file);
+    if (!dom) return 1;
+
+    int   ret = 1;
+    FILE *out = fopen(snap, "wb");
+    if (!out) {
+        E("failed to open file: %s", snap);
+    } else {
+        ret = hvml_snap_write(dom, out) ? 1 : 0;
+        if (fclose(out)) ret = 1;
+        if (ret) E("failed to write snapshot: %s", snap);
+    }
+    hvml_dom_destroy(dom);
+    return ret;
+}
+
+// the spans of both trees the same, node by node
+static int same_spans(hvml_dom_t *a, hvml_dom_t *b) {
+    while (a && b) {
+        size_t as = 0, ae = 0, bs = 0, be = 0;
+        int ra = hvml_dom_span(a, &as, &ae);
+        int rb = hvml_dom_span(b, &bs, &be);
+        if (ra != rb || as != bs || ae != be) return 0;
+        if (!same_spans(hvml_dom_first_child(a), hvml_dom_first_child(b))) return 0;
+        a = hvml_dom_next(a);
+        b = hvml_dom_next(b);
+    }
+    return a == b;
+}
+
+static int edit(const char *file, const char *from, const char *to) {
+    hvml_mmap_t map;
+    if (hvml_mmap_open(&map, file)) {
+        E("failed to map file: %s", file);
+        return 1;
+    }
+
+    const char *p = NULL;
+    size_t      n = strlen(from);
+    for (size_t i=0; n && i+n<=map.len; ++i) {
+        if (memcmp(map.buf + i, from, n)==0) {
+            p = map.buf + i;
+            break;
+        }
+    }
+    if (!p) {
+        E("not found in %s: %s", file, from);
+        hvml_mmap_close(&map);
+        return 1;
+    }
+
+    size_t offset = p - map.buf;
+    size_t m      = strlen(to);
+    size_t len    = map.len - n + m;
+    char  *text   = (char*)malloc(len);
+    if (!text) {
+        hvml_mmap_close(&map);
+        return 1;
+    }
+    memcpy(text, map.buf, offset);
+    memcpy(text + offset, to, m);
+    memcpy(text + offset + m, p + n, map.len - offset - n);
+
+    hvml_dom_t *dom = hvml_dom_load_from_file(file);
+    hvml_mmap_close(&map);
+    if (!dom) {
+        free(text);
+        return 1;
+    }
+
+    int ret = 1;
+    hvml_dom_t *edited = hvml_dom_reparse(dom, text, len, offset, n, m);
+    if (!edited) {
+        hvml_dom_destroy(dom);
+    } else {
+        // checked against the edited text parsed as a whole
+        FILE *in = fmemopen(text, len, "rb");
+        hvml_dom_t *full = in ? hvml_dom_load_from_stream(in) : NULL;
+        if (in) fclose(in);
+        if (!full || !same_spans(edited, full)) {
+            E("spans differ from the full parse: %s", file);
+        } else {
+            hvml_dom_printf(edited, stdout);
+            printf("\n");
+            ret = 0;
+        }
+        if (full) hvml_dom_destroy(full);
+        hvml_dom_destroy(edited);
+    }
+    free(text);
+    return ret;
+}
+
+static int print_positions(hvml_dom_t *root, hvml_dom_t *dom, hvml_dom_pos_t *pos,
+                           const hvml_mmap_t *map)
+{
+    static const char *types[] = { "tag", "attr", "text", "json" };
+
+    size_t ordinal = hvml_dom_ordinal(root, dom);
+    size_t offset = 0, line = 0, col = 0;
+    if (hvml_dom_pos_offset(pos, ordinal, &offset) ||
+        hvml_dom_pos_line_col(pos, map->buf, map->len, offset, &line, &col))
+    {
+        E("no position for node #%zd", ordinal);
+        return -1;
+    }
+    size_t start = 0, end = 0;
+    if (hvml_dom_span(dom, &start, &end)==0 && start != offset) {
+        E("node #%zd at %zd, spanning from %zd", ordinal, offset, start);
+        return -1;
+    }
+
+    HVML_DOM_TYPE type = hvml_dom_type(dom);
+    size_t        len  = 0;
+    printf("%zd:%zd %s", line, col, types[type]);
+    if (type == MKDOT(D_TAG) || type == MKDOT(D_ATTR)) {
+        const char *name = hvml_dom_name(dom, &len);
+        printf(" %.*s", (int)len, name);
+    }
+    printf("\n");
+
+    if (type != MKDOT(D_TAG)) return 0;
+    for (hvml_dom_t *attr = hvml_dom_first_attr(dom); attr; attr = hvml_dom_next_attr(attr)) {
+        if (print_positions(root, attr, pos, map)) return -1;
+    }
+    for (hvml_dom_t *child = hvml_dom_first_child(dom); child; child = hvml_dom_next(child)) {
+        if (hvml_dom_type(child) == MKDOT(D_ATTR)) continue;
+        if (print_positions(root, child, pos, map)) return -1;
+    }
+    return 0;
+}
+
+static int positions(const char *file) {
+    hvml_mmap_t map;
+    if (hvml_mmap_open(&map, file)) {
+        E("failed to map file: %s", file);
+        return 1;
+    }
+
+    int             ret = 1;
+    hvml_dom_t     *dom = NULL;
+    hvml_dom_pos_t *pos = NULL;
+    hvml_dom_gen_t *gen = hvml_dom_gen_create();
+    if (gen && hvml_dom_gen_set_positions(gen, 1)==0) {
+        int r = hvml_dom_gen_parse(gen, map.buf, map.len);
+        dom = hvml_dom_gen_parse_end(gen);
+        pos = hvml_dom_gen_take_positions(gen);
+        if (r==0 && dom && pos) {
+            ret = print_positions(dom, dom, pos, &map) ? 1 : 0;
+        }
+    }
+    if (dom) hvml_dom_destroy(dom);
+    hvml_dom_pos_destroy(pos);
+    if (gen) hvml_dom_gen_destroy(gen);
+    hvml_mmap_close(&map);
+    return ret;
+}
+
+// `.key` and `[index]` steps, -1 if malformed or too deep
+static int parse_path(const char *path, hvml_jo_cow_step_t *steps, size_t cap, size_t *depth) {
+    const char *p = path;
+    if (*p == '$') ++p;
+    for (*depth = 0; *p; ++*depth) {
+        if (*depth == cap) return -1;
+        hvml_jo_cow_step_t *step = steps + *depth;
+        if (*p == '.') {
+            size_t len = strcspn(++p, ".[");
+            if (len == 0) return -1;
+            step->key = p;
+            step->len = len;
+            p += len;
+        } else if (*p == '[') {
+            char *end = NULL;
+            step->key   = NULL;
+            step->index = strtoul(p + 1, &end, 10);
+            if (end == p + 1 || *end != ']') return -1;
+            p = end + 1;
+        } else {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+static int update(const char *file, const char *path, const char *json) {
+    hvml_jo_cow_step_t steps[32];
+    size_t             depth = 0;
+    if (parse_path(path, steps, sizeof(steps)/sizeof(steps[0]), &depth)) {
+        E("bad path: %s", path);
+        return 1;
+    }
+
+    hvml_jo_value_t *jo = hvml_jo_value_load_from_file(file);
+    if (!jo) return 1;
+    hvml_jo_cow_t *orig = hvml_jo_cow_freeze(jo);
+    hvml_jo_value_free(jo);
+    if (!orig) return 1;
+
+    hvml_jo_cow_t *val = NULL;
+    if (json) {
+        hvml_jo_gen_t *gen = hvml_jo_gen_acquire();
+        jo = NULL;
+        if (gen && hvml_jo_gen_parse_string(gen, json)==0) jo = hvml_jo_gen_parse_end(gen);
+        hvml_jo_gen_release(gen);
+        if (jo) {
+            val = hvml_jo_cow_freeze(jo);
+            hvml_jo_value_free(jo);
+        }
+        if (!val) {
+            hvml_jo_cow_unref(orig);
+            return 1;
+        }
+    }
+
+    // a fork of the original, updated
+    hvml_jo_cow_t *fork    = hvml_jo_cow_ref(orig);
+    hvml_jo_cow_t *updated = val ? hvml_jo_cow_set(fork, steps, depth, val)
+                                 : hvml_jo_cow_remove(fork, steps, depth);
+    hvml_jo_cow_unref(fork);
+    if (val) hvml_jo_cow_unref(val);
+
+    int ret = 1;
+    if (!updated) {
+        E("no such path: %s", path);
+    } else {
+        // the members off the path are the original's, not copies
+        size_t  i    = 0;
+        size_t  n    = hvml_jo_cow_count(orig);
+        int     kept = 1;
+        hvml_jo_cow_t *on = NULL;
+        if (depth && hvml_jo_cow_count(updated) == n) {
+            on = hvml_jo_cow_find(updated, steps, 1);
+        }
+        for (; on && i<n; ++i) {
+            hvml_jo_cow_t *m = hvml_jo_cow_at(updated, i);
+            if (m != on && m != hvml_jo_cow_at(orig, i)) kept = 0;
+        }
+        hvml_jo_value_t *a = hvml_jo_cow_thaw(updated);
+        hvml_jo_value_t *b = hvml_jo_cow_thaw(orig);
+        if (!kept) {
+            E("members off the path copied: %s", path);
+        } else if (a && b) {
+            hvml_jo_value_printf(a, stdout);
+            printf("\n");
+            hvml_jo_value_printf(b, stdout);
+            printf("\n");
+            ret = 0;
+        }
+        if (a) hvml_jo_value_free(a);
+        if (b) hvml_jo_value_free(b);
+        hvml_jo_cow_unref(updated);
+    }
+    hvml_jo_cow_unref(orig);
+    return ret;
+}
+
+static int column(const char *file, const char *key) {
+    hvml_jo_value_t *jo = hvml_jo_value_load_from_file(file);
+    if (!jo) return 1;
+    if (hvml_jo_value_type(jo) != MKJOT(J_ARRAY)) {
+        E("not an array: %s", file);
+        hvml_jo_value_free(jo);
+        return 1;
+    }
+
+    hvml_jo_column_t col;
+    hvml_jo_column_init(&col, key, strlen(key));
+
+    int    ret     = 0;
+    size_t objects = 0, shaped = 0, shapes = 0;
+    const hvml_jo_shape_t *last = NULL;
+    for (hvml_jo_value_t *v = hvml_jo_value_first(jo); v; v = hvml_jo_value_next(v)) {
+        if (hvml_jo_value_type(v) != MKJOT(J_OBJECT)) continue;
+        ++objects;
+        const hvml_jo_shape_t *shape = hvml_jo_object_shape(v);
+        if (shape) {
+            ++shaped;
+            if (shape != last) ++shapes;
+        }
+        last = shape;
+
+        hvml_jo_value_t *kv = hvml_jo_column_get(&col, v);
+        if (kv != hvml_jo_object_get_kv_by_key(v, key, strlen(key))) {
+            E("column and key search disagree: %s", key);
+            ret = 1;
+            break;
+        }
+        if (!kv) continue;
+        hvml_jo_value_printf(hvml_jo_value_first(kv), stdout);
+        printf("\n");
+    }
+    hvml_jo_column_release(&col);
+
+    if (last) {
+        size_t count = hvml_jo_shape_count(last);
+        printf("shape:");
+        for (size_t i=0; i<count; ++i) printf(" %s", hvml_jo_shape_key(last, i, NULL));
+        printf("\n");
+    }
+    printf("objects: %zu, shaped: %zu, shapes: %zu\n", objects, shaped, shapes);
+
+    hvml_jo_value_free(jo);
+    return ret;
+}
+
+static int print_match(void *arg, hvml_jo_value_t *val) {
+    (void)arg;
+    hvml_jo_value_printf(val, stdout);
+    printf("\n");
+    return 0;
+}
+
+static int query(const char *file, const char *path) {
+    return hvml_jo_query_file(path, file, print_match, NULL) ? 1 : 0;
+}
+
+// a mismatch is marked in the output as well, for the diff to catch it
+static int equal(const char *file) {
+    hvml_jo_value_t *jo = hvml_jo_value_load_from_file(file);
+    if (!jo) return 1;
+    if (hvml_jo_value_type(jo) != MKJOT(J_ARRAY)) {
+        E("not an array: %s", file);
+        hvml_jo_value_free(jo);
+        return 1;
+    }
+
+    int    ret = 0;
+    size_t i   = 0;
+    for (hvml_jo_value_t *l = hvml_jo_value_first(jo); l; l = hvml_jo_value_next(l), ++i) {
+        printf("%zu =", i);
+        if (!hvml_jo_value_equal(l, l)) {
+            E("#%zu not equal to itself", i);
+            printf(" !self");
+            ret = 1;
+        }
+        size_t j = 0;
+        for (hvml_jo_value_t *r = hvml_jo_value_first(jo); r; r = hvml_jo_value_next(r), ++j) {
+            if (r == l || !hvml_jo_value_equal(l, r)) continue;
+            printf(" %zu", j);
+            if (!hvml_jo_value_equal(r, l)) {
+                E("#%zu equal to #%zu, not the other way round", i, j);
+                printf("!symmetric");
+                ret = 1;
+            }
+            if (hvml_jo_value_hash(l) != hvml_jo_value_hash(r)) {
+                E("#%zu and #%zu equal, hashed differently", i, j);
+                printf("!hash");
+                ret = 1;
+            }
+        }
+        printf("\n");
+    }
+
+    hvml_jo_value_free(jo);
+    return ret;
+}
+
+// add `key` with `val` to the object at `obj` of `state`, in place
+static int set_in(hvml_jo_value_t *state, const char *obj, const char *key, hvml_jo_value_t *val) {
+    hvml_jo_value_t *kv = hvml_jo_object_get_kv_by_key(state, obj, strlen(obj));
+    hvml_jo_value_t *jo = kv ? hvml_jo_value_first(kv) : NULL;
+    kv = NULL;
+    if (jo && hvml_jo_value_type(jo) == MKJOT(J_OBJECT)) {
+        kv = hvml_jo_object_kv(key, strlen(key));
+    }
+    if (!kv || !val || hvml_jo_value_push(kv, val)) {
+        if (kv)  hvml_jo_value_free(kv);
+        if (val) hvml_jo_value_free(val);
+        return -1;
+    }
+    if (hvml_jo_value_push(jo, kv)) {
+        hvml_jo_value_free(kv);
+        return -1;
+    }
+    return 0;
+}
+
+static void print_state(const char *name, hvml_jo_value_t *state, hvml_jo_value_t *orig) {
+    printf("%s: ", name);
+    hvml_jo_value_printf(state, stdout);
+    printf("\n%s == template: %d\n", name, hvml_jo_value_equal(state, orig));
+}
+
+static int tmpl(const char *file) {
+    hvml_dom_t *dom = hvml_dom_load_from_file(file);
+    if (!dom) return 1;
+    hvml_dom_tmpl_t *tmpl = hvml_dom_tmpl_create(dom);
+    if (!tmpl) {
+        hvml_dom_destroy(dom);
+        return 1;
+    }
+
+    int              ret  = 1;
+    hvml_jo_value_t *a    = hvml_dom_tmpl_fork_inits(tmpl);
+    hvml_jo_value_t *b    = hvml_dom_tmpl_fork_inits(tmpl);
+    hvml_jo_value_t *c    = NULL;
+    hvml_jo_value_t *jo   = NULL;
+    hvml_jo_cow_t   *s    = NULL;
+    hvml_jo_cow_t   *t    = NULL;
+    hvml_jo_cow_t   *u    = NULL;
+    hvml_jo_cow_t   *val  = NULL;
+    do {
+        if (!a || !b) break;
+        printf("inits: %zu\n", hvml_dom_tmpl_inits(tmpl));
+
+        if (set_in(a, "global", "tz", hvml_jo_integer(8, NULL))) break;
+        print_state("fork a", a, b);
+        // a fork taken after the other one is updated
+        c = hvml_dom_tmpl_fork_inits(tmpl);
+        if (!c) break;
+        print_state("fork b", c, b);
+
+        s = hvml_dom_tmpl_share_inits(tmpl);
+        t = hvml_dom_tmpl_share_inits(tmpl);
+        if (!s || !t) break;
+        printf("shared once: %d\n", s == t);
+
+        hvml_jo_cow_step_t steps[] = {
+            { "global", 6, 0 },
+            { "locale", 6, 0 },
+        };
+        jo = hvml_jo_string("en_US", 5);
+        if (!jo) break;
+        val = hvml_jo_cow_freeze(jo);
+        if (!val) break;
+        u = hvml_jo_cow_set(s, steps, 2, val);
+        if (!u) break;
+
+        hvml_jo_value_t *v = hvml_jo_cow_thaw(u);
+        if (!v) break;
+        print_state("shared updated", v, b);
+        hvml_jo_value_free(v);
+        v = hvml_jo_cow_thaw(t);
+        if (!v) break;
+        print_state("shared", v, b);
+        hvml_jo_value_free(v);
+
+        ret = 0;
+    } while (0);
+
+    if (u)   hvml_jo_cow_unref(u);
+    if (val) hvml_jo_cow_unref(val);
+    if (jo)  hvml_jo_value_free(jo);
+    if (t)   hvml_jo_cow_unref(t);
+    if (s)   hvml_jo_cow_unref(s);
+    if (c)   hvml_jo_value_free(c);
+    if (b)   hvml_jo_value_free(b);
+    if (a)   hvml_jo_value_free(a);
+    hvml_dom_tmpl_unref(tmpl);
+    return ret;
+}
+
+static int stats(const char *file) {
+    hvml_mmap_t map;
+    if (hvml_mmap_open(&map, file)) {
+        E("failed to map file: %s", file);
+        return 1;
+    }
+
+    int                 ret = 1;
+    hvml_parser_stats_t st  = {0};
+    if (strcmp(file_ext(file), ".json")==0) {
+        hvml_jo_gen_t *gen = hvml_jo_gen_create();
+        if (gen && hvml_jo_gen_set_stats(gen, 1)==0) {
+            int r = hvml_jo_gen_parse(gen, map.buf, map.len);
+            hvml_jo_value_t *jo = hvml_jo_gen_parse_end(gen);
+            if (r==0 && jo && hvml_jo_gen_get_stats(gen, &st)==0) ret = 0;
+            if (jo) hvml_jo_value_free(jo);
+        }
+        if (gen) hvml_jo_gen_destroy(gen);
+    } else {
+        hvml_dom_gen_t *gen = hvml_dom_gen_create();
+        if (gen && hvml_dom_gen_set_stats(gen, 1)==0) {
+            int r = hvml_dom_gen_parse(gen, map.buf, map.len);
+            hvml_dom_t *dom = hvml_dom_gen_parse_end(gen);
+            if (r==0 && dom && hvml_dom_gen_get_stats(gen, &st)==0) ret = 0;
+            if (dom) hvml_dom_destroy(dom);
+        }
+        if (gen) hvml_dom_gen_destroy(gen);
+    }
+    hvml_mmap_close(&map);
+    if (ret) return ret;
+
+    printf("bytes %"PRIu64"\n", st.bytes);
+    for (int i=0; i<HVML_PARSER_TOKEN_MAX; ++i) {
+        if (!st.tokens[i]) continue;
+        printf("%s %"PRIu64"\n", hvml_parser_stats_token_name(i), st.tokens[i]);
+    }
+    printf("states_max %"PRIu64"\n", st.states_max);
+    printf("utf8_multibyte %"PRIu64"\n", st.utf8_multibyte);
+    return 0;
+}
+
+static int process_cbor(FILE *in) {
+    hvml_jo_value_t *jo = hvml_jo_cbor_load_from_stream(in);
+    if (jo) {
+        hvml_jo_value_printf(jo, stdout);
+        hvml_jo_value_free(jo);
+        printf("\n");
+        return 0;
+    }
+    return 1;
+}
+
+// json text to cbor, or cbor to json text, by the extension of `file`
+static int convert(const char *file, const char *to) {
+    const int from_cbor = strcmp(file_ext(file), ".cbor")==0;
+
+    hvml_jo_value_t *jo = NULL;
+    if (from_cbor) {
+        FILE *in = fopen(file, "rb");
+        if (!in) {
+            E("failed to open file: %s", file);
+            return 1;
+        }
+        jo = hvml_jo_cbor_load_from_stream(in);
+        fclose(in);
+    } else {
+        jo = hvml_jo_value_load_from_file(file);
+    }
+    if (!jo) return 1;
+
+    int   ret = 1;
+    FILE *out = fopen(to, "wb");
+    if (!out) {
+        E("failed to open file: %s", to);
+    } else {
+        if (from_cbor) {
+            hvml_jo_value_printf(jo, out);
+            ret = 0;
+        } else {
+            ret = hvml_jo_cbor_write(jo, out) ? 1 : 0;
+        }
+        if (fclose(out)) ret = 1;
+        if (ret) E("failed to write file: %s", to);
+    }
+    hvml_jo_value_free(jo);
+    return ret;
+}
+
+// same output as processing the files one by one, in order
+static int process_many(int threads, int count, const char **files) {
+    const char **hvmls = (const char**)calloc(count + 1, sizeof(*hvmls));
+    hvml_dom_t **doms  = (hvml_dom_t**)calloc(count + 1, sizeof(*doms));
+    int         *errs  = (int*)calloc(count + 1, sizeof(*errs));
+    if (!hvmls || !doms || !errs) {
+        free(hvmls); free(doms); free(errs);
+        E("out of memory");
+        return 1;
+    }
+
+    int n = 0;
+    for (int i=0; i<count; ++i) {
+        const char *ext = file_ext(files[i]);
+        if (strcmp(ext, ".json") && strcmp(ext, ".utf8")) hvmls[n++] = files[i];
+    }
+    hvml_dom_load_many(hvmls, n, threads, doms, errs);
+
+    int ret = 0;
+    int j   = 0;
+    for (int i=0; i<count; ++i) {
+        const char *file = files[i];
+        const char *ext  = file_ext(file);
+        if (ret) {
+            if (hvmls[j]==file && doms[j]) hvml_dom_destroy(doms[j]);
+            if (hvmls[j]==file) ++j;
+            continue;
+        }
+        I("processing file: %s", file);
+        if (hvmls[j]==file) {
+            if (errs[j]) {
+                if (errs[j]>0) E("failed to open file: %s", file);
+                ret = 1;
+            } else {
+                hvml_dom_printf(doms[j], stdout);
+                hvml_dom_destroy(doms[j]);
+                printf("\n");
+            }
+            ++j;
+            continue;
+        }
+        FILE *in = fopen(file, "rb");
+        if (!in) {
+            E("failed to open file: %s", file);
+            ret = 1;
+            continue;
+        }
+        ret = process(in, file, ext);
+        fclose(in);
+    }
+
+    free(hvmls); free(doms); free(errs);
+    return ret;
+}
+
+static int process_json(const char *file) {
+    hvml_jo_value_t *jo = NULL;
+    hvml_mmap_t      map;
+    if (json_threads > 0 && hvml_mmap_open(&map, file)==0) {
+        jo = hvml_jo_value_parse_parallel(map.buf, map.len, json_threads);
+        hvml_mmap_close(&map);
+    } else {
+        jo = hvml_jo_value_load_from_file(file);
+    }
     if (jo) {
         hvml_jo_value_printf(jo, stdout);
         hvml_jo_value_free(jo);